@@ -0,0 +1,213 @@
+#ifndef LED_SCHEDULE_H
+#define LED_SCHEDULE_H
+
+#include <cstdint>
+#include <ctime>
+#include "schedule_module.h"
+#include "position_engine.h"
+
+// Block size of an encoded schedule: one flash sector, so blocks can be
+// written to and streamed from a data partition one at a time
+#ifndef LED_SCHEDULE_BLOCK_BYTES
+#define LED_SCHEDULE_BLOCK_BYTES 4096
+#endif
+
+// Block header: base time (uint32, ms after service-day midnight) and record count (uint16), little-endian
+constexpr uint8_t LED_SCHEDULE_HEADER_BYTES = 6;
+
+// Largest record: 5-byte time delta, 3-byte train/op word, LED byte
+constexpr uint8_t LED_SCHEDULE_MAX_RECORD_BYTES = 9;
+
+// Record operations, in the low 2 bits of the train/op word
+constexpr uint8_t LED_OP_STEP_UP = 0;     // LED index + 1
+constexpr uint8_t LED_OP_STEP_DOWN = 1;   // LED index - 1
+constexpr uint8_t LED_OP_SET = 2;         // Followed by a byte: bit 7 northbound, bits 0-6 LED index
+constexpr uint8_t LED_OP_RETIRE = 3;      // Train leaves the line
+
+/**
+ * Block writer: stores one finished block (e.g. to PSRAM or a flash partition)
+ * @param blockIndex Block number, from 0
+ * @param block LED_SCHEDULE_BLOCK_BYTES bytes
+ * @param context Caller's context pointer
+ * @return false to stop the build
+ */
+typedef bool (*LedBlockWriter)(uint32_t blockIndex, const uint8_t* block, void* context);
+
+/**
+ * Block reader: loads one block for a cursor
+ * @param blockIndex Block number, from 0
+ * @param block Output buffer of LED_SCHEDULE_BLOCK_BYTES bytes
+ * @param context Caller's context pointer
+ * @return false if the block cannot be read
+ */
+typedef bool (*LedBlockReader)(uint32_t blockIndex, uint8_t* block, void* context);
+
+/**
+ * LED Schedule Builder
+ * Computes one service day's LED transitions at the start of the day, in
+ * time order, by stepping an event-mode PositionEngine from event to event.
+ * Each transition is a record of varint milliseconds since the previous
+ * one, a varint (trainId << 2 | op) word and, for LED_OP_SET, an LED byte.
+ * Nearly every transition moves one LED, so a record is usually 2-3 bytes
+ * (about 75 KB for a weekday). Records fill fixed-size blocks that
+ * start with their own base time, so a block can be decoded alone.
+ */
+class LedScheduleBuilder {
+public:
+    LedScheduleBuilder();
+
+    /**
+     * Build a service day's schedule, handing each block to a writer
+     * The engine is switched to POSITION_MODE_EVENT and left at the end of the day
+     * @param engine Engine to drive (initialized with the schedule)
+     * @param scheduleModule Schedule the engine uses
+     * @param serviceDayStart Local midnight of the service day (from getServiceDayStart())
+     * @param writer Block writer
+     * @param context Passed to the writer
+     * @return Number of blocks written
+     */
+    uint32_t build(PositionEngine* engine, ScheduleModule* scheduleModule, time_t serviceDayStart,
+                   LedBlockWriter writer, void* context);
+
+    /**
+     * Build a service day's schedule into memory
+     * Call with a null buffer to size it first
+     * @param engine Engine to drive (see build())
+     * @param scheduleModule Schedule the engine uses
+     * @param serviceDayStart Local midnight of the service day
+     * @param buffer Destination, or nullptr to measure only
+     * @param capacity Buffer size in bytes
+     * @return Bytes the schedule needs (whole blocks); blocks past capacity are not written
+     */
+    uint32_t buildToMemory(PositionEngine* engine, ScheduleModule* scheduleModule, time_t serviceDayStart,
+                           uint8_t* buffer, uint32_t capacity);
+
+    /**
+     * Get the number of transitions in the last build
+     * @return Transition count
+     */
+    uint32_t getTransitionCount() { return transitionCount_; }
+
+private:
+    /**
+     * Append one record, starting a new block first if it might not fit
+     * @param dayMillis Milliseconds after service-day midnight
+     * @param trainId Train slot
+     * @param op LED_OP_*
+     * @param ledByte LED byte for LED_OP_SET
+     * @return false if the writer stopped the build
+     */
+    bool addRecord(uint32_t dayMillis, uint16_t trainId, uint8_t op, uint8_t ledByte);
+
+    /**
+     * Hand the current block to the writer and start the next one
+     * @return false if the writer stopped the build
+     */
+    bool flushBlock();
+
+    LedBlockWriter writer_;
+    void* context_;
+    uint8_t block_[LED_SCHEDULE_BLOCK_BYTES];
+    uint16_t blockBytes_;       // Bytes used in block_, header included
+    uint16_t blockRecords_;
+    uint32_t blockCount_;
+    uint32_t lastMillis_;       // Time of the last record
+    uint32_t transitionCount_;
+    uint8_t trainLEDs_[MAX_TRAINS];  // LED last recorded per slot, TRAIN_LED_NONE when off the line
+};
+
+/**
+ * LED Schedule Cursor
+ * Replays a built schedule: each advance applies only the records due
+ * since the last one, so a tick with no transition costs one comparison.
+ * The schedule can sit in memory or be read a block at a time (e.g. from
+ * flash) through a LedBlockReader.
+ */
+class LedScheduleCursor {
+public:
+    LedScheduleCursor();
+
+    /**
+     * Replay a schedule held in memory
+     * @param data Encoded blocks
+     * @param size Size in bytes (a whole number of blocks)
+     */
+    void initFromMemory(const uint8_t* data, uint32_t size);
+
+    /**
+     * Replay a schedule read one block at a time
+     * @param reader Block reader
+     * @param context Passed to the reader
+     * @param blockCount Blocks in the schedule
+     */
+    void initFromReader(LedBlockReader reader, void* context, uint32_t blockCount);
+
+    /**
+     * Return to the start of the day, with no train on the line
+     */
+    void rewind();
+
+    /**
+     * Apply every transition up to a time
+     * Going backward rewinds and replays from the start of the day
+     * @param dayMillis Milliseconds after service-day midnight
+     * @return Number of transitions applied
+     */
+    uint32_t advanceTo(uint32_t dayMillis);
+
+    /**
+     * Get train positions after the last advance
+     * Positions are whole LEDs (ledPosition = ledIndex << 8), in slot order
+     * @param count Output parameter for number of trains on the line
+     * @return Pointer to train positions array
+     */
+    const TrainPosition* getActiveTrainPositions(uint16_t* count);
+
+    /**
+     * Get LED occupancy after the last advance
+     * @return Per-direction bitmaps and per-LED counts of the positions array
+     */
+    const LedOccupancy* getOccupancy();
+
+private:
+    /**
+     * Rebuild positions and occupancy if a transition was applied since the last rebuild
+     */
+    void rebuildPositions();
+
+    /**
+     * Decode the time of the next record, loading the next block when the current one is used up
+     * @return false at the end of the schedule
+     */
+    bool peekRecord();
+
+    /**
+     * Read an unsigned LEB128 varint from the current block
+     * @return Decoded value
+     */
+    uint32_t readVarint();
+
+    const uint8_t* memory_;
+    LedBlockReader reader_;
+    void* context_;
+    uint32_t blockCount_;
+    uint8_t blockBuffer_[LED_SCHEDULE_BLOCK_BYTES];  // Current block, when read through reader_
+
+    // Decoding state
+    const uint8_t* block_;      // Current block, or nullptr before the first
+    uint32_t blockIndex_;       // Next block to load
+    uint16_t blockOffset_;
+    uint16_t blockRecords_;     // Records left in the current block
+    uint32_t recordMillis_;     // Time of the record at blockOffset_ (valid while hasRecord_)
+    bool hasRecord_;
+    uint32_t currentMillis_;
+
+    uint8_t trainLEDs_[MAX_TRAINS];       // TRAIN_LED_NONE when off the line
+    uint8_t trainNorthbound_[MAX_TRAINS];
+    TrainPosition trainPositions_[MAX_TRAINS];
+    uint16_t activeTrainCount_;
+    LedOccupancy occupancy_;
+    bool positionsDirty_;
+};
+
+#endif // LED_SCHEDULE_H
@@ -0,0 +1,340 @@
+#ifndef LINE_DATA_H
+#define LINE_DATA_H
+
+#include <cstdint>
+
+/**
+ * Station structure
+ */
+struct Station {
+    char name[32];
+    uint8_t ledIndex;
+    float distanceFromStart;  // Kilometers
+};
+
+/**
+ * Inter-station segment: run time between adjacent stations
+ * Run time excludes dwell; dwell is kept per station (LINE_STATION_DWELL)
+ */
+struct InterStationSegment {
+    uint8_t stationA;
+    uint8_t stationB;
+    uint16_t travelTimeSeconds;
+};
+
+/**
+ * Service pattern: a run of consecutive stations with a shared timing profile
+ * Offsets are seconds from the trip's origin departure, so trips that share
+ * a stopping pattern and running times share one pattern record. The same
+ * record is used for compiled-in data and read in place from timetable blobs.
+ */
+struct ServicePattern {
+    uint32_t offsetsIndex;    // Into the offset pool: stopCount arrivals, then stopCount departures
+    uint8_t firstStation;     // Station index of the first stop
+    uint8_t stopCount;        // Number of consecutive stations served
+    uint8_t isNorthbound;     // 1 = station index increases along the trip
+    uint8_t reserved;
+};
+
+/**
+ * Headway band: departures every headwayMinutes from startMinutes until the next band
+ */
+struct HeadwayBand {
+    uint16_t startMinutes;    // Service-day minutes (after midnight runs past 1440)
+    uint8_t headwayMinutes;
+};
+
+/**
+ * Holiday rule: a date each year that runs a different service
+ * Either a fixed day of the month, or the nth (or last) weekday of the month
+ */
+struct HolidayRule {
+    uint8_t month;            // 1-12
+    uint8_t day;              // Fixed day of month, 0 for a weekday rule
+    uint8_t weekday;          // 0 = Sunday (weekday rules only)
+    uint8_t week;             // 1-4 = nth weekday, 5 = last (weekday rules only)
+    uint8_t serviceId;
+};
+
+/**
+ * Link Light Rail 1 Line data (Lynnwood City Center to Angle Lake)
+ * Everything in this header is evaluated at compile time and placed in
+ * flash/rodata, so loading the schedule costs no SRAM and no startup work.
+ */
+
+// Largest station table accepted from a timetable blob (station indices are 8-bit)
+#ifndef MAX_STATIONS
+#define MAX_STATIONS 64
+#endif
+
+constexpr uint8_t LINE_STATION_COUNT = 23;
+constexpr uint8_t LINE_LED_COUNT = 100;   // LEDs 0-99 represent the full line
+
+// Service IDs, matching TimetableTrip::serviceId
+constexpr uint8_t SERVICE_WEEKDAY = 0;
+constexpr uint8_t SERVICE_SATURDAY = 1;
+constexpr uint8_t SERVICE_SUNDAY = 2;
+constexpr uint8_t SERVICE_NONE = 0xFF;    // No trains run
+
+// Service days start at 03:00 local time, inside the overnight gap, so
+// after-midnight trips belong to the previous day's timetable
+constexpr uint16_t SERVICE_DAY_START_MINUTES = 180;
+
+/**
+ * LED index for a station
+ * Evenly distributes stations across the strip (99 / 22 gaps = 4.5 LEDs per station)
+ * @param station Station index
+ * @return LED index
+ */
+constexpr uint8_t lineStationLED(uint8_t station) {
+    return (uint8_t)((station * (LINE_LED_COUNT - 1)) / (LINE_STATION_COUNT - 1));
+}
+
+// Total line distance: approximately 45 km from Lynnwood City Center to Angle Lake
+inline constexpr Station LINE_STATIONS[LINE_STATION_COUNT] = {
+    {"Lynnwood City Center",     lineStationLED(0),  0.0f},
+    {"Mountlake Terrace",        lineStationLED(1),  3.0f},
+    {"Shoreline North/185th",    lineStationLED(2),  6.0f},
+    {"Shoreline South/148th",    lineStationLED(3),  8.0f},
+    {"Northgate",                lineStationLED(4),  10.0f},
+    {"Roosevelt",                lineStationLED(5),  12.4f},
+    {"U District",               lineStationLED(6),  13.8f},
+    {"University of Washington", lineStationLED(7),  15.2f},
+    {"Capitol Hill",             lineStationLED(8),  17.5f},
+    {"Westlake",                 lineStationLED(9),  19.8f},
+    {"Symphony",                 lineStationLED(10), 20.5f},
+    {"Pioneer Square",           lineStationLED(11), 21.2f},
+    {"Intl Dist/Chinatown",      lineStationLED(12), 21.9f},
+    {"Stadium",                  lineStationLED(13), 23.0f},
+    {"SODO",                     lineStationLED(14), 24.8f},
+    {"Beacon Hill",              lineStationLED(15), 26.9f},
+    {"Mount Baker",              lineStationLED(16), 29.2f},
+    {"Columbia City",            lineStationLED(17), 31.5f},
+    {"Othello",                  lineStationLED(18), 33.8f},
+    {"Rainier Beach",            lineStationLED(19), 36.1f},
+    {"Tukwila Intl Blvd",        lineStationLED(20), 40.0f},
+    {"SeaTac/Airport",           lineStationLED(21), 43.0f},
+    {"Angle Lake",               lineStationLED(22), 45.0f},
+};
+
+/**
+ * Cumulative travel time tables
+ * Offsets in seconds from origin departure, in travel order. Laid out as a
+ * pattern offset pool: for each direction, LINE_STATION_COUNT arrivals followed
+ * by LINE_STATION_COUNT departures. Direction 0 = northbound (starts at
+ * station 0), 1 = southbound (starts at last station).
+ */
+struct LineTravelTimes {
+    uint16_t offsets[4 * LINE_STATION_COUNT];
+};
+
+/**
+ * Index of a direction's arrival offsets within LineTravelTimes::offsets
+ * @param direction 0 = northbound, 1 = southbound
+ * @return Offset pool index (departures follow LINE_STATION_COUNT entries later)
+ */
+constexpr uint32_t lineOffsetsIndex(uint8_t direction) {
+    return direction * 2 * LINE_STATION_COUNT;
+}
+
+/**
+ * Segment run times, northbound order (segment i joins stations i and i + 1)
+ * Seconds of running between platforms, excluding dwell
+ */
+inline constexpr InterStationSegment LINE_SEGMENTS[LINE_STATION_COUNT - 1] = {
+    {0,  1,  240},    // Lynnwood City Center - Mountlake Terrace
+    {1,  2,  180},    // Mountlake Terrace - Shoreline North/185th
+    {2,  3,  150},    // Shoreline North/185th - Shoreline South/148th
+    {3,  4,  180},    // Shoreline South/148th - Northgate
+    {4,  5,  180},    // Northgate - Roosevelt
+    {5,  6,  90},     // Roosevelt - U District
+    {6,  7,  120},    // U District - University of Washington
+    {7,  8,  150},    // University of Washington - Capitol Hill
+    {8,  9,  150},    // Capitol Hill - Westlake
+    {9,  10, 75},     // Westlake - Symphony
+    {10, 11, 75},     // Symphony - Pioneer Square
+    {11, 12, 75},     // Pioneer Square - Intl Dist/Chinatown
+    {12, 13, 105},    // Intl Dist/Chinatown - Stadium
+    {13, 14, 105},    // Stadium - SODO
+    {14, 15, 180},    // SODO - Beacon Hill
+    {15, 16, 105},    // Beacon Hill - Mount Baker
+    {16, 17, 195},    // Mount Baker - Columbia City (surface running)
+    {17, 18, 180},    // Columbia City - Othello
+    {18, 19, 165},    // Othello - Rainier Beach
+    {19, 20, 330},    // Rainier Beach - Tukwila Intl Blvd
+    {20, 21, 240},    // Tukwila Intl Blvd - SeaTac/Airport
+    {21, 22, 150},    // SeaTac/Airport - Angle Lake
+};
+
+/**
+ * Dwell time at each station, in seconds
+ * Transfer and downtown stations hold longer; trains do not dwell at terminals
+ */
+inline constexpr uint16_t LINE_STATION_DWELL[LINE_STATION_COUNT] = {
+    0,    // Lynnwood City Center (terminal)
+    25,   // Mountlake Terrace
+    25,   // Shoreline North/185th
+    25,   // Shoreline South/148th
+    40,   // Northgate
+    25,   // Roosevelt
+    25,   // U District
+    40,   // University of Washington
+    40,   // Capitol Hill
+    40,   // Westlake
+    30,   // Symphony
+    30,   // Pioneer Square
+    40,   // Intl Dist/Chinatown
+    25,   // Stadium
+    25,   // SODO
+    25,   // Beacon Hill
+    25,   // Mount Baker
+    25,   // Columbia City
+    25,   // Othello
+    25,   // Rainier Beach
+    30,   // Tukwila Intl Blvd
+    40,   // SeaTac/Airport
+    0,    // Angle Lake (terminal)
+};
+
+/**
+ * Check that segment i joins stations i and i + 1
+ * @return true if LINE_SEGMENTS is in northbound station order
+ */
+constexpr bool lineSegmentsOrdered() {
+    for (uint8_t i = 0; i < LINE_STATION_COUNT - 1; i++) {
+        if (LINE_SEGMENTS[i].stationA != i || LINE_SEGMENTS[i].stationB != i + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Build cumulative arrival/departure offsets from segment run times and station dwells
+ * Prefix sums, so a position lookup is a binary search over one direction's offsets
+ * @return Travel time tables for both directions
+ */
+constexpr LineTravelTimes buildLineTravelTimes() {
+    LineTravelTimes tables{};
+
+    for (uint8_t direction = 0; direction < 2; direction++) {
+        uint16_t* arrival = tables.offsets + lineOffsetsIndex(direction);
+        uint16_t* departure = arrival + LINE_STATION_COUNT;
+        uint16_t elapsed = 0;
+
+        for (uint8_t stop = 0; stop < LINE_STATION_COUNT; stop++) {
+            uint8_t station = (direction == 0) ? stop : (LINE_STATION_COUNT - 1 - stop);
+
+            if (stop > 0) {
+                // Segment i joins stations i and i + 1; run times are the same both ways
+                uint8_t segment = (direction == 0) ? (station - 1) : station;
+                elapsed += LINE_SEGMENTS[segment].travelTimeSeconds;
+            }
+            arrival[stop] = elapsed;
+
+            // Trains dwell at every stop except the origin and terminal
+            if (stop > 0 && stop < LINE_STATION_COUNT - 1) {
+                elapsed += LINE_STATION_DWELL[station];
+            }
+            departure[stop] = elapsed;
+        }
+    }
+
+    return tables;
+}
+
+inline constexpr LineTravelTimes LINE_TRAVEL_TIMES = buildLineTravelTimes();
+
+// Full-route patterns over LINE_TRAVEL_TIMES, northbound then southbound
+inline constexpr ServicePattern LINE_PATTERNS[2] = {
+    {lineOffsetsIndex(0), 0, LINE_STATION_COUNT, 1, 0},
+    {lineOffsetsIndex(1), LINE_STATION_COUNT - 1, LINE_STATION_COUNT, 0, 0},
+};
+
+// End-to-end route time (same in both directions)
+constexpr uint16_t LINE_ROUTE_TIME_SECONDS = LINE_TRAVEL_TIMES.offsets[lineOffsetsIndex(0) + LINE_STATION_COUNT - 1];
+
+/**
+ * Headway bands per day type, ordered by start time
+ * Peaks run every 8 minutes on weekdays; early morning and late evening thin out
+ */
+inline constexpr HeadwayBand LINE_WEEKDAY_BANDS[] = {
+    {300,  12},   // 5:00 AM early service
+    {360,  8},    // 6:00 AM morning peak
+    {540,  10},   // 9:00 AM midday
+    {900,  8},    // 3:00 PM evening peak
+    {1110, 10},   // 6:30 PM evening
+    {1260, 15},   // 9:00 PM late night
+};
+
+inline constexpr HeadwayBand LINE_SATURDAY_BANDS[] = {
+    {330,  15},   // 5:30 AM early service
+    {480,  10},   // 8:00 AM daytime
+    {1260, 15},   // 9:00 PM late night
+};
+
+inline constexpr HeadwayBand LINE_SUNDAY_BANDS[] = {
+    {360,  15},   // 6:00 AM early service
+    {540,  10},   // 9:00 AM daytime
+    {1200, 15},   // 8:00 PM late night
+};
+
+// Holidays run the Sunday schedule
+inline constexpr HolidayRule LINE_HOLIDAYS[] = {
+    {1,  1,  0, 0, SERVICE_SUNDAY},   // New Year's Day
+    {5,  0,  1, 5, SERVICE_SUNDAY},   // Memorial Day (last Monday in May)
+    {7,  4,  0, 0, SERVICE_SUNDAY},   // Independence Day
+    {9,  0,  1, 1, SERVICE_SUNDAY},   // Labor Day (first Monday in September)
+    {11, 0,  4, 4, SERVICE_SUNDAY},   // Thanksgiving (fourth Thursday in November)
+    {12, 25, 0, 0, SERVICE_SUNDAY},   // Christmas Day
+};
+
+constexpr uint8_t LINE_HOLIDAY_COUNT = sizeof(LINE_HOLIDAYS) / sizeof(LINE_HOLIDAYS[0]);
+
+constexpr uint8_t LINE_WEEKDAY_BAND_COUNT = sizeof(LINE_WEEKDAY_BANDS) / sizeof(LINE_WEEKDAY_BANDS[0]);
+constexpr uint8_t LINE_SATURDAY_BAND_COUNT = sizeof(LINE_SATURDAY_BANDS) / sizeof(LINE_SATURDAY_BANDS[0]);
+constexpr uint8_t LINE_SUNDAY_BAND_COUNT = sizeof(LINE_SUNDAY_BANDS) / sizeof(LINE_SUNDAY_BANDS[0]);
+
+constexpr uint8_t LINE_NO_BAND = 0xFF;
+
+/**
+ * Minute-of-day to headway band lookup
+ * band[m] is the band in effect at clock minute m (LINE_NO_BAND before the first band)
+ */
+struct LineBandMap {
+    uint8_t band[1440];
+};
+
+/**
+ * Build the minute-of-day to band map for a day type
+ * Clock minutes before SERVICE_DAY_START_MINUTES belong to the previous service day
+ * @param bands Bands ordered by start time
+ * @param bandCount Number of bands
+ * @return Band map
+ */
+constexpr LineBandMap buildLineBandMap(const HeadwayBand* bands, uint8_t bandCount) {
+    LineBandMap map{};
+
+    for (uint16_t minute = 0; minute < 1440; minute++) {
+        uint16_t serviceMinute = (minute < SERVICE_DAY_START_MINUTES) ? (minute + 1440) : minute;
+        map.band[minute] = LINE_NO_BAND;
+        for (uint8_t i = 0; i < bandCount && bands[i].startMinutes <= serviceMinute; i++) {
+            map.band[minute] = i;
+        }
+    }
+
+    return map;
+}
+
+inline constexpr LineBandMap LINE_WEEKDAY_BAND_MAP = buildLineBandMap(LINE_WEEKDAY_BANDS, LINE_WEEKDAY_BAND_COUNT);
+inline constexpr LineBandMap LINE_SATURDAY_BAND_MAP = buildLineBandMap(LINE_SATURDAY_BANDS, LINE_SATURDAY_BAND_COUNT);
+inline constexpr LineBandMap LINE_SUNDAY_BAND_MAP = buildLineBandMap(LINE_SUNDAY_BANDS, LINE_SUNDAY_BAND_COUNT);
+
+static_assert(lineStationLED(LINE_STATION_COUNT - 1) == LINE_LED_COUNT - 1, "Last station must map to the last LED");
+static_assert(MAX_STATIONS <= 255, "Station indices are 8-bit");
+static_assert(LINE_STATION_COUNT <= MAX_STATIONS, "Compiled-in line exceeds MAX_STATIONS");
+static_assert(lineSegmentsOrdered(), "LINE_SEGMENTS must join consecutive stations in northbound order");
+static_assert(LINE_ROUTE_TIME_SECONDS == LINE_TRAVEL_TIMES.offsets[lineOffsetsIndex(1) + LINE_STATION_COUNT - 1],
+              "Route time must be symmetric");
+
+#endif // LINE_DATA_H
@@ -0,0 +1,367 @@
+#include "monte_carlo.h"
+#include "position_engine.h"
+#include "trip_table.h"
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Kinds of draw made at each stop of each trip
+constexpr uint64_t DRAW_DEPARTURE = 0;
+constexpr uint64_t DRAW_RUN_TIME = 1;
+constexpr uint64_t DRAW_DWELL = 2;
+
+/**
+ * Counter of a draw: unique per trip, stop and kind, leaving two values for each
+ */
+uint64_t drawCounter(uint16_t trip, uint8_t stop, uint64_t kind) {
+    return (((uint64_t)trip * MAX_STATIONS + stop) * 4 + kind) * 2;
+}
+
+/**
+ * A trip with drawn stop times
+ */
+struct DrawnTrip {
+    int32_t start;            // Origin departure, seconds after service-day midnight
+    int32_t end;              // Terminal arrival, same clock
+    int32_t delay;            // Terminal arrival minus the scheduled one
+    const ServicePattern* pattern;
+};
+
+}  // namespace
+
+MonteCarloSimulator::MonteCarloSimulator()
+    : scheduleModule_(nullptr),
+      start_(0),
+      end_(0),
+      step_(1),
+      runCount_(0),
+      seed_(0),
+      nextRun_(0) {
+    model_.departure = {DELAY_FIXED, 0.0f};
+    model_.runTime = {DELAY_FIXED, 0.0f};
+    model_.dwell = {DELAY_FIXED, 0.0f};
+    resetSummaries(summaries_);
+}
+
+void MonteCarloSimulator::init(ScheduleModule* scheduleModule) {
+    scheduleModule_ = scheduleModule;
+}
+
+uint16_t MonteCarloSimulator::run(time_t start, time_t end, uint32_t step, uint32_t runCount, uint64_t seed,
+                                  uint16_t threadCount) {
+    start_ = start;
+    end_ = end;
+    step_ = step;
+    runCount_ = runCount;
+    seed_ = seed;
+    nextRun_.store(0);
+    resetSummaries(summaries_);
+    if (scheduleModule_ == nullptr || runCount == 0 || step == 0 || end <= start) {
+        return 0;
+    }
+
+    if (threadCount == 0) {
+        threadCount = (uint16_t)std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+    if (threadCount > runCount) {
+        threadCount = (uint16_t)runCount;
+    }
+
+    // One set of histograms per thread; no sharing until the merge
+    std::vector<MonteCarloSummary> threadSummaries((size_t)threadCount * MONTE_CARLO_METRIC_COUNT);
+    for (uint16_t t = 0; t < threadCount; t++) {
+        resetSummaries(&threadSummaries[(size_t)t * MONTE_CARLO_METRIC_COUNT]);
+    }
+    std::vector<std::thread> workers;
+    for (uint16_t t = 1; t < threadCount; t++) {
+        workers.emplace_back(&MonteCarloSimulator::runWorker, this,
+                             &threadSummaries[(size_t)t * MONTE_CARLO_METRIC_COUNT]);
+    }
+    runWorker(&threadSummaries[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (uint16_t t = 0; t < threadCount; t++) {
+        for (uint8_t metric = 0; metric < MONTE_CARLO_METRIC_COUNT; metric++) {
+            mergeSummary(&summaries_[metric], threadSummaries[(size_t)t * MONTE_CARLO_METRIC_COUNT + metric]);
+        }
+    }
+    return threadCount;
+}
+
+const MonteCarloSummary* MonteCarloSimulator::getSummary(uint8_t metric) {
+    if (metric >= MONTE_CARLO_METRIC_COUNT) {
+        return nullptr;
+    }
+    return &summaries_[metric];
+}
+
+float MonteCarloSimulator::getPercentile(uint8_t metric, float percentile) {
+    const MonteCarloSummary* summary = getSummary(metric);
+    if (summary == nullptr || summary->count == 0) {
+        return 0.0f;
+    }
+
+    // Walk the cumulative counts to the bin holding the rank, then interpolate inside it
+    double rank = (double)summary->count * percentile / 100.0;
+    double below = 0.0;
+    float value = summary->maximum;
+    for (uint16_t bin = 0; bin < MONTE_CARLO_HISTOGRAM_BINS; bin++) {
+        if (summary->bins[bin] == 0) {
+            continue;
+        }
+        if (below + summary->bins[bin] >= rank) {
+            double fraction = (rank - below) / summary->bins[bin];
+            value = summary->lowerBound + (float)((bin + fraction) * summary->binWidth);
+            break;
+        }
+        below += summary->bins[bin];
+    }
+
+    if (value < summary->minimum) value = summary->minimum;
+    if (value > summary->maximum) value = summary->maximum;
+    return value;
+}
+
+float MonteCarloSimulator::drawDelay(const DelayDistribution& distribution, uint64_t stream, uint64_t counter) {
+    if (distribution.type == DELAY_FIXED || distribution.spread == 0.0f) {
+        return 0.0f;
+    }
+
+    // 53-bit uniforms; the first is in (0, 1] so its logarithm is finite
+    double first = ((randomBits(stream, counter) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    if (distribution.type == DELAY_UNIFORM) {
+        return (float)((2.0 * first - 1.0) * distribution.spread);
+    }
+    if (distribution.type == DELAY_EXPONENTIAL) {
+        return (float)(-std::log(first) * distribution.spread);
+    }
+    if (distribution.type == DELAY_NORMAL) {
+        // Box-Muller with the draw's second value
+        double second = (randomBits(stream, counter + 1) >> 11) * (1.0 / 9007199254740992.0);
+        return (float)(std::sqrt(-2.0 * std::log(first)) * std::cos(6.283185307179586 * second) * distribution.spread);
+    }
+    return 0.0f;
+}
+
+uint64_t MonteCarloSimulator::randomBits(uint64_t stream, uint64_t counter) {
+    // Value counter of the SplitMix64 sequence seeded with stream, computed directly
+    uint64_t x = stream + (counter + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+void MonteCarloSimulator::runWorker(MonteCarloSummary* summaries) {
+    // This thread's schedule view, engine (for its LED mapping) and day plan
+    ScheduleModule schedule = *scheduleModule_;
+    std::unique_ptr<PositionEngine> engine(new PositionEngine());
+    engine->setLogging(false);
+    engine->init(&schedule);
+    std::unique_ptr<TripTable> plan(new TripTable());
+    plan->setLogging(false);
+    time_t serviceDayStart = schedule.getServiceDayStart(start_);
+    plan->build(&schedule, serviceDayStart);
+
+    uint16_t tripCount = plan->getTripCount();
+    int64_t windowStart = start_ - serviceDayStart;
+    int64_t windowEnd = end_ - serviceDayStart;
+
+    // Per-run scratch, reused: drawn stop times (stopCount arrivals, then stopCount departures per trip)
+    std::vector<DrawnTrip> trips(tripCount);
+    std::vector<uint16_t> offsets((size_t)tripCount * MAX_STATIONS * 2);
+    std::vector<uint16_t> order(tripCount);      // Trips by drawn departure
+    std::vector<uint16_t> running(tripCount);    // Trips on the line at the current tick
+    std::vector<uint16_t> positions[2] = {std::vector<uint16_t>(tripCount), std::vector<uint16_t>(tripCount)};
+
+    while (true) {
+        uint32_t run = nextRun_.fetch_add(1, std::memory_order_relaxed);
+        if (run >= runCount_) {
+            break;
+        }
+        uint64_t stream = randomBits(seed_, run);
+
+        // Draw every trip's stop times around the pattern's nominal ones
+        int64_t delaySum = 0;
+        int32_t maxDelay = 0;
+        uint16_t windowTrips = 0;
+        for (uint16_t i = 0; i < tripCount; i++) {
+            const Trip* trip = plan->getTrip(i);
+            const ServicePattern* pattern = schedule.getPattern(trip->pattern);
+            const uint16_t* nominalArrivals = schedule.getPatternArrivals(pattern);
+            const uint16_t* nominalDepartures = schedule.getPatternDepartures(pattern);
+            uint8_t stopCount = pattern->stopCount;
+            uint16_t* arrivals = &offsets[(size_t)i * MAX_STATIONS * 2];
+            uint16_t* departures = arrivals + stopCount;
+
+            int32_t clock = nominalDepartures[0];
+            arrivals[0] = 0;
+            departures[0] = (uint16_t)clock;
+            for (uint8_t stop = 1; stop < stopCount; stop++) {
+                int32_t runTime = (int32_t)(nominalArrivals[stop] - nominalDepartures[stop - 1]) +
+                                  (int32_t)lroundf(drawDelay(model_.runTime, stream, drawCounter(i, stop, DRAW_RUN_TIME)));
+                clock += (runTime < 1) ? 1 : runTime;
+                if (clock > 0xFFFF) clock = 0xFFFF;
+                arrivals[stop] = (uint16_t)clock;
+
+                if (stop < stopCount - 1) {
+                    int32_t dwell = (int32_t)(nominalDepartures[stop] - nominalArrivals[stop]) +
+                                    (int32_t)lroundf(drawDelay(model_.dwell, stream, drawCounter(i, stop, DRAW_DWELL)));
+                    clock += (dwell < 0) ? 0 : dwell;
+                    if (clock > 0xFFFF) clock = 0xFFFF;
+                }
+                departures[stop] = (uint16_t)clock;
+            }
+
+            int32_t departureDelay = (int32_t)lroundf(drawDelay(model_.departure, stream,
+                                                               drawCounter(i, 0, DRAW_DEPARTURE)));
+            DrawnTrip* drawn = &trips[i];
+            drawn->start = (int32_t)trip->departureSeconds + departureDelay;
+            drawn->end = drawn->start + arrivals[stopCount - 1];
+            drawn->delay = departureDelay + arrivals[stopCount - 1] - nominalArrivals[stopCount - 1];
+            drawn->pattern = pattern;
+
+            // Punctuality counts the trips scheduled to leave inside the window
+            if (trip->departureSeconds >= windowStart && trip->departureSeconds < windowEnd) {
+                delaySum += drawn->delay;
+                if (windowTrips == 0 || drawn->delay > maxDelay) {
+                    maxDelay = drawn->delay;
+                }
+                windowTrips++;
+            }
+
+            // Drawn departures are nearly in timetable order: insertion sort
+            uint16_t slot = i;
+            while (slot > 0 && trips[order[slot - 1]].start > drawn->start) {
+                order[slot] = order[slot - 1];
+                slot--;
+            }
+            order[slot] = i;
+        }
+
+        // Step through the window, placing each running trip as the engine would
+        uint16_t cursor = 0;
+        uint16_t runningCount = 0;
+        uint32_t bunchedSeconds = 0;
+        uint16_t minSpacing = LINE_LED_COUNT << 8;
+        for (int64_t t = windowStart; t < windowEnd; t += step_) {
+            while (cursor < tripCount && trips[order[cursor]].start <= t) {
+                if (trips[order[cursor]].end > t) {
+                    running[runningCount++] = order[cursor];
+                }
+                cursor++;
+            }
+
+            uint8_t occupancy[2][LINE_LED_COUNT];
+            memset(occupancy, 0, sizeof(occupancy));
+            uint16_t positionCounts[2] = {0, 0};
+            bool bunched = false;
+            for (uint16_t k = 0; k < runningCount;) {
+                uint16_t i = running[k];
+                const DrawnTrip& drawn = trips[i];
+                const uint16_t* arrivals = &offsets[(size_t)i * MAX_STATIONS * 2];
+                const uint16_t* departures = arrivals + drawn.pattern->stopCount;
+
+                uint8_t currentStation = 0;
+                uint8_t nextStation = 0;
+                float progress = 0.0f;
+                if (!PositionEngine::placeOnStops(drawn.pattern, arrivals, departures, (int32_t)(t - drawn.start), 0,
+                                                  &currentStation, &nextStation, &progress)) {
+                    running[k] = running[--runningCount];
+                    continue;
+                }
+                k++;
+
+                uint8_t ledIndex = 0;
+                uint16_t ledPosition = 0;
+                if (!engine->mapTrainToLED(currentStation, nextStation, progress, &ledIndex, &ledPosition)) {
+                    continue;
+                }
+                uint8_t direction = drawn.pattern->isNorthbound ? 1 : 0;
+                if (occupancy[direction][ledIndex] < 0xFF && ++occupancy[direction][ledIndex] == 2) {
+                    bunched = true;
+                }
+                positions[direction][positionCounts[direction]++] = ledPosition;
+            }
+            if (bunched) {
+                bunchedSeconds += step_;
+            }
+
+            // Closest pair in each direction: sort the few positions, compare neighbours
+            for (uint8_t direction = 0; direction < 2; direction++) {
+                uint16_t* sorted = positions[direction].data();
+                for (uint16_t a = 1; a < positionCounts[direction]; a++) {
+                    uint16_t value = sorted[a];
+                    uint16_t b = a;
+                    while (b > 0 && sorted[b - 1] > value) {
+                        sorted[b] = sorted[b - 1];
+                        b--;
+                    }
+                    sorted[b] = value;
+                    if (b > 0 && value - sorted[b - 1] < minSpacing) {
+                        minSpacing = value - sorted[b - 1];
+                    }
+                    if (b + 1 <= a && sorted[b + 1] - value < minSpacing) {
+                        minSpacing = sorted[b + 1] - value;
+                    }
+                }
+            }
+        }
+
+        recordValue(&summaries[MONTE_CARLO_BUNCHED_SECONDS], (float)bunchedSeconds);
+        recordValue(&summaries[MONTE_CARLO_MIN_SPACING], minSpacing / 256.0f);
+        recordValue(&summaries[MONTE_CARLO_MEAN_DELAY], windowTrips > 0 ? (float)delaySum / windowTrips : 0.0f);
+        recordValue(&summaries[MONTE_CARLO_MAX_DELAY], (float)maxDelay);
+    }
+}
+
+void MonteCarloSimulator::resetSummaries(MonteCarloSummary* summaries) {
+    float windowSeconds = (end_ > start_) ? (float)(end_ - start_) : 1.0f;
+    resetSummary(&summaries[MONTE_CARLO_BUNCHED_SECONDS], 0.0f, windowSeconds);
+    resetSummary(&summaries[MONTE_CARLO_MIN_SPACING], 0.0f, (float)LINE_LED_COUNT);
+    resetSummary(&summaries[MONTE_CARLO_MEAN_DELAY], MONTE_CARLO_DELAY_MIN_SECONDS, MONTE_CARLO_DELAY_MAX_SECONDS);
+    resetSummary(&summaries[MONTE_CARLO_MAX_DELAY], MONTE_CARLO_DELAY_MIN_SECONDS, MONTE_CARLO_DELAY_MAX_SECONDS);
+}
+
+void MonteCarloSimulator::resetSummary(MonteCarloSummary* summary, float lowerBound, float upperBound) {
+    memset(summary->bins, 0, sizeof(summary->bins));
+    summary->lowerBound = lowerBound;
+    summary->binWidth = (upperBound - lowerBound) / MONTE_CARLO_HISTOGRAM_BINS;
+    summary->count = 0;
+    summary->sum = 0.0;
+    summary->minimum = 0.0f;
+    summary->maximum = 0.0f;
+}
+
+void MonteCarloSimulator::recordValue(MonteCarloSummary* summary, float value) {
+    int32_t bin = (int32_t)std::floor((value - summary->lowerBound) / summary->binWidth);
+    if (bin < 0) bin = 0;
+    if (bin >= MONTE_CARLO_HISTOGRAM_BINS) bin = MONTE_CARLO_HISTOGRAM_BINS - 1;
+    summary->bins[bin]++;
+
+    if (summary->count == 0 || value < summary->minimum) summary->minimum = value;
+    if (summary->count == 0 || value > summary->maximum) summary->maximum = value;
+    summary->count++;
+    summary->sum += value;
+}
+
+void MonteCarloSimulator::mergeSummary(MonteCarloSummary* target, const MonteCarloSummary& source) {
+    if (source.count == 0) {
+        return;
+    }
+    for (uint16_t bin = 0; bin < MONTE_CARLO_HISTOGRAM_BINS; bin++) {
+        target->bins[bin] += source.bins[bin];
+    }
+    if (target->count == 0 || source.minimum < target->minimum) target->minimum = source.minimum;
+    if (target->count == 0 || source.maximum > target->maximum) target->maximum = source.maximum;
+    target->count += source.count;
+    target->sum += source.sum;
+}
@@ -0,0 +1,192 @@
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include "schedule_module.h"
+
+// Delay distributions, added to a nominal time in seconds
+constexpr uint8_t DELAY_FIXED = 0;          // No variation
+constexpr uint8_t DELAY_UNIFORM = 1;        // Uniform in [-spread, +spread]
+constexpr uint8_t DELAY_NORMAL = 2;         // Normal with standard deviation spread
+constexpr uint8_t DELAY_EXPONENTIAL = 3;    // Exponential with mean spread (late only)
+
+// Per-run metrics
+constexpr uint8_t MONTE_CARLO_BUNCHED_SECONDS = 0;  // Time with two same-direction trains on one LED
+constexpr uint8_t MONTE_CARLO_MIN_SPACING = 1;      // Closest same-direction trains, in LEDs
+constexpr uint8_t MONTE_CARLO_MEAN_DELAY = 2;       // Mean terminal arrival delay, seconds
+constexpr uint8_t MONTE_CARLO_MAX_DELAY = 3;        // Worst terminal arrival delay, seconds
+constexpr uint8_t MONTE_CARLO_METRIC_COUNT = 4;
+
+// Histogram resolution for percentiles
+#ifndef MONTE_CARLO_HISTOGRAM_BINS
+#define MONTE_CARLO_HISTOGRAM_BINS 1024
+#endif
+
+// Delays outside this range land in the end bins (exact minimum and maximum are still kept)
+constexpr int32_t MONTE_CARLO_DELAY_MIN_SECONDS = -1800;
+constexpr int32_t MONTE_CARLO_DELAY_MAX_SECONDS = 5400;
+
+/**
+ * Delay distribution for one kind of time
+ */
+struct DelayDistribution {
+    uint8_t type;             // DELAY_*
+    float spread;             // Seconds; meaning depends on type
+};
+
+/**
+ * Stochastic timing model
+ * Each draw is added to the nominal time; run times stay at least one
+ * second and dwells at least zero
+ */
+struct MonteCarloModel {
+    DelayDistribution departure;  // Origin departure of each trip
+    DelayDistribution runTime;    // Each segment's run time
+    DelayDistribution dwell;      // Each intermediate stop's dwell
+};
+
+/**
+ * Monte Carlo Summary structure
+ * Streaming summary of one metric over every run
+ */
+struct MonteCarloSummary {
+    uint32_t bins[MONTE_CARLO_HISTOGRAM_BINS];
+    float lowerBound;         // Value at the bottom of bin 0
+    float binWidth;
+    uint32_t count;           // Runs recorded
+    double sum;
+    float minimum;
+    float maximum;
+};
+
+/**
+ * Monte Carlo Simulator
+ * Runs a service-day window many times with trip timings drawn from a
+ * MonteCarloModel, and places every train with PositionEngine's placement
+ * and LED mapping, so bunching and spacing are what the display would show.
+ * Draws come from a counter-based generator keyed by (seed, run, trip, stop),
+ * so a run's outcome does not depend on which thread ran it or in what
+ * order. Runs are spread over worker threads; each run's metrics go into
+ * per-thread histograms that are merged at the end, so no run is stored.
+ */
+class MonteCarloSimulator {
+public:
+    MonteCarloSimulator();
+
+    /**
+     * Initialize the simulator
+     * The schedule is only read (each worker copies it) and must stay loaded while running
+     * @param scheduleModule Loaded schedule
+     */
+    void init(ScheduleModule* scheduleModule);
+
+    /**
+     * Set the timing model (default: every distribution DELAY_FIXED)
+     * @param model Timing model
+     */
+    void setModel(const MonteCarloModel& model) { model_ = model; }
+
+    /**
+     * Get the timing model
+     * @return Timing model
+     */
+    const MonteCarloModel& getModel() { return model_; }
+
+    /**
+     * Simulate a window of one service day many times
+     * Trips come from the service day containing start; the window should not
+     * extend past that day
+     * @param start First tick
+     * @param end End of the window (exclusive)
+     * @param step Seconds between ticks
+     * @param runCount Number of runs
+     * @param seed Seed; the same seed, model and window reproduce the same results
+     * @param threadCount Worker threads (0 = one per hardware thread)
+     * @return Number of threads used
+     */
+    uint16_t run(time_t start, time_t end, uint32_t step, uint32_t runCount, uint64_t seed, uint16_t threadCount);
+
+    /**
+     * Get the summary of a metric from the last run
+     * @param metric MONTE_CARLO_* metric
+     * @return Pointer to summary, or nullptr if out of range
+     */
+    const MonteCarloSummary* getSummary(uint8_t metric);
+
+    /**
+     * Get a percentile of a metric from the last run
+     * Interpolated within a histogram bin and clamped to the observed range
+     * @param metric MONTE_CARLO_* metric
+     * @param percentile Percentile (0 to 100)
+     * @return Metric value, 0 if nothing was recorded
+     */
+    float getPercentile(uint8_t metric, float percentile);
+
+    /**
+     * Draw one value from a distribution
+     * @param distribution Distribution
+     * @param stream Stream key (seed and run)
+     * @param counter Draw index within the stream
+     * @return Seconds to add to the nominal time
+     */
+    static float drawDelay(const DelayDistribution& distribution, uint64_t stream, uint64_t counter);
+
+private:
+    /**
+     * Worker loop: claim runs until none are left
+     * @param summaries Histograms for this thread, one per metric
+     */
+    void runWorker(MonteCarloSummary* summaries);
+
+    /**
+     * Reset one summary per metric to empty histograms over the window's ranges
+     * @param summaries Summaries, one per metric
+     */
+    void resetSummaries(MonteCarloSummary* summaries);
+
+    /**
+     * Reset a summary to an empty histogram over a range
+     * @param summary Summary to reset
+     * @param lowerBound Value at the bottom of bin 0
+     * @param upperBound Value at the top of the last bin
+     */
+    static void resetSummary(MonteCarloSummary* summary, float lowerBound, float upperBound);
+
+    /**
+     * Record one run's value
+     * @param summary Summary to update
+     * @param value Metric value
+     */
+    static void recordValue(MonteCarloSummary* summary, float value);
+
+    /**
+     * Fold one summary into another with the same bins
+     * @param target Summary to merge into
+     * @param source Summary to merge from
+     */
+    static void mergeSummary(MonteCarloSummary* target, const MonteCarloSummary& source);
+
+    /**
+     * Counter-based random bits: SplitMix64's finalizer over (stream, counter)
+     * @param stream Stream key
+     * @param counter Draw index
+     * @return 64 random bits
+     */
+    static uint64_t randomBits(uint64_t stream, uint64_t counter);
+
+    ScheduleModule* scheduleModule_;
+    MonteCarloModel model_;
+    MonteCarloSummary summaries_[MONTE_CARLO_METRIC_COUNT];
+
+    // Parameters of the run in progress, read-only while workers run
+    time_t start_;
+    time_t end_;
+    uint32_t step_;
+    uint32_t runCount_;
+    uint64_t seed_;
+    std::atomic<uint32_t> nextRun_;
+};
+
+#endif // MONTE_CARLO_H
@@ -0,0 +1,321 @@
+#include "position_kernel.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+PositionKernel::PositionKernel()
+    : stationCount_(0),
+      kernel_(getBestKernel()) {
+    routeTimes_[0] = 0;
+    routeTimes_[1] = 0;
+}
+
+bool PositionKernel::init(ScheduleModule* scheduleModule) {
+    stationCount_ = 0;
+    if (scheduleModule == nullptr || scheduleModule->getStationCount() > MAX_STATIONS) {
+        return false;
+    }
+    uint8_t stationCount = scheduleModule->getStationCount();
+
+    // Row 1 is northbound so a lane's direction mask selects its row directly
+    for (uint8_t direction = 0; direction < 2; direction++) {
+        const uint16_t* arrivals = scheduleModule->getArrivalOffsets(direction == 1);
+        const uint16_t* departures = scheduleModule->getDepartureOffsets(direction == 1);
+        for (uint8_t stop = 0; stop < stationCount; stop++) {
+            arrivals_[direction * MAX_STATIONS + stop] = arrivals[stop];
+            departures_[direction * MAX_STATIONS + stop] = departures[stop];
+        }
+        routeTimes_[direction] = arrivals[stationCount - 1];
+    }
+    for (uint8_t station = 0; station < stationCount; station++) {
+        stationLEDs_[station] = scheduleModule->getStation(station)->ledIndex;
+    }
+
+    stationCount_ = stationCount;
+    return true;
+}
+
+uint8_t PositionKernel::getBestKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return POSITION_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return POSITION_KERNEL_SSE41;
+    }
+#endif
+    return POSITION_KERNEL_SCALAR;
+}
+
+uint8_t PositionKernel::setKernel(uint8_t kernel) {
+    uint8_t best = getBestKernel();
+    kernel_ = (kernel > best) ? best : kernel;
+    return kernel_;
+}
+
+uint32_t PositionKernel::evaluate(int32_t currentSeconds, const int32_t* departureSeconds, const uint8_t* isNorthbound,
+                                  uint32_t count, uint8_t* stations, float* progress, uint8_t* leds) {
+    if (stationCount_ < 2) {
+        return 0;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernel_ == POSITION_KERNEL_AVX2) {
+        return evaluateAvx2(currentSeconds, departureSeconds, isNorthbound, count, stations, progress, leds);
+    }
+    if (kernel_ == POSITION_KERNEL_SSE41) {
+        return evaluateSse41(currentSeconds, departureSeconds, isNorthbound, count, stations, progress, leds);
+    }
+#endif
+    return evaluateScalar(currentSeconds, departureSeconds, isNorthbound, 0, count, stations, progress, leds);
+}
+
+uint32_t PositionKernel::evaluateScalar(int32_t currentSeconds, const int32_t* departureSeconds,
+                                        const uint8_t* isNorthbound, uint32_t begin, uint32_t end,
+                                        uint8_t* stations, float* progress, uint8_t* leds) {
+    // Same steps and arithmetic as PositionEngine::placeTrain() and addTrainPosition()
+    uint32_t activeCount = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        bool north = isNorthbound[i] != 0;
+        uint8_t direction = north ? 1 : 0;
+        int32_t elapsedSeconds = currentSeconds - departureSeconds[i];
+        if (elapsedSeconds < 0) {
+            elapsedSeconds = 0;
+        }
+
+        if (elapsedSeconds >= routeTimes_[direction]) {
+            stations[i] = POSITION_KERNEL_FINISHED;
+            progress[i] = 0.0f;
+            leds[i] = POSITION_KERNEL_FINISHED;
+            continue;
+        }
+
+        const int32_t* departureOffsets = departures_ + direction * MAX_STATIONS;
+        const int32_t* arrivalOffsets = arrivals_ + direction * MAX_STATIONS;
+        uint8_t low = 0;
+        uint8_t high = stationCount_ - 1;
+        while (high - low > 1) {
+            uint8_t mid = (low + high) / 2;
+            if (departureOffsets[mid] <= elapsedSeconds) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+
+        uint8_t fromStation = north ? low : (stationCount_ - 1 - low);
+        uint8_t toStation = north ? (fromStation + 1) : (fromStation - 1);
+        uint8_t currentStation = fromStation;
+        uint8_t nextStation = toStation;
+        float fraction = 0.0f;
+        if (elapsedSeconds >= arrivalOffsets[high]) {
+            currentStation = toStation;
+            nextStation = north ? (toStation + 1) : (toStation - 1);
+        } else {
+            fraction = (float)(elapsedSeconds - departureOffsets[low]) /
+                       (float)(arrivalOffsets[high] - departureOffsets[low]);
+        }
+
+        float currentLED = (float)stationLEDs_[currentStation];
+        float nextLED = (float)stationLEDs_[nextStation];
+        float interpolatedLED = currentLED + (nextLED - currentLED) * fraction;
+        uint8_t ledIndex = (uint8_t)(interpolatedLED + 0.5);
+        if (ledIndex > 99) ledIndex = 99;
+
+        stations[i] = currentStation;
+        progress[i] = fraction;
+        leds[i] = ledIndex;
+        activeCount++;
+    }
+    return activeCount;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1")))
+uint32_t PositionKernel::evaluateSse41(int32_t currentSeconds, const int32_t* departureSeconds,
+                                       const uint8_t* isNorthbound, uint32_t count,
+                                       uint8_t* stations, float* progress, uint8_t* leds) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i current = _mm_set1_epi32(currentSeconds);
+    const __m128i lastStation = _mm_set1_epi32(stationCount_ - 1);
+    const __m128i lastSearchStop = _mm_set1_epi32(stationCount_ - 2);
+    const __m128i maxLED = _mm_set1_epi32(99);
+    const __m128i finished = _mm_set1_epi32(POSITION_KERNEL_FINISHED);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    uint32_t activeCount = 0;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i departure = _mm_loadu_si128((const __m128i*)(departureSeconds + i));
+        int32_t directionBytes;
+        memcpy(&directionBytes, isNorthbound + i, 4);
+        __m128i north = _mm_cmpgt_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(directionBytes)), zero);
+        __m128i elapsed = _mm_max_epi32(_mm_sub_epi32(current, departure), zero);
+
+        __m128i routeTime = _mm_blendv_epi8(_mm_set1_epi32(routeTimes_[0]), _mm_set1_epi32(routeTimes_[1]), north);
+        __m128i active = _mm_cmpgt_epi32(routeTime, elapsed);
+
+        // Last stop departed: count the intermediate departures at or before the elapsed time.
+        // Offsets never decrease, so this equals the scalar binary search
+        __m128i lowSouth = lastSearchStop;
+        __m128i lowNorth = lastSearchStop;
+        for (uint8_t stop = 1; stop + 1 < stationCount_; stop++) {
+            lowSouth = _mm_add_epi32(lowSouth, _mm_cmpgt_epi32(_mm_set1_epi32(departures_[stop]), elapsed));
+            lowNorth = _mm_add_epi32(lowNorth,
+                                     _mm_cmpgt_epi32(_mm_set1_epi32(departures_[MAX_STATIONS + stop]), elapsed));
+        }
+        __m128i low = _mm_blendv_epi8(lowSouth, lowNorth, north);
+
+        // No gather before AVX2: look the offsets up lane by lane
+        alignas(16) int32_t lanes[4];
+        alignas(16) int32_t departureLow[4];
+        alignas(16) int32_t arrivalHigh[4];
+        _mm_store_si128((__m128i*)lanes, _mm_add_epi32(low, _mm_and_si128(north, _mm_set1_epi32(MAX_STATIONS))));
+        for (uint8_t lane = 0; lane < 4; lane++) {
+            departureLow[lane] = departures_[lanes[lane]];
+            arrivalHigh[lane] = arrivals_[lanes[lane] + 1];
+        }
+        __m128i departed = _mm_load_si128((const __m128i*)departureLow);
+        __m128i arrival = _mm_load_si128((const __m128i*)arrivalHigh);
+
+        __m128i step = _mm_blendv_epi8(_mm_set1_epi32(-1), one, north);
+        __m128i from = _mm_blendv_epi8(_mm_sub_epi32(lastStation, low), low, north);
+        __m128i to = _mm_add_epi32(from, step);
+        __m128i dwelling = _mm_xor_si128(_mm_cmpgt_epi32(arrival, elapsed), _mm_set1_epi32(-1));
+        __m128i station = _mm_and_si128(_mm_blendv_epi8(from, to, dwelling), active);
+        __m128i next = _mm_and_si128(_mm_blendv_epi8(to, _mm_add_epi32(to, step), dwelling), active);
+
+        __m128 fraction = _mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(elapsed, departed)),
+                                     _mm_cvtepi32_ps(_mm_sub_epi32(arrival, departed)));
+        fraction = _mm_andnot_ps(_mm_castsi128_ps(_mm_or_si128(dwelling, _mm_xor_si128(active, _mm_set1_epi32(-1)))),
+                                 fraction);
+
+        alignas(16) int32_t stationLanes[4];
+        alignas(16) int32_t nextLanes[4];
+        alignas(16) int32_t currentLEDs[4];
+        alignas(16) int32_t nextLEDs[4];
+        _mm_store_si128((__m128i*)stationLanes, station);
+        _mm_store_si128((__m128i*)nextLanes, next);
+        for (uint8_t lane = 0; lane < 4; lane++) {
+            currentLEDs[lane] = stationLEDs_[stationLanes[lane]];
+            nextLEDs[lane] = stationLEDs_[nextLanes[lane]];
+        }
+        __m128 currentLED = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)currentLEDs));
+        __m128 nextLED = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)nextLEDs));
+        __m128 interpolated = _mm_add_ps(currentLED, _mm_mul_ps(_mm_sub_ps(nextLED, currentLED), fraction));
+
+        // Round half up exactly as (uint8_t)(x + 0.5) in double: the fraction test avoids float rounding of x + 0.5
+        __m128i whole = _mm_cvttps_epi32(interpolated);
+        __m128 remainder = _mm_sub_ps(interpolated, _mm_cvtepi32_ps(whole));
+        __m128i led = _mm_sub_epi32(whole, _mm_castps_si128(_mm_cmpge_ps(remainder, half)));
+        led = _mm_min_epi32(led, maxLED);
+
+        station = _mm_blendv_epi8(finished, station, active);
+        led = _mm_blendv_epi8(finished, led, active);
+
+        alignas(16) int32_t stationOut[4];
+        alignas(16) int32_t ledOut[4];
+        _mm_store_si128((__m128i*)stationOut, station);
+        _mm_store_si128((__m128i*)ledOut, led);
+        _mm_storeu_ps(progress + i, fraction);
+        for (uint8_t lane = 0; lane < 4; lane++) {
+            stations[i + lane] = (uint8_t)stationOut[lane];
+            leds[i + lane] = (uint8_t)ledOut[lane];
+        }
+        activeCount += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(active)));
+    }
+
+    return activeCount + evaluateScalar(currentSeconds, departureSeconds, isNorthbound, i, count, stations, progress, leds);
+}
+
+__attribute__((target("avx2")))
+uint32_t PositionKernel::evaluateAvx2(int32_t currentSeconds, const int32_t* departureSeconds,
+                                      const uint8_t* isNorthbound, uint32_t count,
+                                      uint8_t* stations, float* progress, uint8_t* leds) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i allOnes = _mm256_set1_epi32(-1);
+    const __m256i current = _mm256_set1_epi32(currentSeconds);
+    const __m256i lastStation = _mm256_set1_epi32(stationCount_ - 1);
+    const __m256i lastSearchStop = _mm256_set1_epi32(stationCount_ - 2);
+    const __m256i maxLED = _mm256_set1_epi32(99);
+    const __m256i finished = _mm256_set1_epi32(POSITION_KERNEL_FINISHED);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // Gathers the low byte of each 32-bit lane into the first four bytes of each 128-bit half
+    const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    uint32_t activeCount = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i departure = _mm256_loadu_si256((const __m256i*)(departureSeconds + i));
+        __m256i north = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(isNorthbound + i))), zero);
+        __m256i elapsed = _mm256_max_epi32(_mm256_sub_epi32(current, departure), zero);
+
+        __m256i routeTime = _mm256_blendv_epi8(_mm256_set1_epi32(routeTimes_[0]), _mm256_set1_epi32(routeTimes_[1]), north);
+        __m256i active = _mm256_cmpgt_epi32(routeTime, elapsed);
+
+        // Last stop departed: count the intermediate departures at or before the elapsed time.
+        // Offsets never decrease, so this equals the scalar binary search
+        __m256i lowSouth = lastSearchStop;
+        __m256i lowNorth = lastSearchStop;
+        for (uint8_t stop = 1; stop + 1 < stationCount_; stop++) {
+            lowSouth = _mm256_add_epi32(lowSouth, _mm256_cmpgt_epi32(_mm256_set1_epi32(departures_[stop]), elapsed));
+            lowNorth = _mm256_add_epi32(lowNorth,
+                                        _mm256_cmpgt_epi32(_mm256_set1_epi32(departures_[MAX_STATIONS + stop]), elapsed));
+        }
+        __m256i low = _mm256_blendv_epi8(lowSouth, lowNorth, north);
+
+        __m256i row = _mm256_add_epi32(low, _mm256_and_si256(north, _mm256_set1_epi32(MAX_STATIONS)));
+        __m256i departed = _mm256_i32gather_epi32(departures_, row, 4);
+        __m256i arrival = _mm256_i32gather_epi32(arrivals_ + 1, row, 4);
+
+        __m256i step = _mm256_blendv_epi8(allOnes, one, north);
+        __m256i from = _mm256_blendv_epi8(_mm256_sub_epi32(lastStation, low), low, north);
+        __m256i to = _mm256_add_epi32(from, step);
+        __m256i dwelling = _mm256_xor_si256(_mm256_cmpgt_epi32(arrival, elapsed), allOnes);
+        __m256i station = _mm256_and_si256(_mm256_blendv_epi8(from, to, dwelling), active);
+        __m256i next = _mm256_and_si256(_mm256_blendv_epi8(to, _mm256_add_epi32(to, step), dwelling), active);
+
+        __m256 fraction = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(elapsed, departed)),
+                                        _mm256_cvtepi32_ps(_mm256_sub_epi32(arrival, departed)));
+        fraction = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_or_si256(dwelling, _mm256_xor_si256(active, allOnes))),
+                                    fraction);
+
+        __m256 currentLED = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(stationLEDs_, station, 4));
+        __m256 nextLED = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(stationLEDs_, next, 4));
+        __m256 interpolated = _mm256_add_ps(currentLED, _mm256_mul_ps(_mm256_sub_ps(nextLED, currentLED), fraction));
+
+        // Round half up exactly as (uint8_t)(x + 0.5) in double: the fraction test avoids float rounding of x + 0.5
+        __m256i whole = _mm256_cvttps_epi32(interpolated);
+        __m256 remainder = _mm256_sub_ps(interpolated, _mm256_cvtepi32_ps(whole));
+        __m256i led = _mm256_sub_epi32(whole, _mm256_castps_si256(_mm256_cmp_ps(remainder, half, _CMP_GE_OQ)));
+        led = _mm256_min_epi32(led, maxLED);
+
+        station = _mm256_blendv_epi8(finished, station, active);
+        led = _mm256_blendv_epi8(finished, led, active);
+
+        // Narrow the 32-bit lanes to bytes
+        __m256i stationBytes = _mm256_shuffle_epi8(station, lowBytes);
+        __m256i ledBytes = _mm256_shuffle_epi8(led, lowBytes);
+        uint32_t stationLow = (uint32_t)_mm256_extract_epi32(stationBytes, 0);
+        uint32_t stationHigh = (uint32_t)_mm256_extract_epi32(stationBytes, 4);
+        uint32_t ledLow = (uint32_t)_mm256_extract_epi32(ledBytes, 0);
+        uint32_t ledHigh = (uint32_t)_mm256_extract_epi32(ledBytes, 4);
+        memcpy(stations + i, &stationLow, 4);
+        memcpy(stations + i + 4, &stationHigh, 4);
+        memcpy(leds + i, &ledLow, 4);
+        memcpy(leds + i + 4, &ledHigh, 4);
+        _mm256_storeu_ps(progress + i, fraction);
+
+        activeCount += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(active)));
+    }
+
+    return activeCount + evaluateScalar(currentSeconds, departureSeconds, isNorthbound, i, count, stations, progress, leds);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef POSITION_KERNEL_H
+#define POSITION_KERNEL_H
+
+#include <cstdint>
+#include "schedule_module.h"
+
+// Kernel implementations, in order of preference
+constexpr uint8_t POSITION_KERNEL_SCALAR = 0;
+constexpr uint8_t POSITION_KERNEL_SSE41 = 1;
+constexpr uint8_t POSITION_KERNEL_AVX2 = 2;
+
+// Station and LED output for a train that is not on the line
+constexpr uint8_t POSITION_KERNEL_FINISHED = 0xFF;
+
+/**
+ * Position Kernel
+ * Batch form of PositionEngine's placement for host-side fleet simulation.
+ * Takes contiguous departure times and directions on the full-route patterns
+ * and fills contiguous station, progress and LED outputs. SSE4.1 and AVX2
+ * kernels are chosen at runtime when the CPU supports them; the scalar kernel
+ * is the portable fallback. Every kernel produces the same LED indices as
+ * PositionEngine, bit for bit.
+ */
+class PositionKernel {
+public:
+    PositionKernel();
+
+    /**
+     * Copy the full-route timing tables from a schedule
+     * Call again after the schedule loads different data
+     * @param scheduleModule Schedule with loaded line data
+     * @return false if the schedule is missing or has too many stations
+     */
+    bool init(ScheduleModule* scheduleModule);
+
+    /**
+     * Get the best kernel this CPU supports
+     * @return POSITION_KERNEL_SCALAR, POSITION_KERNEL_SSE41 or POSITION_KERNEL_AVX2
+     */
+    static uint8_t getBestKernel();
+
+    /**
+     * Select a kernel (e.g. to compare against the scalar path)
+     * Requests beyond what the CPU supports fall back to the best supported kernel
+     * @param kernel Requested kernel
+     * @return Kernel now in use
+     */
+    uint8_t setKernel(uint8_t kernel);
+
+    /**
+     * Get the kernel in use
+     * @return Kernel ID
+     */
+    uint8_t getKernel() { return kernel_; }
+
+    /**
+     * Place a batch of trains
+     * Times are seconds from any common origin (e.g. the service-day start).
+     * Trains that have not departed yet wait at their origin, as in PositionEngine.
+     * @param currentSeconds Current time
+     * @param departureSeconds Departure time of each train
+     * @param isNorthbound Direction of each train (nonzero = northbound)
+     * @param count Number of trains
+     * @param stations Output: station left (or dwelling at), POSITION_KERNEL_FINISHED once arrived
+     * @param progress Output: progress toward the next station (0.0 to 1.0)
+     * @param leds Output: LED index, POSITION_KERNEL_FINISHED once arrived
+     * @return Number of trains still on the line
+     */
+    uint32_t evaluate(int32_t currentSeconds, const int32_t* departureSeconds, const uint8_t* isNorthbound,
+                      uint32_t count, uint8_t* stations, float* progress, uint8_t* leds);
+
+private:
+    // Kernels fill [begin, end) and return the number of trains on the line
+    uint32_t evaluateScalar(int32_t currentSeconds, const int32_t* departureSeconds, const uint8_t* isNorthbound,
+                            uint32_t begin, uint32_t end, uint8_t* stations, float* progress, uint8_t* leds);
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t evaluateSse41(int32_t currentSeconds, const int32_t* departureSeconds, const uint8_t* isNorthbound,
+                           uint32_t count, uint8_t* stations, float* progress, uint8_t* leds);
+    uint32_t evaluateAvx2(int32_t currentSeconds, const int32_t* departureSeconds, const uint8_t* isNorthbound,
+                          uint32_t count, uint8_t* stations, float* progress, uint8_t* leds);
+#endif
+
+    // Full-route offsets by direction (0 = southbound, 1 = northbound) then stop
+    int32_t departures_[2 * MAX_STATIONS];
+    int32_t arrivals_[2 * MAX_STATIONS];
+    int32_t stationLEDs_[MAX_STATIONS];
+    int32_t routeTimes_[2];
+    uint8_t stationCount_;
+    uint8_t kernel_;
+};
+
+#endif // POSITION_KERNEL_H
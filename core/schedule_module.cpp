@@ -1,163 +1,130 @@
 #include "schedule_module.h"
+#include "timetable_blob.h"
 #include <iostream>
 
 ScheduleModule::ScheduleModule()
-    : stationCount_(0) {
+    : stations_(LINE_STATIONS),
+      stationCount_(LINE_STATION_COUNT),
+      segments_(LINE_SEGMENTS),
+      segmentCount_(LINE_STATION_COUNT - 1),
+      patterns_(LINE_PATTERNS),
+      patternCount_(2),
+      patternOffsets_(LINE_TRAVEL_TIMES.offsets),
+      timetable_(nullptr),
+      scheduleDayNumber_(INT32_MIN),
+      serviceSchedule_(nullptr) {
 }
 
 void ScheduleModule::loadSchedule() {
     std::cout << "[ScheduleModule] Loading Link Light Rail 1 Line schedule..." << std::endl;
 
-    // Total line distance: approximately 45 km from Lynnwood City Center to Angle Lake
-    // 100 LEDs (0-99) representing the full line
-
-    stationCount_ = 23;
-
-    // Evenly distribute 23 stations across 100 LEDs (0-99)
-    // Spacing: 99 / 22 = 4.5 LEDs per station interval
-    // We'll use integer spacing of approximately 4-5 LEDs
-
-    // Station 0: Lynnwood City Center
-    strncpy(stations_[0].name, "Lynnwood City Center", 31);
-    stations_[0].name[31] = '\0';
-    stations_[0].ledIndex = 0;
-    stations_[0].distanceFromStart = 0.0;
-
-    // Station 1: Mountlake Terrace
-    strncpy(stations_[1].name, "Mountlake Terrace", 31);
-    stations_[1].name[31] = '\0';
-    stations_[1].ledIndex = 4;
-    stations_[1].distanceFromStart = 3.0;
-
-    // Station 2: Shoreline North / 185th
-    strncpy(stations_[2].name, "Shoreline North/185th", 31);
-    stations_[2].name[31] = '\0';
-    stations_[2].ledIndex = 9;
-    stations_[2].distanceFromStart = 6.0;
-
-    // Station 3: Shoreline South / 148th
-    strncpy(stations_[3].name, "Shoreline South/148th", 31);
-    stations_[3].name[31] = '\0';
-    stations_[3].ledIndex = 13;
-    stations_[3].distanceFromStart = 8.0;
-
-    // Station 4: Northgate
-    strncpy(stations_[4].name, "Northgate", 31);
-    stations_[4].name[31] = '\0';
-    stations_[4].ledIndex = 18;
-    stations_[4].distanceFromStart = 10.0;
-
-    // Station 5: Roosevelt
-    strncpy(stations_[5].name, "Roosevelt", 31);
-    stations_[5].name[31] = '\0';
-    stations_[5].ledIndex = 22;
-    stations_[5].distanceFromStart = 12.4;
-
-    // Station 6: U District
-    strncpy(stations_[6].name, "U District", 31);
-    stations_[6].name[31] = '\0';
-    stations_[6].ledIndex = 27;
-    stations_[6].distanceFromStart = 13.8;
-
-    // Station 7: University of Washington
-    strncpy(stations_[7].name, "University of Washington", 31);
-    stations_[7].name[31] = '\0';
-    stations_[7].ledIndex = 31;
-    stations_[7].distanceFromStart = 15.2;
-
-    // Station 8: Capitol Hill
-    strncpy(stations_[8].name, "Capitol Hill", 31);
-    stations_[8].name[31] = '\0';
-    stations_[8].ledIndex = 36;
-    stations_[8].distanceFromStart = 17.5;
-
-    // Station 9: Westlake
-    strncpy(stations_[9].name, "Westlake", 31);
-    stations_[9].name[31] = '\0';
-    stations_[9].ledIndex = 40;
-    stations_[9].distanceFromStart = 19.8;
-
-    // Station 10: Symphony
-    strncpy(stations_[10].name, "Symphony", 31);
-    stations_[10].name[31] = '\0';
-    stations_[10].ledIndex = 45;
-    stations_[10].distanceFromStart = 20.5;
-
-    // Station 11: Pioneer Square
-    strncpy(stations_[11].name, "Pioneer Square", 31);
-    stations_[11].name[31] = '\0';
-    stations_[11].ledIndex = 49;
-    stations_[11].distanceFromStart = 21.2;
-
-    // Station 12: Int'l District / Chinatown
-    strncpy(stations_[12].name, "Intl Dist/Chinatown", 31);
-    stations_[12].name[31] = '\0';
-    stations_[12].ledIndex = 54;
-    stations_[12].distanceFromStart = 21.9;
-
-    // Station 13: Stadium
-    strncpy(stations_[13].name, "Stadium", 31);
-    stations_[13].name[31] = '\0';
-    stations_[13].ledIndex = 58;
-    stations_[13].distanceFromStart = 23.0;
-
-    // Station 14: SODO
-    strncpy(stations_[14].name, "SODO", 31);
-    stations_[14].name[31] = '\0';
-    stations_[14].ledIndex = 63;
-    stations_[14].distanceFromStart = 24.8;
-
-    // Station 15: Beacon Hill
-    strncpy(stations_[15].name, "Beacon Hill", 31);
-    stations_[15].name[31] = '\0';
-    stations_[15].ledIndex = 67;
-    stations_[15].distanceFromStart = 26.9;
-
-    // Station 16: Mount Baker
-    strncpy(stations_[16].name, "Mount Baker", 31);
-    stations_[16].name[31] = '\0';
-    stations_[16].ledIndex = 72;
-    stations_[16].distanceFromStart = 29.2;
-
-    // Station 17: Columbia City
-    strncpy(stations_[17].name, "Columbia City", 31);
-    stations_[17].name[31] = '\0';
-    stations_[17].ledIndex = 76;
-    stations_[17].distanceFromStart = 31.5;
-
-    // Station 18: Othello
-    strncpy(stations_[18].name, "Othello", 31);
-    stations_[18].name[31] = '\0';
-    stations_[18].ledIndex = 81;
-    stations_[18].distanceFromStart = 33.8;
-
-    // Station 19: Rainier Beach
-    strncpy(stations_[19].name, "Rainier Beach", 31);
-    stations_[19].name[31] = '\0';
-    stations_[19].ledIndex = 85;
-    stations_[19].distanceFromStart = 36.1;
-
-    // Station 20: Tukwila Int'l Blvd
-    strncpy(stations_[20].name, "Tukwila Intl Blvd", 31);
-    stations_[20].name[31] = '\0';
-    stations_[20].ledIndex = 90;
-    stations_[20].distanceFromStart = 40.0;
-
-    // Station 21: SeaTac / Airport
-    strncpy(stations_[21].name, "SeaTac/Airport", 31);
-    stations_[21].name[31] = '\0';
-    stations_[21].ledIndex = 94;
-    stations_[21].distanceFromStart = 43.0;
-
-    // Station 22: Angle Lake
-    strncpy(stations_[22].name, "Angle Lake", 31);
-    stations_[22].name[31] = '\0';
-    stations_[22].ledIndex = 99;
-    stations_[22].distanceFromStart = 45.0;
+    // Station data, segments and full-route patterns are compile-time tables (see line_data.h)
+    // They are read directly from flash, so there is nothing to copy here
+    stations_ = LINE_STATIONS;
+    stationCount_ = LINE_STATION_COUNT;
+    segments_ = LINE_SEGMENTS;
+    segmentCount_ = LINE_STATION_COUNT - 1;
+    patterns_ = LINE_PATTERNS;
+    patternCount_ = 2;
+    patternOffsets_ = LINE_TRAVEL_TIMES.offsets;
+    timetable_ = nullptr;
 
     std::cout << "[ScheduleModule] Loaded " << (int)stationCount_ << " stations" << std::endl;
 }
 
+bool ScheduleModule::loadSchedule(const TimetableBlob* timetable) {
+    if (timetable == nullptr || !timetable->isValid()) {
+        return false;
+    }
+
+    uint16_t stationCount = 0;
+    const Station* stations = timetable->getStations(&stationCount);
+    if (stations == nullptr || stationCount < 2 || stationCount > MAX_STATIONS) {
+        std::cout << "[ScheduleModule] Timetable has no usable station table" << std::endl;
+        return false;
+    }
+
+    // Patterns 0 and 1 hold the full-route travel time tables for each direction
+    uint16_t patternCount = 0;
+    uint32_t offsetCount = 0;
+    const ServicePattern* patterns = timetable->getPatterns(&patternCount);
+    const uint16_t* offsets = timetable->getPatternOffsets(&offsetCount);
+    if (patterns == nullptr || offsets == nullptr || patternCount < 2) {
+        std::cout << "[ScheduleModule] Timetable is missing full-route patterns" << std::endl;
+        return false;
+    }
+
+    // Every pattern must stay on the line and inside the offset pool
+    for (uint16_t i = 0; i < patternCount; i++) {
+        const ServicePattern& pattern = patterns[i];
+        bool onLine = pattern.stopCount >= 2 && pattern.firstStation < stationCount &&
+                      (pattern.isNorthbound ? pattern.firstStation + pattern.stopCount <= stationCount
+                                            : pattern.firstStation + 1 >= pattern.stopCount);
+        if (!onLine || pattern.offsetsIndex > offsetCount ||
+            2u * pattern.stopCount > offsetCount - pattern.offsetsIndex) {
+            std::cout << "[ScheduleModule] Timetable has an invalid service pattern" << std::endl;
+            return false;
+        }
+
+        // Stop times must not run backward: each arrival <= its departure <= the next arrival
+        const uint16_t* arrivals = offsets + pattern.offsetsIndex;
+        const uint16_t* departures = arrivals + pattern.stopCount;
+        for (uint8_t stop = 0; stop < pattern.stopCount; stop++) {
+            bool ordered = arrivals[stop] <= departures[stop] &&
+                           (stop + 1 == pattern.stopCount || departures[stop] <= arrivals[stop + 1]);
+            if (!ordered) {
+                std::cout << "[ScheduleModule] Timetable has an invalid service pattern" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    const ServicePattern& northbound = patterns[TIMETABLE_PATTERN_FULL_NORTHBOUND];
+    const ServicePattern& southbound = patterns[TIMETABLE_PATTERN_FULL_SOUTHBOUND];
+    bool northboundValid = northbound.isNorthbound && northbound.firstStation == 0 &&
+                           northbound.stopCount == stationCount;
+    bool southboundValid = !southbound.isNorthbound && southbound.firstStation == stationCount - 1 &&
+                           southbound.stopCount == stationCount;
+    if (!northboundValid || !southboundValid) {
+        std::cout << "[ScheduleModule] Timetable is missing full-route patterns" << std::endl;
+        return false;
+    }
+
+    // Segments are optional (run times are also in the full-route patterns), but must join adjacent stations
+    uint16_t segmentCount = 0;
+    const InterStationSegment* segments = timetable->getSegments(&segmentCount);
+    for (uint16_t i = 0; segments != nullptr && i < segmentCount; i++) {
+        uint8_t low = (segments[i].stationA < segments[i].stationB) ? segments[i].stationA : segments[i].stationB;
+        uint8_t high = (segments[i].stationA < segments[i].stationB) ? segments[i].stationB : segments[i].stationA;
+        if (high >= stationCount || high != low + 1) {
+            std::cout << "[ScheduleModule] Timetable has an invalid segment" << std::endl;
+            return false;
+        }
+    }
+
+    // Trips are optional, but TripTable and its window search rely on departure order
+    uint32_t tripCount = 0;
+    const TimetableTrip* trips = timetable->getTrips(&tripCount);
+    for (uint32_t i = 1; trips != nullptr && i < tripCount; i++) {
+        if (trips[i].departureSeconds < trips[i - 1].departureSeconds) {
+            std::cout << "[ScheduleModule] Timetable trips are not sorted by departure" << std::endl;
+            return false;
+        }
+    }
+
+    stations_ = stations;
+    stationCount_ = (uint8_t)stationCount;
+    segments_ = segments;
+    segmentCount_ = (segments != nullptr) ? segmentCount : 0;
+    patterns_ = patterns;
+    patternCount_ = patternCount;
+    patternOffsets_ = offsets;
+    timetable_ = timetable;
+
+    std::cout << "[ScheduleModule] Loaded " << (int)stationCount_ << " stations from timetable" << std::endl;
+    return true;
+}
+
 const Station* ScheduleModule::getStation(uint8_t index) {
     if (index >= stationCount_) {
         return nullptr;
@@ -165,10 +132,6 @@ const Station* ScheduleModule::getStation(uint8_t index) {
     return &stations_[index];
 }
 
-uint8_t ScheduleModule::getStationCount() {
-    return stationCount_;
-}
-
 uint16_t ScheduleModule::getTravelTime(uint8_t fromStation, uint8_t toStation) {
     // Validate station indices
     if (fromStation >= stationCount_ || toStation >= stationCount_) {
@@ -179,66 +142,131 @@ uint16_t ScheduleModule::getTravelTime(uint8_t fromStation, uint8_t toStation) {
         return 0;  // Same station
     }
 
-    // Calculate distance between stations
-    float distance = stations_[toStation].distanceFromStart - stations_[fromStation].distanceFromStart;
-    if (distance < 0) {
-        distance = -distance;  // Handle reverse direction
+    // Convert station indices to stop numbers in the direction of travel
+    uint8_t direction = (fromStation < toStation) ? 0 : 1;
+    uint8_t fromStop = (direction == 0) ? fromStation : (stationCount_ - 1 - fromStation);
+    uint8_t toStop = (direction == 0) ? toStation : (stationCount_ - 1 - toStation);
+
+    // Run time plus dwell at intermediate stations (not at either endpoint)
+    return getArrivalOffsets(direction == 0)[toStop] - getDepartureOffsets(direction == 0)[fromStop];
+}
+
+uint16_t ScheduleModule::getSegmentRunTime(uint8_t fromStation, uint8_t toStation) {
+    if (fromStation >= stationCount_ || toStation >= stationCount_) {
+        return 0;
+    }
+    if (toStation != fromStation + 1 && fromStation != toStation + 1) {
+        return 0;  // Not adjacent
+    }
+
+    // Prefer a segment in the direction of travel, then one recorded the other way
+    const InterStationSegment* reverse = nullptr;
+    for (uint16_t i = 0; i < segmentCount_; i++) {
+        if (segments_[i].stationA == fromStation && segments_[i].stationB == toStation) {
+            return segments_[i].travelTimeSeconds;
+        }
+        if (segments_[i].stationA == toStation && segments_[i].stationB == fromStation) {
+            reverse = &segments_[i];
+        }
+    }
+    if (reverse != nullptr) {
+        return reverse->travelTimeSeconds;
     }
 
-    // Average speed: ~35 km/h including stops
-    // This translates to approximately 1.7 minutes per km, or 102 seconds per km
-    const float SECONDS_PER_KM = 102.0;
+    // No segment table: adjacent stations have no dwell between them
+    return getTravelTime(fromStation, toStation);
+}
 
-    uint16_t travelTimeSeconds = (uint16_t)(distance * SECONDS_PER_KM);
+const InterStationSegment* ScheduleModule::getSegment(uint16_t index) {
+    if (index >= segmentCount_) {
+        return nullptr;
+    }
+    return &segments_[index];
+}
 
-    // Add minimum dwell time at intermediate stations (if traveling through multiple stations)
-    uint8_t intermediateStations = 0;
-    if (fromStation < toStation) {
-        intermediateStations = toStation - fromStation - 1;
-    } else {
-        intermediateStations = fromStation - toStation - 1;
+uint16_t ScheduleModule::getDwellTime(uint8_t station) {
+    if (station >= stationCount_) {
+        return 0;
     }
 
-    // Add 20 seconds per intermediate station for dwell time
-    const uint16_t DWELL_TIME_PER_STATION = 20;
-    travelTimeSeconds += intermediateStations * DWELL_TIME_PER_STATION;
+    // Dwell is the gap between arrival and departure in the northbound prefix sums
+    return getDepartureOffsets(true)[station] - getArrivalOffsets(true)[station];
+}
 
-    return travelTimeSeconds;
+uint16_t ScheduleModule::getRouteTime(bool isNorthbound) {
+    return getArrivalOffsets(isNorthbound)[stationCount_ - 1];
+}
+
+const uint16_t* ScheduleModule::getArrivalOffsets(bool isNorthbound) {
+    return getPatternArrivals(&patterns_[isNorthbound ? TIMETABLE_PATTERN_FULL_NORTHBOUND
+                                                      : TIMETABLE_PATTERN_FULL_SOUTHBOUND]);
+}
+
+const uint16_t* ScheduleModule::getDepartureOffsets(bool isNorthbound) {
+    return getPatternDepartures(&patterns_[isNorthbound ? TIMETABLE_PATTERN_FULL_NORTHBOUND
+                                                        : TIMETABLE_PATTERN_FULL_SOUTHBOUND]);
+}
+
+const ServicePattern* ScheduleModule::getPattern(uint16_t index) {
+    if (index >= patternCount_) {
+        return nullptr;
+    }
+    return &patterns_[index];
+}
+
+const TimetableTrip* ScheduleModule::getTimetableTrips(uint32_t* count) {
+    *count = 0;
+    if (timetable_ == nullptr) {
+        return nullptr;
+    }
+    return timetable_->getTrips(count);
 }
 
 const TrainSchedule* ScheduleModule::getCurrentSchedule(time_t currentTime) {
-    struct tm* timeinfo = localtime(&currentTime);
-    if (timeinfo == nullptr) {
-        // Return weekday schedule as default
-        static TrainSchedule weekdaySchedule = {
-            300,   // 5:00 AM (first train)
-            1500,  // 1:00 AM next day (25:00, or 1440 + 60)
-            10,    // 10 minute headway during peak
-            false  // weekday
-        };
-        return &weekdaySchedule;
+    clock_.update(currentTime);
+
+    // Consult the calendar once per service day
+    int32_t serviceDay = clock_.getServiceDayNumber();
+    if (serviceDay != scheduleDayNumber_) {
+        serviceSchedule_ = getServiceSchedule(calendar_.getServiceId(serviceDay));
+        scheduleDayNumber_ = serviceDay;
     }
+    return serviceSchedule_;
+}
 
-    int dayOfWeek = timeinfo->tm_wday;  // 0 = Sunday, 6 = Saturday
+const TrainSchedule* ScheduleModule::getServiceSchedule(uint8_t serviceId) {
+    if (serviceId == SERVICE_NONE) {
+        return nullptr;
+    }
 
     // Saturday schedule
-    if (dayOfWeek == 6) {
+    if (serviceId == SERVICE_SATURDAY) {
         static TrainSchedule saturdaySchedule = {
             330,   // 5:30 AM (first train)
             1470,  // 12:30 AM next day (24:30)
-            12,    // 12 minute headway
-            true   // weekend
+            12,    // 12 minute base headway (see bands)
+            true,  // weekend
+            15,    // Southbound starts 15 minutes after northbound
+            SERVICE_SATURDAY,
+            LINE_SATURDAY_BANDS,
+            LINE_SATURDAY_BAND_COUNT,
+            LINE_SATURDAY_BAND_MAP.band
         };
         return &saturdaySchedule;
     }
 
     // Sunday schedule
-    if (dayOfWeek == 0) {
+    if (serviceId == SERVICE_SUNDAY) {
         static TrainSchedule sundaySchedule = {
             360,   // 6:00 AM (first train)
             1440,  // 12:00 AM (midnight)
-            15,    // 15 minute headway
-            true   // weekend
+            15,    // 15 minute base headway (see bands)
+            true,  // weekend
+            15,    // Southbound starts 15 minutes after northbound
+            SERVICE_SUNDAY,
+            LINE_SUNDAY_BANDS,
+            LINE_SUNDAY_BAND_COUNT,
+            LINE_SUNDAY_BAND_MAP.band
         };
         return &sundaySchedule;
     }
@@ -247,18 +275,63 @@ const TrainSchedule* ScheduleModule::getCurrentSchedule(time_t currentTime) {
     static TrainSchedule weekdaySchedule = {
         300,   // 5:00 AM (first train)
         1500,  // 1:00 AM next day (25:00, or 1440 + 60)
-        10,    // 10 minute headway during peak
-        false  // weekday
+        10,    // 10 minute base headway (see bands)
+        false, // weekday
+        15,    // Southbound starts 15 minutes after northbound
+        SERVICE_WEEKDAY,
+        LINE_WEEKDAY_BANDS,
+        LINE_WEEKDAY_BAND_COUNT,
+        LINE_WEEKDAY_BAND_MAP.band
     };
     return &weekdaySchedule;
 }
 
-uint16_t ScheduleModule::getCurrentMinuteOfDay(time_t currentTime) {
-    struct tm* timeinfo = localtime(&currentTime);
-    if (timeinfo == nullptr) {
-        return 0;
+uint8_t ScheduleModule::getServiceId(time_t serviceDayStart) {
+    // Midday is clear of any DST shift between the cached day and this one
+    return calendar_.getServiceId(clock_.toDayNumber(serviceDayStart + 12 * 3600));
+}
+
+bool ScheduleModule::addServiceException(uint32_t date, uint8_t serviceId) {
+    scheduleDayNumber_ = INT32_MIN;  // Re-resolve the cached day on the next lookup
+    return calendar_.addException(date, serviceId);
+}
+
+void ScheduleModule::clearServiceExceptions() {
+    scheduleDayNumber_ = INT32_MIN;
+    calendar_.clearExceptions();
+}
+
+uint8_t ScheduleModule::getHeadwayMinutes(const TrainSchedule* schedule, uint16_t serviceMinutes) {
+    if (schedule->bands == nullptr || schedule->bandMap == nullptr) {
+        return schedule->headwayMinutes;
+    }
+
+    // After-midnight service minutes wrap onto the early clock minutes of the map
+    uint8_t band = schedule->bandMap[serviceMinutes % 1440];
+    if (band == LINE_NO_BAND) {
+        return schedule->headwayMinutes;
     }
-    return timeinfo->tm_hour * 60 + timeinfo->tm_min;
+    return schedule->bands[band].headwayMinutes;
+}
+
+uint16_t ScheduleModule::getCurrentMinuteOfDay(time_t currentTime) {
+    clock_.update(currentTime);
+    return clock_.getMinuteOfDay();
+}
+
+uint32_t ScheduleModule::getCurrentSecondOfDay(time_t currentTime) {
+    clock_.update(currentTime);
+    return clock_.getSecondOfDay();
+}
+
+time_t ScheduleModule::getServiceDayStart(time_t currentTime) {
+    clock_.update(currentTime);
+    return clock_.getServiceDayStart();
+}
+
+time_t ScheduleModule::getNextServiceDayStart(time_t currentTime) {
+    clock_.update(currentTime);
+    return clock_.getNextServiceDayStart();
 }
 
 bool ScheduleModule::isServiceHours(uint16_t minuteOfDay) {
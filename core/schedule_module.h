@@ -4,15 +4,12 @@
 #include <cstdint>
 #include <ctime>
 #include <cstring>
+#include "line_data.h"
+#include "service_calendar.h"
+#include "service_clock.h"
 
-/**
- * Station structure
- */
-struct Station {
-    char name[32];
-    uint8_t ledIndex;
-    float distanceFromStart;  // Kilometers
-};
+class TimetableBlob;
+struct TimetableTrip;
 
 /**
  * Train Schedule structure
@@ -20,17 +17,13 @@ struct Station {
 struct TrainSchedule {
     uint16_t firstTrainMinutes;   // Minutes since midnight
     uint16_t lastTrainMinutes;
-    uint8_t headwayMinutes;       // Time between trains
+    uint8_t headwayMinutes;       // Time between trains where no band applies
     bool isWeekend;
-};
-
-/**
- * Inter-station segment structure
- */
-struct InterStationSegment {
-    uint8_t stationA;
-    uint8_t stationB;
-    uint16_t travelTimeSeconds;
+    uint8_t southboundOffsetMinutes;  // Southbound stagger after the first northbound departure
+    uint8_t serviceId;            // Matches TimetableTrip::serviceId (0 = weekday, 1 = Saturday, 2 = Sunday)
+    const HeadwayBand* bands;     // Ordered by start time, nullptr for a single headway
+    uint8_t bandCount;
+    const uint8_t* bandMap;       // Minute of day -> band index (LINE_NO_BAND outside bands)
 };
 
 /**
@@ -42,10 +35,19 @@ public:
     ScheduleModule();
 
     /**
-     * Load schedule data
+     * Load compiled-in schedule data (see line_data.h)
      */
     void loadSchedule();
 
+    /**
+     * Load schedule data from a binary timetable
+     * Stations, patterns and trips are read in place from the blob,
+     * which must stay attached for as long as this module uses it
+     * @param timetable Validated timetable blob
+     * @return true if loaded, false if the blob lacks required data
+     */
+    bool loadSchedule(const TimetableBlob* timetable);
+
     /**
      * Get station by index
      * @param index Station index
@@ -57,23 +59,153 @@ public:
      * Get total number of stations
      * @return Station count
      */
-    uint8_t getStationCount();
+    uint8_t getStationCount() { return stationCount_; }
 
     /**
      * Get travel time between two stations
+     * Difference of the full-route prefix sums: run time plus dwell at intermediate stations
      * @param fromStation Starting station index
      * @param toStation Ending station index
      * @return Travel time in seconds
      */
     uint16_t getTravelTime(uint8_t fromStation, uint8_t toStation);
 
+    /**
+     * Get run time between adjacent stations, excluding dwell
+     * @param fromStation Starting station index
+     * @param toStation Adjacent station index (either direction)
+     * @return Run time in seconds, or 0 if the stations are not adjacent
+     */
+    uint16_t getSegmentRunTime(uint8_t fromStation, uint8_t toStation);
+
+    /**
+     * Get inter-station segment by index
+     * @param index Segment index
+     * @return Pointer to segment, or nullptr if out of range
+     */
+    const InterStationSegment* getSegment(uint16_t index);
+
+    /**
+     * Get number of inter-station segments
+     * @return Segment count
+     */
+    uint16_t getSegmentCount() { return segmentCount_; }
+
+    /**
+     * Get dwell time at a station
+     * @param station Station index
+     * @return Seconds a northbound train holds at the platform (0 at terminals)
+     */
+    uint16_t getDwellTime(uint8_t station);
+
+    /**
+     * Get end-to-end route time for a direction
+     * @param isNorthbound Direction of travel
+     * @return Seconds from origin departure to terminal arrival
+     */
+    uint16_t getRouteTime(bool isNorthbound);
+
+    /**
+     * Get cumulative arrival offsets for a direction
+     * Indexed by stop number in travel order (0 = origin terminal)
+     * @param isNorthbound Direction of travel
+     * @return Seconds from origin departure to arrival at each stop
+     */
+    const uint16_t* getArrivalOffsets(bool isNorthbound);
+
+    /**
+     * Get cumulative departure offsets for a direction
+     * Indexed by stop number in travel order (0 = origin terminal)
+     * @param isNorthbound Direction of travel
+     * @return Seconds from origin departure to departure from each stop
+     */
+    const uint16_t* getDepartureOffsets(bool isNorthbound);
+
+    /**
+     * Get service pattern by index
+     * Patterns 0 and 1 are the full route northbound and southbound
+     * @param index Pattern index
+     * @return Pointer to pattern, or nullptr if out of range
+     */
+    const ServicePattern* getPattern(uint16_t index);
+
+    /**
+     * Get number of service patterns
+     * @return Pattern count
+     */
+    uint16_t getPatternCount() { return patternCount_; }
+
+    /**
+     * Get a pattern's arrival offsets (stopCount entries, travel order)
+     * @param pattern Pattern from getPattern()
+     * @return Seconds from trip departure to arrival at each stop
+     */
+    const uint16_t* getPatternArrivals(const ServicePattern* pattern) {
+        return patternOffsets_ + pattern->offsetsIndex;
+    }
+
+    /**
+     * Get a pattern's departure offsets (stopCount entries, travel order)
+     * @param pattern Pattern from getPattern()
+     * @return Seconds from trip departure to departure from each stop
+     */
+    const uint16_t* getPatternDepartures(const ServicePattern* pattern) {
+        return patternOffsets_ + pattern->offsetsIndex + pattern->stopCount;
+    }
+
+    /**
+     * Get per-trip timetable loaded from a binary timetable
+     * @param count Output parameter for number of trips
+     * @return Pointer to trips sorted by departure, or nullptr if only headways are known
+     */
+    const TimetableTrip* getTimetableTrips(uint32_t* count);
+
     /**
      * Get current schedule based on time
+     * Resolved through the service calendar once per service day and cached,
+     * so after-midnight times get the previous day's schedule
      * @param currentTime Current time
-     * @return Pointer to schedule
+     * @return Pointer to schedule, or nullptr if no service runs that day
      */
     const TrainSchedule* getCurrentSchedule(time_t currentTime);
 
+    /**
+     * Get the schedule for a service ID
+     * @param serviceId Service ID (SERVICE_WEEKDAY, SERVICE_SATURDAY, SERVICE_SUNDAY)
+     * @return Pointer to schedule, or nullptr for SERVICE_NONE
+     */
+    const TrainSchedule* getServiceSchedule(uint8_t serviceId);
+
+    /**
+     * Get the service running on a service day
+     * @param serviceDayStart Local midnight of the service day (from getServiceDayStart())
+     * @return Service ID from the calendar
+     */
+    uint8_t getServiceId(time_t serviceDayStart);
+
+    /**
+     * Add a date exception to the service calendar
+     * Takes effect for service days looked up afterwards
+     * @param date Date as YYYYMMDD
+     * @param serviceId Service to run that day (SERVICE_NONE for none)
+     * @return false if the exception table is full
+     */
+    bool addServiceException(uint32_t date, uint8_t serviceId);
+
+    /**
+     * Remove all service calendar date exceptions
+     */
+    void clearServiceExceptions();
+
+    /**
+     * Get headway in effect at a point in the service day
+     * Constant time: a minute-of-day lookup into the schedule's band map
+     * @param schedule Schedule from getCurrentSchedule()
+     * @param serviceMinutes Minutes after service-day midnight (may exceed 1440)
+     * @return Headway in minutes
+     */
+    uint8_t getHeadwayMinutes(const TrainSchedule* schedule, uint16_t serviceMinutes);
+
     /**
      * Convert time to minutes since midnight
      * @param currentTime Current time
@@ -81,6 +213,29 @@ public:
      */
     uint16_t getCurrentMinuteOfDay(time_t currentTime);
 
+    /**
+     * Convert time to seconds since midnight
+     * @param currentTime Current time
+     * @return Seconds since midnight
+     */
+    uint32_t getCurrentSecondOfDay(time_t currentTime);
+
+    /**
+     * Get the start of the service day containing a time
+     * Trip departures are stored as seconds after the service day's midnight.
+     * Service days start at SERVICE_DAY_START_MINUTES (03:00)
+     * @param currentTime Current time
+     * @return Local midnight of the service day
+     */
+    time_t getServiceDayStart(time_t currentTime);
+
+    /**
+     * Get the start of the service day after the one containing a time
+     * @param currentTime Current time
+     * @return Local midnight of the next service day
+     */
+    time_t getNextServiceDayStart(time_t currentTime);
+
     /**
      * Check if currently in service hours
      * @param minuteOfDay Minutes since midnight
@@ -89,8 +244,27 @@ public:
     bool isServiceHours(uint16_t minuteOfDay);
 
 private:
-    Station stations_[23];  // Static allocation for 23 stations (Lynnwood City Center to Angle Lake)
+    // Line data, pointing either at the compiled-in tables or into a timetable blob
+    const Station* stations_;
     uint8_t stationCount_;
+
+    // Segment run times (dwell is folded into the pattern offsets)
+    const InterStationSegment* segments_;
+    uint16_t segmentCount_;
+
+    // Service patterns and their shared offset pool
+    const ServicePattern* patterns_;
+    uint16_t patternCount_;
+    const uint16_t* patternOffsets_;
+
+    const TimetableBlob* timetable_;  // nullptr when using compiled-in data
+
+    ServiceCalendar calendar_;
+    ServiceClock clock_;  // All local-time conversions go through here
+
+    // Schedule the calendar picked for the cached service day
+    int32_t scheduleDayNumber_;
+    const TrainSchedule* serviceSchedule_;
 };
 
 #endif // SCHEDULE_MODULE_H
@@ -0,0 +1,66 @@
+#ifndef SERVICE_CALENDAR_H
+#define SERVICE_CALENDAR_H
+
+#include <cstdint>
+#include "line_data.h"
+#include "service_clock.h"
+
+// Capacity for date-specific service exceptions
+#ifndef MAX_SERVICE_EXCEPTIONS
+#define MAX_SERVICE_EXCEPTIONS 32
+#endif
+
+/**
+ * Service exception: a specific date that runs a different service
+ */
+struct ServiceException {
+    uint32_t date;            // YYYYMMDD
+    uint8_t serviceId;        // SERVICE_NONE for no service
+};
+
+/**
+ * Service Calendar
+ * Resolves a service day's date to a service ID. Explicit date exceptions
+ * take precedence over the holiday rules in line_data.h, which take
+ * precedence over the weekday/Saturday/Sunday pattern.
+ */
+class ServiceCalendar {
+public:
+    ServiceCalendar();
+
+    /**
+     * Add (or replace) a date exception
+     * @param date Date as YYYYMMDD
+     * @param serviceId Service to run that day (SERVICE_NONE for none)
+     * @return false if the exception table is full
+     */
+    bool addException(uint32_t date, uint8_t serviceId);
+
+    /**
+     * Remove all date exceptions (holiday rules still apply)
+     */
+    void clearExceptions();
+
+    /**
+     * Get the service running on a date
+     * @param dayNumber Date as days since 1970-01-01 (see daysFromCivil())
+     * @return Service ID (SERVICE_NONE if no trains run)
+     */
+    uint8_t getServiceId(int32_t dayNumber);
+
+private:
+    /**
+     * Check a holiday rule against a date
+     * @param rule Holiday rule
+     * @param year Full year
+     * @param month 1-12
+     * @param day 1-31
+     * @return true if the rule falls on this date
+     */
+    bool matchesHoliday(const HolidayRule& rule, int32_t year, uint8_t month, uint8_t day);
+
+    ServiceException exceptions_[MAX_SERVICE_EXCEPTIONS];
+    uint8_t exceptionCount_;
+};
+
+#endif // SERVICE_CALENDAR_H
@@ -0,0 +1,188 @@
+#ifndef SERVICE_CLOCK_H
+#define SERVICE_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+#include "line_data.h"
+
+/**
+ * Days since 1970-01-01 for a proleptic Gregorian date
+ * Branch-light days-from-civil conversion; valid for any year that fits
+ * @param year Full year (e.g. 2025)
+ * @param month 1-12
+ * @param day 1-31
+ * @return Days since the Unix epoch (negative before 1970)
+ */
+constexpr int32_t daysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+    year -= (month <= 2) ? 1 : 0;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yearOfEra = (uint32_t)(year - era * 400);                              // [0, 399]
+    uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0, 365]
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;  // [0, 146096]
+    return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+/**
+ * Civil date for a day count from daysFromCivil()
+ * @param days Days since 1970-01-01
+ * @param year Output parameter for full year
+ * @param month Output parameter for month (1-12)
+ * @param day Output parameter for day of month (1-31)
+ */
+constexpr void civilFromDays(int32_t days, int32_t* year, uint8_t* month, uint8_t* day) {
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t dayOfEra = (uint32_t)(days - era * 146097);                                       // [0, 146096]
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;  // [0, 399]
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);      // [0, 365]
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153;                                           // [0, 11], March first
+    *day = (uint8_t)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    *month = (uint8_t)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    *year = (int32_t)yearOfEra + era * 400 + (*month <= 2 ? 1 : 0);
+}
+
+/**
+ * Day of week for a day count from daysFromCivil()
+ * @param days Days since 1970-01-01
+ * @return 0 = Sunday ... 6 = Saturday
+ */
+constexpr uint8_t weekdayFromDays(int32_t days) {
+    return (uint8_t)(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+}
+
+static_assert(daysFromCivil(1970, 1, 1) == 0, "Epoch must be day 0");
+static_assert(weekdayFromDays(daysFromCivil(2025, 10, 15)) == 3, "2025-10-15 is a Wednesday");
+
+/**
+ * Service Clock
+ * Decomposes epoch time into local civil time for the schedule. The UTC
+ * offset and the day's midnights are resolved with localtime() once per
+ * local day (plus a short search on DST-change days); every other update
+ * within the day is integer arithmetic.
+ */
+class ServiceClock {
+public:
+    ServiceClock();
+
+    /**
+     * Move the clock to a time
+     * O(1) while the time stays within the cached local day
+     * @param currentTime Current time
+     */
+    void update(time_t currentTime);
+
+    /**
+     * Get the time of the last update
+     * @return Epoch time
+     */
+    time_t getTime() { return time_; }
+
+    /**
+     * Get local seconds since midnight
+     * @return Seconds since midnight (wall clock)
+     */
+    uint32_t getSecondOfDay() { return secondOfDay_; }
+
+    /**
+     * Get local minutes since midnight
+     * @return Minutes since midnight (wall clock)
+     */
+    uint16_t getMinuteOfDay() { return (uint16_t)(secondOfDay_ / 60); }
+
+    /**
+     * Get the local date as days since 1970-01-01
+     * @return Day number
+     */
+    int32_t getDayNumber() { return dayNumber_; }
+
+    /**
+     * Get the local day of week
+     * @return 0 = Sunday ... 6 = Saturday
+     */
+    uint8_t getWeekday() { return weekday_; }
+
+    /**
+     * Get the local calendar date
+     * @param year Output parameter for full year
+     * @param month Output parameter for month (1-12)
+     * @param day Output parameter for day of month
+     */
+    void getDate(int32_t* year, uint8_t* month, uint8_t* day);
+
+    /**
+     * Get local midnight of the current date
+     * @return Epoch time
+     */
+    time_t getMidnight() { return midnight_; }
+
+    /**
+     * Get the service day's date (before SERVICE_DAY_START_MINUTES it is yesterday)
+     * @return Day number of the service day
+     */
+    int32_t getServiceDayNumber() {
+        return (secondOfDay_ < SERVICE_DAY_START_MINUTES * 60u) ? dayNumber_ - 1 : dayNumber_;
+    }
+
+    /**
+     * Get local midnight of the service day
+     * @return Epoch time
+     */
+    time_t getServiceDayStart() {
+        return (secondOfDay_ < SERVICE_DAY_START_MINUTES * 60u) ? previousMidnight_ : midnight_;
+    }
+
+    /**
+     * Get local midnight of the service day after this one
+     * @return Epoch time
+     */
+    time_t getNextServiceDayStart() {
+        return (secondOfDay_ < SERVICE_DAY_START_MINUTES * 60u) ? midnight_ : nextMidnight_;
+    }
+
+    /**
+     * Get the local date of any time, using the cached UTC offset
+     * Exact within the cached day; elsewhere may be off by a DST hour,
+     * so pass a time away from midnight (e.g. noon) for other days
+     * @param time Epoch time
+     * @return Day number
+     */
+    int32_t toDayNumber(time_t time);
+
+private:
+    /**
+     * Resolve the local day containing a time (calls localtime())
+     * @param currentTime Time inside the day to cache
+     */
+    void refreshDay(time_t currentTime);
+
+    /**
+     * UTC offset in effect at a time
+     * @param time Epoch time
+     * @return Local time minus UTC, in seconds
+     */
+    int32_t utcOffsetAt(time_t time);
+
+    /**
+     * Epoch time of local midnight on a date
+     * @param dayNumber Days since 1970-01-01
+     * @return Epoch time
+     */
+    time_t localMidnight(int32_t dayNumber);
+
+    time_t time_;
+    uint32_t secondOfDay_;
+
+    // Cached local day
+    int32_t dayNumber_;
+    uint8_t weekday_;
+    time_t previousMidnight_;
+    time_t midnight_;
+    time_t nextMidnight_;
+
+    // UTC offset before and after the day's DST change (same if none)
+    int32_t offsetBefore_;
+    int32_t offsetAfter_;
+    time_t offsetChange_;
+};
+
+#endif // SERVICE_CLOCK_H
@@ -0,0 +1,159 @@
+#include "sweep_runner.h"
+#include "trajectory_simulator.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+SweepRunner::SweepRunner()
+    : scenarioCount_(0),
+      firstNoon_(0),
+      dayCount_(0),
+      step_(1),
+      nextItem_(0) {
+}
+
+int16_t SweepRunner::addScenario(ScheduleModule* scheduleModule, uint16_t fleetLimit) {
+    if (scheduleModule == nullptr || scenarioCount_ >= MAX_SWEEP_SCENARIOS) {
+        return -1;
+    }
+    schedules_[scenarioCount_] = scheduleModule;
+    fleetLimits_[scenarioCount_] = fleetLimit;
+    results_[scenarioCount_] = SweepResult();
+    return (int16_t)scenarioCount_++;
+}
+
+void SweepRunner::clearScenarios() {
+    scenarioCount_ = 0;
+}
+
+uint16_t SweepRunner::run(time_t firstDay, uint16_t dayCount, uint32_t step, uint16_t threadCount) {
+    for (uint16_t i = 0; i < scenarioCount_; i++) {
+        results_[i] = SweepResult();
+    }
+    uint32_t itemCount = (uint32_t)scenarioCount_ * dayCount;
+    if (itemCount == 0 || step == 0) {
+        return 0;
+    }
+
+    // Day boundaries are found from noon, which no DST change can move to another day
+    struct tm dayInfo;
+    localtime_r(&firstDay, &dayInfo);
+    dayInfo.tm_hour = 12;
+    dayInfo.tm_min = 0;
+    dayInfo.tm_sec = 0;
+    dayInfo.tm_isdst = -1;
+    firstNoon_ = mktime(&dayInfo);
+    dayCount_ = dayCount;
+    step_ = step;
+    nextItem_.store(0);
+
+    if (threadCount == 0) {
+        threadCount = (uint16_t)std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+    if (threadCount > itemCount) {
+        threadCount = (uint16_t)itemCount;
+    }
+
+    // One accumulator per scenario per thread; no sharing until the merge
+    std::vector<std::vector<SweepResult>> threadResults(threadCount, std::vector<SweepResult>(scenarioCount_));
+    std::vector<std::thread> workers;
+    for (uint16_t t = 1; t < threadCount; t++) {
+        workers.emplace_back(&SweepRunner::runWorker, this, threadResults[t].data());
+    }
+    runWorker(threadResults[0].data());
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (uint16_t t = 0; t < threadCount; t++) {
+        for (uint16_t i = 0; i < scenarioCount_; i++) {
+            mergeResult(&results_[i], threadResults[t][i]);
+        }
+    }
+    return threadCount;
+}
+
+const SweepResult* SweepRunner::getResult(uint16_t scenario) {
+    if (scenario >= scenarioCount_) {
+        return nullptr;
+    }
+    return &results_[scenario];
+}
+
+void SweepRunner::runWorker(SweepResult* results) {
+    // This thread's schedule view and engine, reloaded when it moves to another scenario
+    ScheduleModule schedule;
+    std::unique_ptr<TrajectorySimulator> simulator(new TrajectorySimulator());
+    simulator->getEngine()->setLogging(false);
+    int32_t loadedScenario = -1;
+
+    // Train counts for one service day; DST days run up to 25 hours
+    uint32_t capacity = TrajectorySimulator::getTickCount(0, 25 * 3600, step_);
+    std::vector<uint16_t> trainCounts(capacity);
+    TrajectoryBuffer buffer = {trainCounts.data(), nullptr, nullptr, nullptr, capacity, 0};
+
+    uint32_t itemCount = (uint32_t)scenarioCount_ * dayCount_;
+    while (true) {
+        uint32_t item = nextItem_.fetch_add(1, std::memory_order_relaxed);
+        if (item >= itemCount) {
+            break;
+        }
+        uint16_t scenario = (uint16_t)(item / dayCount_);
+        uint16_t day = (uint16_t)(item % dayCount_);
+
+        if (scenario != loadedScenario) {
+            // Copy: the service clock inside a schedule caches per-call state
+            schedule = *schedules_[scenario];
+            simulator->init(&schedule);
+            loadedScenario = scenario;
+        }
+        PositionEngine* engine = simulator->getEngine();
+        uint32_t overflowBefore = engine->getOverflowCount();
+
+        time_t noon = firstNoon_ + (time_t)day * 86400;
+        time_t dayStart = schedule.getServiceDayStart(noon) + SERVICE_DAY_START_MINUTES * 60;
+        time_t dayEnd = schedule.getNextServiceDayStart(noon) + SERVICE_DAY_START_MINUTES * 60;
+        uint32_t ticks = simulator->simulateRange(dayStart, dayEnd, step_, &buffer);
+
+        SweepResult* result = &results[scenario];
+        uint16_t fleetLimit = fleetLimits_[scenario];
+        bool overLimit = false;
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            uint16_t count = trainCounts[tick];
+            result->trainSeconds += (uint64_t)count * step_;
+            if (count > fleetLimit) {
+                result->secondsOverLimit += step_;
+                overLimit = true;
+            }
+            if (count > result->peakTrains) {
+                result->peakTrains = count;
+                result->peakTime = dayStart + (time_t)tick * step_;
+            }
+        }
+        if (overLimit) {
+            result->daysOverLimit++;
+        }
+        result->overflowCount += engine->getOverflowCount() - overflowBefore;
+        result->daysSimulated++;
+    }
+}
+
+void SweepRunner::mergeResult(SweepResult* target, const SweepResult& source) {
+    if (source.daysSimulated == 0) {
+        return;
+    }
+    // Ties go to the earlier time, as if one thread had run every day in order
+    if (target->daysSimulated == 0 || source.peakTrains > target->peakTrains ||
+        (source.peakTrains == target->peakTrains && source.peakTime < target->peakTime)) {
+        target->peakTrains = source.peakTrains;
+        target->peakTime = source.peakTime;
+    }
+    target->daysOverLimit += source.daysOverLimit;
+    target->secondsOverLimit += source.secondsOverLimit;
+    target->trainSeconds += source.trainSeconds;
+    target->overflowCount += source.overflowCount;
+    target->daysSimulated += source.daysSimulated;
+}
@@ -0,0 +1,105 @@
+#ifndef SWEEP_RUNNER_H
+#define SWEEP_RUNNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include "schedule_module.h"
+
+// Scenario capacity of one sweep
+#ifndef MAX_SWEEP_SCENARIOS
+#define MAX_SWEEP_SCENARIOS 64
+#endif
+
+/**
+ * Sweep Result structure
+ * Fleet statistics for one scenario over every simulated service day
+ */
+struct SweepResult {
+    uint16_t peakTrains;        // Most trains on the line at any tick
+    time_t peakTime;            // Earliest tick at the peak (0 if no train ran)
+    uint32_t daysOverLimit;     // Service days with any tick above the fleet limit
+    uint64_t secondsOverLimit;  // Simulated seconds above the fleet limit
+    uint64_t trainSeconds;      // Trains on the line integrated over time
+    uint32_t overflowCount;     // Trips dropped for lack of train slots (MAX_TRAINS)
+    uint32_t daysSimulated;
+};
+
+/**
+ * Sweep Runner
+ * Capacity-planning sweeps over many service days and candidate schedules on
+ * all cores. Each (scenario, service day) pair is one work item; worker
+ * threads claim items as they finish the last, each with its own copy of the
+ * scenario's schedule and its own engine, and keep per-thread accumulators
+ * that are merged once every worker is done.
+ */
+class SweepRunner {
+public:
+    SweepRunner();
+
+    /**
+     * Add a scenario
+     * The schedule is only read (each worker copies it) and must stay loaded until run() returns
+     * @param scheduleModule Loaded schedule
+     * @param fleetLimit Trains the scenario must not exceed
+     * @return Scenario index, or -1 if MAX_SWEEP_SCENARIOS are already added
+     */
+    int16_t addScenario(ScheduleModule* scheduleModule, uint16_t fleetLimit);
+
+    /**
+     * Remove all scenarios and results
+     */
+    void clearScenarios();
+
+    /**
+     * Get the number of scenarios
+     * @return Scenario count
+     */
+    uint16_t getScenarioCount() { return scenarioCount_; }
+
+    /**
+     * Simulate every scenario over consecutive service days
+     * Each service day runs from SERVICE_DAY_START_MINUTES to the same time
+     * on the next calendar day, so consecutive days cover time exactly once
+     * @param firstDay Any time on the calendar day of the first service day
+     * @param dayCount Number of service days
+     * @param step Seconds between ticks
+     * @param threadCount Worker threads (0 = one per hardware thread)
+     * @return Number of threads used
+     */
+    uint16_t run(time_t firstDay, uint16_t dayCount, uint32_t step, uint16_t threadCount);
+
+    /**
+     * Get the result of the last run for a scenario
+     * @param scenario Scenario index
+     * @return Pointer to result, or nullptr if out of range
+     */
+    const SweepResult* getResult(uint16_t scenario);
+
+private:
+    /**
+     * Worker loop: claim work items until none are left
+     * @param results Accumulators for this thread, one per scenario
+     */
+    void runWorker(SweepResult* results);
+
+    /**
+     * Fold one accumulator into another
+     * @param target Accumulator to merge into
+     * @param source Accumulator to merge from
+     */
+    static void mergeResult(SweepResult* target, const SweepResult& source);
+
+    ScheduleModule* schedules_[MAX_SWEEP_SCENARIOS];
+    uint16_t fleetLimits_[MAX_SWEEP_SCENARIOS];
+    SweepResult results_[MAX_SWEEP_SCENARIOS];
+    uint16_t scenarioCount_;
+
+    // Parameters of the run in progress, read-only while workers run
+    time_t firstNoon_;          // Noon of the first calendar day, clear of DST changes
+    uint16_t dayCount_;
+    uint32_t step_;
+    std::atomic<uint32_t> nextItem_;  // Next work item to claim (scenario-major)
+};
+
+#endif // SWEEP_RUNNER_H
@@ -0,0 +1,190 @@
+#include "timetable_blob.h"
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint32_t timetableChecksum(const uint8_t* data, uint32_t length) {
+    // Nibble-wise CRC-32 (reflected polynomial 0xEDB88320)
+    // 16-entry table keeps it small enough for flash on the ESP32
+    static const uint32_t CRC_TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+TimetableBlob::TimetableBlob()
+    : data_(nullptr),
+      size_(0),
+      mapping_(nullptr),
+      mappingSize_(0) {
+}
+
+TimetableBlob::~TimetableBlob() {
+    close();
+}
+
+bool TimetableBlob::attach(const uint8_t* data, uint32_t size) {
+    data_ = nullptr;
+    size_ = 0;
+
+    if (data == nullptr || size < sizeof(TimetableHeader)) {
+        return false;
+    }
+
+    const TimetableHeader* header = reinterpret_cast<const TimetableHeader*>(data);
+    if (header->magic != TIMETABLE_MAGIC) {
+        std::cout << "[TimetableBlob] Bad magic" << std::endl;
+        return false;
+    }
+    if (header->version != TIMETABLE_VERSION) {
+        std::cout << "[TimetableBlob] Unsupported version " << header->version << std::endl;
+        return false;
+    }
+    if (header->totalSize > size || header->totalSize < sizeof(TimetableHeader)) {
+        std::cout << "[TimetableBlob] Truncated blob" << std::endl;
+        return false;
+    }
+
+    // Index header must fit
+    uint32_t indexEnd = sizeof(TimetableHeader) + header->sectionCount * sizeof(TimetableSection);
+    if (indexEnd > header->totalSize) {
+        std::cout << "[TimetableBlob] Section index out of range" << std::endl;
+        return false;
+    }
+
+    uint32_t checksum = timetableChecksum(data + sizeof(TimetableHeader),
+                                          header->totalSize - sizeof(TimetableHeader));
+    if (checksum != header->checksum) {
+        std::cout << "[TimetableBlob] Checksum mismatch" << std::endl;
+        return false;
+    }
+
+    // Every section payload must be aligned and inside the blob
+    const TimetableSection* sections = reinterpret_cast<const TimetableSection*>(data + sizeof(TimetableHeader));
+    for (uint16_t i = 0; i < header->sectionCount; i++) {
+        uint64_t end = (uint64_t)sections[i].offset + (uint64_t)sections[i].count * sections[i].recordSize;
+        if (sections[i].offset < indexEnd || (sections[i].offset & 3) != 0 || end > header->totalSize) {
+            std::cout << "[TimetableBlob] Section " << sections[i].type << " out of range" << std::endl;
+            return false;
+        }
+    }
+
+    data_ = data;
+    size_ = header->totalSize;
+    return true;
+}
+
+bool TimetableBlob::openFile(const char* path) {
+    close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "[TimetableBlob] Cannot open " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 || (uint64_t)info.st_size > 0xFFFFFFFFu) {
+        ::close(fd);
+        return false;
+    }
+
+    // Map read-only; the mapping stays valid after the descriptor is closed
+    void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "[TimetableBlob] mmap failed for " << path << std::endl;
+        return false;
+    }
+
+    mapping_ = mapping;
+    mappingSize_ = (uint32_t)info.st_size;
+
+    if (!attach(static_cast<const uint8_t*>(mapping), mappingSize_)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TimetableBlob::close() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+        mappingSize_ = 0;
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool TimetableBlob::isValid() const {
+    return data_ != nullptr;
+}
+
+const Station* TimetableBlob::getStations(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_STATIONS, sizeof(Station), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const Station*>(section);
+}
+
+const InterStationSegment* TimetableBlob::getSegments(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_SEGMENTS, sizeof(InterStationSegment), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const InterStationSegment*>(section);
+}
+
+const ServicePattern* TimetableBlob::getPatterns(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_PATTERNS, sizeof(ServicePattern), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const ServicePattern*>(section);
+}
+
+const uint16_t* TimetableBlob::getPatternOffsets(uint32_t* count) const {
+    return static_cast<const uint16_t*>(
+        findSection(TIMETABLE_SECTION_PATTERN_OFFSETS, sizeof(uint16_t), 0xFFFFFFFF, count));
+}
+
+const TimetableTrip* TimetableBlob::getTrips(uint32_t* count) const {
+    return static_cast<const TimetableTrip*>(
+        findSection(TIMETABLE_SECTION_TRIPS, sizeof(TimetableTrip), 0xFFFFFFFF, count));
+}
+
+const void* TimetableBlob::findSection(uint32_t type, uint32_t recordSize, uint32_t maxCount,
+                                       uint32_t* count) const {
+    *count = 0;
+    if (data_ == nullptr) {
+        return nullptr;
+    }
+
+    const TimetableHeader* header = reinterpret_cast<const TimetableHeader*>(data_);
+    const TimetableSection* sections = reinterpret_cast<const TimetableSection*>(data_ + sizeof(TimetableHeader));
+
+    for (uint16_t i = 0; i < header->sectionCount; i++) {
+        if (sections[i].type == type) {
+            if (sections[i].recordSize != recordSize) {
+                return nullptr;  // Written by an incompatible tool
+            }
+            if (sections[i].count > maxCount) {
+                return nullptr;  // More records than the caller's count type holds
+            }
+            *count = sections[i].count;
+            return data_ + sections[i].offset;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,87 @@
+#ifndef TIMETABLE_FORMAT_H
+#define TIMETABLE_FORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include "schedule_module.h"
+
+/**
+ * Binary timetable format
+ *
+ * A single position-independent, little-endian blob that the host maps
+ * with mmap() and the ESP32 maps straight out of a flash partition.
+ * Records are read in place, so every struct here is fixed-size with
+ * explicit padding and all references are byte offsets from the start
+ * of the blob or indices into another section.
+ *
+ * Layout:
+ *   TimetableHeader
+ *   TimetableSection[sectionCount]   (index header)
+ *   section payloads, each 4-byte aligned
+ */
+
+constexpr uint32_t TIMETABLE_MAGIC = 0x4B4E4C31;   // "1LNK" in little-endian byte order
+constexpr uint16_t TIMETABLE_VERSION = 1;
+
+// Section types
+constexpr uint32_t TIMETABLE_SECTION_STATIONS = 1;         // Station[count]
+constexpr uint32_t TIMETABLE_SECTION_SEGMENTS = 2;         // InterStationSegment[count]
+constexpr uint32_t TIMETABLE_SECTION_PATTERNS = 3;         // ServicePattern[count]
+constexpr uint32_t TIMETABLE_SECTION_PATTERN_OFFSETS = 4;  // uint16_t[count]
+constexpr uint32_t TIMETABLE_SECTION_TRIPS = 5;            // TimetableTrip[count]
+
+// Patterns 0 and 1 always cover the full line, northbound then southbound
+constexpr uint16_t TIMETABLE_PATTERN_FULL_NORTHBOUND = 0;
+constexpr uint16_t TIMETABLE_PATTERN_FULL_SOUTHBOUND = 1;
+
+/**
+ * Blob header
+ */
+struct TimetableHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sectionCount;
+    uint32_t totalSize;       // Bytes, including this header
+    uint32_t checksum;        // CRC-32 of bytes [sizeof(TimetableHeader), totalSize)
+};
+
+/**
+ * Section index entry
+ */
+struct TimetableSection {
+    uint32_t type;
+    uint32_t offset;          // Bytes from start of blob
+    uint32_t count;           // Number of records
+    uint32_t recordSize;      // Bytes per record
+};
+
+/**
+ * Scheduled trip
+ * Trips are sorted by departureSeconds within the section.
+ */
+struct TimetableTrip {
+    uint32_t departureSeconds;  // Seconds after service-day midnight (may exceed 86400)
+    uint16_t pattern;           // Index into PATTERNS
+    uint8_t serviceId;          // 0 = weekday, 1 = Saturday, 2 = Sunday
+    uint8_t reserved;
+};
+
+// The blob is read in place on both targets, so layouts must not drift
+static_assert(sizeof(TimetableHeader) == 16, "TimetableHeader layout changed");
+static_assert(sizeof(TimetableSection) == 16, "TimetableSection layout changed");
+static_assert(sizeof(ServicePattern) == 8, "ServicePattern layout changed");
+static_assert(sizeof(TimetableTrip) == 8, "TimetableTrip layout changed");
+static_assert(sizeof(InterStationSegment) == 4, "InterStationSegment layout changed");
+static_assert(sizeof(Station) == 40 && offsetof(Station, ledIndex) == 32 &&
+              offsetof(Station, distanceFromStart) == 36, "Station layout changed");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Timetable blobs are little-endian");
+
+/**
+ * Compute the CRC-32 (IEEE) used for the header checksum
+ * @param data Bytes to checksum
+ * @param length Number of bytes
+ * @return CRC-32 value
+ */
+uint32_t timetableChecksum(const uint8_t* data, uint32_t length);
+
+#endif // TIMETABLE_FORMAT_H
@@ -0,0 +1,126 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cstdint>
+
+// Wheel geometry: 6 levels of 64 slots cover the whole 32-bit time range
+constexpr uint8_t TIMING_WHEEL_LEVELS = 6;
+constexpr uint8_t TIMING_WHEEL_SLOT_BITS = 6;
+constexpr uint8_t TIMING_WHEEL_SLOTS = 1 << TIMING_WHEEL_SLOT_BITS;
+
+// Null timer index, for list links and empty slots
+constexpr uint16_t TIMER_NONE = 0xFFFF;
+
+/**
+ * Timer Node structure
+ * One timer's entry in the wheel; the caller owns the array and a timer's
+ * ID is its index in it
+ */
+struct TimerNode {
+    uint32_t expiry;          // Time the timer fires
+    uint16_t next;            // Neighbours in the slot's list (TIMER_NONE at the ends)
+    uint16_t prev;
+    uint8_t level;            // Level holding the timer, TIMING_WHEEL_LEVELS when not scheduled
+    uint8_t slot;
+};
+
+/**
+ * Timing Wheel
+ * Hierarchical timing wheel over 32-bit times (the engine uses milliseconds).
+ * Level n holds timers that agree with the wheel's time above its 6-bit digit;
+ * when the lower levels run dry, the next occupied slot one level up is
+ * spread over the levels below. Each level keeps a 64-bit occupancy mask, so
+ * finding the next timer is a count-trailing-zeros per level rather than a
+ * walk over empty ticks, and a caller can jump straight to it. Scheduling
+ * and cancelling are O(1); every timer is re-filed at most once per level.
+ * Fixed storage only: each ID has at most one pending expiry.
+ */
+class TimingWheel {
+public:
+    TimingWheel();
+
+    /**
+     * Attach timer storage and clear the wheel
+     * @param nodes Caller-owned array of capacity timer nodes
+     * @param capacity Number of timer IDs (below TIMER_NONE)
+     */
+    void init(TimerNode* nodes, uint16_t capacity);
+
+    /**
+     * Cancel every timer and restart the wheel at a time
+     * @param now Wheel time
+     */
+    void reset(uint32_t now);
+
+    /**
+     * Schedule a timer, replacing its pending expiry if it has one
+     * @param id Timer ID
+     * @param expiry Time to fire; times before the wheel's time fire at the next pop()
+     */
+    void schedule(uint16_t id, uint32_t expiry);
+
+    /**
+     * Cancel a timer (no-op if it is not scheduled)
+     * @param id Timer ID
+     */
+    void cancel(uint16_t id);
+
+    /**
+     * Check whether a timer is scheduled
+     * @param id Timer ID
+     * @return true if it has a pending expiry
+     */
+    bool isScheduled(uint16_t id) { return id < capacity_ && nodes_[id].level < TIMING_WHEEL_LEVELS; }
+
+    /**
+     * Remove the earliest timer if it expires by a limit
+     * The wheel's time advances to that timer's expiry, so timers are popped
+     * in expiry order (ties in no particular order)
+     * @param limit Latest expiry to pop
+     * @param id Output parameter for the timer ID
+     * @param expiry Output parameter for its expiry
+     * @return false if no timer expires by limit
+     */
+    bool pop(uint32_t limit, uint16_t* id, uint32_t* expiry);
+
+    /**
+     * Get the earliest pending expiry without removing it
+     * @param expiry Output parameter for the expiry
+     * @return false if no timer is scheduled
+     */
+    bool peek(uint32_t* expiry);
+
+    /**
+     * Get the number of scheduled timers
+     * @return Pending timer count
+     */
+    uint16_t getPendingCount() { return pendingCount_; }
+
+    /**
+     * Get the wheel's time (the expiry of the last timer popped, or the reset time)
+     * @return Wheel time
+     */
+    uint32_t getTime() { return now_; }
+
+private:
+    /**
+     * File a timer under the level and slot its expiry falls in
+     * @param id Timer ID, not currently linked
+     */
+    void link(uint16_t id);
+
+    /**
+     * Take a timer out of its slot's list
+     * @param id Timer ID, currently linked
+     */
+    void unlink(uint16_t id);
+
+    TimerNode* nodes_;
+    uint16_t capacity_;
+    uint16_t pendingCount_;
+    uint32_t now_;
+    uint16_t heads_[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];  // First timer in each slot
+    uint64_t occupied_[TIMING_WHEEL_LEVELS];                     // Bit n set: slot n is not empty
+};
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,69 @@
+#include "trajectory_simulator.h"
+#include <cstring>
+
+TrajectorySimulator::TrajectorySimulator() {
+}
+
+void TrajectorySimulator::init(ScheduleModule* scheduleModule) {
+    engine_.init(scheduleModule);
+}
+
+uint32_t TrajectorySimulator::getTickCount(time_t start, time_t end, uint32_t step) {
+    if (step == 0 || end <= start) {
+        return 0;
+    }
+    return (uint32_t)((end - start + step - 1) / step);
+}
+
+uint32_t TrajectorySimulator::simulateRange(time_t start, time_t end, uint32_t step, TrajectoryBuffer* buffer) {
+    uint32_t tickCount = getTickCount(start, end, step);
+    if (buffer == nullptr) {
+        return 0;
+    }
+    if (tickCount > buffer->tickCapacity) {
+        tickCount = buffer->tickCapacity;
+    }
+
+    // The first update seeks; after that each tick is a small step forward
+    for (uint32_t tick = 0; tick < tickCount; tick++) {
+        engine_.updateAllTrains(start + (time_t)tick * step);
+        recordTick(tick, buffer);
+    }
+    return tickCount;
+}
+
+void TrajectorySimulator::recordTick(uint32_t tick, TrajectoryBuffer* buffer) {
+    uint16_t count = 0;
+    const TrainPosition* positions = engine_.getActiveTrainPositions(&count);
+
+    if (buffer->trainCounts != nullptr) {
+        buffer->trainCounts[tick] = count;
+    }
+
+    // Both directions' counts, already tallied by the engine's update
+    if (buffer->ledOccupancy != nullptr) {
+        uint8_t* occupancy = buffer->ledOccupancy + (size_t)tick * LINE_LED_COUNT;
+        const LedOccupancy* engineOccupancy = engine_.getOccupancy();
+        for (uint8_t led = 0; led < LINE_LED_COUNT; led++) {
+            uint16_t total = engineOccupancy->counts[0][led] + engineOccupancy->counts[1][led];
+            occupancy[led] = (total < 0xFF) ? (uint8_t)total : 0xFF;
+        }
+    }
+
+    // Per-train columns in the engine's order; zero padding past the last train
+    uint16_t stored = (count < buffer->trainsPerTick) ? count : buffer->trainsPerTick;
+    if (buffer->ledPositions != nullptr) {
+        uint16_t* row = buffer->ledPositions + (size_t)tick * buffer->trainsPerTick;
+        for (uint16_t i = 0; i < stored; i++) {
+            row[i] = positions[i].ledPosition;
+        }
+        memset(row + stored, 0, (buffer->trainsPerTick - stored) * sizeof(uint16_t));
+    }
+    if (buffer->directions != nullptr) {
+        uint8_t* row = buffer->directions + (size_t)tick * buffer->trainsPerTick;
+        for (uint16_t i = 0; i < stored; i++) {
+            row[i] = positions[i].isNorthbound ? 1 : 0;
+        }
+        memset(row + stored, 0, buffer->trainsPerTick - stored);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef TRAJECTORY_SIMULATOR_H
+#define TRAJECTORY_SIMULATOR_H
+
+#include <cstdint>
+#include <ctime>
+#include "schedule_module.h"
+#include "position_engine.h"
+
+/**
+ * Trajectory Buffer
+ * Caller-owned output of TrajectorySimulator::simulateRange(), laid out tick
+ * by tick. Any array may be null to skip that output.
+ */
+struct TrajectoryBuffer {
+    uint16_t* trainCounts;     // [tickCapacity] trains on the line at each tick
+    uint8_t* ledOccupancy;     // [tickCapacity x LINE_LED_COUNT] trains nearest each LED (saturates at 255)
+    uint16_t* ledPositions;    // [tickCapacity x trainsPerTick] 8.8 LED coordinate of each train
+    uint8_t* directions;       // [tickCapacity x trainsPerTick] 1 = northbound, 0 = southbound
+    uint32_t tickCapacity;     // Ticks the arrays hold
+    uint16_t trainsPerTick;    // Train columns per tick; unused columns are zeroed, extra trains only counted
+};
+
+/**
+ * Trajectory Simulator
+ * Headless driver for schedule validation: steps a PositionEngine of its own
+ * over a time range and records every tick into a preallocated buffer, with
+ * no allocation or rendering in the loop
+ */
+class TrajectorySimulator {
+public:
+    TrajectorySimulator();
+
+    /**
+     * Initialize the simulator
+     * @param scheduleModule Schedule with loaded line data
+     */
+    void init(ScheduleModule* scheduleModule);
+
+    /**
+     * Get the number of ticks in a range
+     * @param start First tick
+     * @param end End of the range (exclusive)
+     * @param step Seconds between ticks
+     * @return Tick count, 0 if the range is empty or step is 0
+     */
+    static uint32_t getTickCount(time_t start, time_t end, uint32_t step);
+
+    /**
+     * Simulate ticks start, start + step, ... before end
+     * The engine seeks to start, so consecutive calls need not be contiguous
+     * @param start First tick
+     * @param end End of the range (exclusive)
+     * @param step Seconds between ticks
+     * @param buffer Output buffer
+     * @return Number of ticks written (stops early when the buffer is full)
+     */
+    uint32_t simulateRange(time_t start, time_t end, uint32_t step, TrajectoryBuffer* buffer);
+
+    /**
+     * Get the engine driven by the simulator (e.g. for its overflow count)
+     * @return Position engine
+     */
+    PositionEngine* getEngine() { return &engine_; }
+
+private:
+    /**
+     * Record the engine's current positions as one tick
+     * @param tick Tick index
+     * @param buffer Output buffer
+     */
+    void recordTick(uint32_t tick, TrajectoryBuffer* buffer);
+
+    PositionEngine engine_;
+};
+
+#endif // TRAJECTORY_SIMULATOR_H
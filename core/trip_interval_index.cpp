@@ -0,0 +1,140 @@
+#include "trip_interval_index.h"
+
+TripIntervalIndex::TripIntervalIndex()
+    : trips_(nullptr),
+      nodeCount_(0),
+      entryCount_(0),
+      root_(-1) {
+}
+
+uint16_t TripIntervalIndex::build(TripTable* tripTable) {
+    trips_ = nullptr;
+    nodeCount_ = 0;
+    entryCount_ = 0;
+    root_ = -1;
+
+    if (tripTable == nullptr || tripTable->getTripCount() == 0) {
+        return 0;
+    }
+    trips_ = tripTable->getTrip(0);
+
+    // Trip tables are already sorted by departure; zero-length trips are never running
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < tripTable->getTripCount(); i++) {
+        if (trips_[i].endSeconds > trips_[i].departureSeconds) {
+            workStart_[count] = i;
+            workEnd_[count] = i;
+            count++;
+        }
+    }
+
+    // Order by end with an insertion sort: trips sorted by departure with
+    // similar durations are nearly sorted by end already
+    for (uint16_t i = 1; i < count; i++) {
+        uint16_t index = workEnd_[i];
+        uint32_t end = trips_[index].endSeconds;
+        uint16_t j = i;
+        while (j > 0 && trips_[workEnd_[j - 1]].endSeconds > end) {
+            workEnd_[j] = workEnd_[j - 1];
+            j--;
+        }
+        workEnd_[j] = index;
+    }
+
+    root_ = buildNode(workStart_, workEnd_, count);
+    return entryCount_;
+}
+
+int16_t TripIntervalIndex::buildNode(uint16_t* byStart, uint16_t* byEnd, uint16_t count) {
+    if (count == 0) {
+        return -1;
+    }
+
+    // Center on the median departure: that trip contains the center, so every
+    // node owns at least one trip, and each side keeps at most half the trips
+    uint32_t center = trip(byStart[count / 2])->departureSeconds;
+    int16_t index = (int16_t)nodeCount_++;
+    Node& node = nodes_[index];
+    node.center = center;
+    node.first = entryCount_;
+
+    // Stable three-way partition of both orders:
+    // before center stays in front, after center goes through scratch, spanning goes to the node
+    uint16_t leftCount = 0;
+    uint16_t rightCount = 0;
+    uint16_t middleCount = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const Trip* t = trip(byStart[i]);
+        if (t->endSeconds <= center) {
+            byStart[leftCount++] = byStart[i];
+        } else if (t->departureSeconds > center) {
+            scratch_[rightCount++] = byStart[i];
+        } else {
+            byStart_[node.first + middleCount++] = byStart[i];
+        }
+    }
+    for (uint16_t i = 0; i < rightCount; i++) {
+        byStart[leftCount + i] = scratch_[i];
+    }
+
+    leftCount = 0;
+    rightCount = 0;
+    middleCount = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const Trip* t = trip(byEnd[i]);
+        if (t->endSeconds <= center) {
+            byEnd[leftCount++] = byEnd[i];
+        } else if (t->departureSeconds > center) {
+            scratch_[rightCount++] = byEnd[i];
+        } else {
+            byEnd_[node.first + middleCount++] = byEnd[i];
+        }
+    }
+    for (uint16_t i = 0; i < rightCount; i++) {
+        byEnd[leftCount + i] = scratch_[i];
+    }
+
+    node.count = middleCount;
+    entryCount_ += middleCount;
+
+    int16_t left = buildNode(byStart, byEnd, leftCount);
+    int16_t right = buildNode(byStart + leftCount, byEnd + leftCount, rightCount);
+    nodes_[index].left = left;
+    nodes_[index].right = right;
+    return index;
+}
+
+uint16_t TripIntervalIndex::query(uint32_t seconds, uint16_t* trips, uint16_t maxTrips) const {
+    uint16_t found = 0;
+    int16_t index = root_;
+
+    while (index >= 0) {
+        const Node& node = nodes_[index];
+        if (seconds < node.center) {
+            // Every trip here ends after the center, so it is running if it has departed
+            for (uint16_t i = node.first; i < node.first + node.count; i++) {
+                if (trip(byStart_[i])->departureSeconds > seconds) {
+                    break;
+                }
+                if (found < maxTrips) {
+                    trips[found] = byStart_[i];
+                }
+                found++;
+            }
+            index = node.left;
+        } else {
+            // Every trip here departed by the center, so it is running if it has not ended
+            for (uint16_t i = node.first + node.count; i > node.first; i--) {
+                if (trip(byEnd_[i - 1])->endSeconds <= seconds) {
+                    break;
+                }
+                if (found < maxTrips) {
+                    trips[found] = byEnd_[i - 1];
+                }
+                found++;
+            }
+            index = node.right;
+        }
+    }
+    return found;
+}
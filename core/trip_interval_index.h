@@ -0,0 +1,85 @@
+#ifndef TRIP_INTERVAL_INDEX_H
+#define TRIP_INTERVAL_INDEX_H
+
+#include <cstdint>
+#include "trip_table.h"
+
+/**
+ * Trip Interval Index
+ * Centered interval tree over the [departureSeconds, endSeconds) spans of a
+ * TripTable, for "which trips are running at time t" at arbitrary times
+ * (time scrubbing, batch analysis). Built once per service day; a stabbing
+ * query costs O(log n + k). Short-turn and partial trips need no special case.
+ *
+ * The tree is stored flat: each node owns a run of trips that contain its
+ * center, kept twice (ascending start and ascending end) so a query only
+ * reads the trips it reports plus one stop condition per node.
+ */
+class TripIntervalIndex {
+public:
+    TripIntervalIndex();
+
+    /**
+     * Build the index over a trip table
+     * The table must not change while the index is in use
+     * @param tripTable Trip table for one service day
+     * @return Number of trips indexed (zero-length trips are skipped)
+     */
+    uint16_t build(TripTable* tripTable);
+
+    /**
+     * Find trips running at a time
+     * Results are trip indices into the table, in no particular order
+     * @param seconds Seconds after service-day midnight
+     * @param trips Output array of trip indices
+     * @param maxTrips Capacity of trips
+     * @return Number of running trips (may exceed maxTrips; only maxTrips are written)
+     */
+    uint16_t query(uint32_t seconds, uint16_t* trips, uint16_t maxTrips) const;
+
+    /**
+     * Get number of indexed trips
+     * @return Trip count
+     */
+    uint16_t getTripCount() const { return entryCount_; }
+
+private:
+    /**
+     * Tree node
+     * Holds the trips whose span contains center; left/right subtrees hold
+     * trips entirely before/after it
+     */
+    struct Node {
+        uint32_t center;
+        uint16_t first;       // Into byStart_/byEnd_
+        uint16_t count;
+        int16_t left;         // Node index, -1 if none
+        int16_t right;
+    };
+
+    /**
+     * Build a subtree in place
+     * @param byStart Trip indices sorted by departure (partitioned in place)
+     * @param byEnd The same trips sorted by end (partitioned in place)
+     * @param count Number of trips
+     * @return Node index, or -1 if count is 0
+     */
+    int16_t buildNode(uint16_t* byStart, uint16_t* byEnd, uint16_t count);
+
+    const Trip* trip(uint16_t index) const { return &trips_[index]; }
+
+    const Trip* trips_;
+    Node nodes_[MAX_TRIPS_PER_DAY];
+    uint16_t byStart_[MAX_TRIPS_PER_DAY];   // Per node: ascending departure
+    uint16_t byEnd_[MAX_TRIPS_PER_DAY];     // Per node: ascending end
+    uint16_t nodeCount_;
+    uint16_t entryCount_;
+    int16_t root_;
+
+    // Build scratch space
+    uint16_t workStart_[MAX_TRIPS_PER_DAY];
+    uint16_t workEnd_[MAX_TRIPS_PER_DAY];
+    uint16_t scratch_[MAX_TRIPS_PER_DAY];
+};
+
+#endif // TRIP_INTERVAL_INDEX_H
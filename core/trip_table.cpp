@@ -0,0 +1,164 @@
+#include "trip_table.h"
+#include "timetable_format.h"
+#include <iostream>
+
+TripTable::TripTable()
+    : tripCount_(0),
+      maxDuration_(0),
+      serviceDayStart_(0),
+      serviceId_(SERVICE_NONE),
+      logging_(true),
+      windowSeconds_(0),
+      windowBegin_(0),
+      windowEnd_(0) {
+}
+
+void TripTable::clear() {
+    tripCount_ = 0;
+    maxDuration_ = 0;
+    serviceDayStart_ = 0;
+    serviceId_ = SERVICE_NONE;
+    windowSeconds_ = 0;
+    windowBegin_ = 0;
+    windowEnd_ = 0;
+}
+
+uint16_t TripTable::build(ScheduleModule* scheduleModule, time_t serviceDayStart) {
+    clear();
+    serviceDayStart_ = serviceDayStart;
+
+    if (scheduleModule == nullptr) {
+        return 0;
+    }
+
+    // The calendar decides which service runs (holidays, exceptions, day of week)
+    serviceId_ = scheduleModule->getServiceId(serviceDayStart);
+    const TrainSchedule* schedule = scheduleModule->getServiceSchedule(serviceId_);
+    if (schedule == nullptr) {
+        return 0;  // No service that day
+    }
+
+    // Per-trip timetable: already sorted by departure, keep this day's service
+    uint32_t timetableTripCount = 0;
+    const TimetableTrip* timetableTrips = scheduleModule->getTimetableTrips(&timetableTripCount);
+    for (uint32_t i = 0; i < timetableTripCount; i++) {
+        if (timetableTrips[i].serviceId != serviceId_) {
+            continue;
+        }
+        const ServicePattern* pattern = scheduleModule->getPattern(timetableTrips[i].pattern);
+        if (pattern == nullptr) {
+            continue;
+        }
+        uint16_t duration = scheduleModule->getPatternArrivals(pattern)[pattern->stopCount - 1];
+        if (!addTrip(timetableTrips[i].departureSeconds, timetableTrips[i].pattern, duration)) {
+            break;
+        }
+    }
+
+    // No per-trip data for this day: expand the headway bands, merging both
+    // directions so departures stay sorted. Each departure follows the previous
+    // one by the headway in effect when it leaves, so service flows across
+    // band boundaries instead of restarting on a new grid.
+    if (tripCount_ == 0) {
+        uint16_t northboundDuration = scheduleModule->getRouteTime(true);
+        uint16_t southboundDuration = scheduleModule->getRouteTime(false);
+        uint16_t northboundMinute = schedule->firstTrainMinutes;
+        uint16_t southboundMinute = schedule->firstTrainMinutes + schedule->southboundOffsetMinutes;
+
+        while (northboundMinute <= schedule->lastTrainMinutes || southboundMinute <= schedule->lastTrainMinutes) {
+            bool added;
+            uint8_t headway;
+            if (northboundMinute <= southboundMinute) {
+                added = addTrip(northboundMinute * 60u, TIMETABLE_PATTERN_FULL_NORTHBOUND, northboundDuration);
+                headway = scheduleModule->getHeadwayMinutes(schedule, northboundMinute);
+                northboundMinute += headway;
+            } else {
+                added = addTrip(southboundMinute * 60u, TIMETABLE_PATTERN_FULL_SOUTHBOUND, southboundDuration);
+                headway = scheduleModule->getHeadwayMinutes(schedule, southboundMinute);
+                southboundMinute += headway;
+            }
+            if (!added || headway == 0) {
+                break;
+            }
+        }
+    }
+
+    if (logging_) {
+        std::cout << "[TripTable] Built " << tripCount_ << " trips for service " << (int)serviceId_ << std::endl;
+    }
+    return tripCount_;
+}
+
+const Trip* TripTable::getTrip(uint16_t index) {
+    if (index >= tripCount_) {
+        return nullptr;
+    }
+    return &trips_[index];
+}
+
+void TripTable::advanceWindow(uint32_t seconds, uint16_t* begin, uint16_t* end) {
+    // Time went backwards (clock set or replay), or jumped past every trip in
+    // the window: reposition directly instead of stepping trip by trip
+    if (seconds < windowSeconds_ || seconds - windowSeconds_ >= maxDuration_) {
+        findWindow(seconds, &windowBegin_, &windowEnd_);
+    }
+    windowSeconds_ = seconds;
+
+    // Admit trips that have departed
+    while (windowEnd_ < tripCount_ && trips_[windowEnd_].departureSeconds <= seconds) {
+        windowEnd_++;
+    }
+
+    // Drop trips that departed longer ago than the longest trip takes; they have all finished
+    while (windowBegin_ < windowEnd_ && trips_[windowBegin_].departureSeconds + maxDuration_ <= seconds) {
+        windowBegin_++;
+    }
+
+    *begin = windowBegin_;
+    *end = windowEnd_;
+}
+
+void TripTable::findWindow(uint32_t seconds, uint16_t* begin, uint16_t* end) {
+    // End: first trip departing after the time
+    uint16_t low = 0;
+    uint16_t high = tripCount_;
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+        if (trips_[mid].departureSeconds <= seconds) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *end = low;
+
+    // Begin: first trip that departed less than the longest trip duration ago
+    low = 0;
+    high = *end;
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+        if (trips_[mid].departureSeconds + maxDuration_ <= seconds) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *begin = low;
+}
+
+bool TripTable::addTrip(uint32_t departureSeconds, uint16_t pattern, uint16_t duration) {
+    if (tripCount_ >= MAX_TRIPS_PER_DAY) {
+        std::cout << "[TripTable] Trip table full (" << MAX_TRIPS_PER_DAY << "), dropping later trips" << std::endl;
+        return false;
+    }
+
+    Trip& trip = trips_[tripCount_++];
+    trip.departureSeconds = departureSeconds;
+    trip.endSeconds = departureSeconds + duration;
+    trip.pattern = pattern;
+
+    if (duration > maxDuration_) {
+        maxDuration_ = duration;
+    }
+    return true;
+}
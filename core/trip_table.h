@@ -0,0 +1,127 @@
+#ifndef TRIP_TABLE_H
+#define TRIP_TABLE_H
+
+#include <cstdint>
+#include <ctime>
+#include "schedule_module.h"
+
+// Capacity of one service day's trip table (both directions)
+#ifndef MAX_TRIPS_PER_DAY
+#define MAX_TRIPS_PER_DAY 512
+#endif
+
+/**
+ * Trip structure
+ * One scheduled run of a service pattern within a service day
+ */
+struct Trip {
+    uint32_t departureSeconds;  // Seconds after service-day midnight (may exceed 86400)
+    uint32_t endSeconds;        // Terminal arrival, same clock
+    uint16_t pattern;           // Index into ScheduleModule patterns
+};
+
+/**
+ * Trip Table
+ * Holds one service day's trips sorted by departure and maintains a sliding
+ * window of trips that can be on the line, so each tick only touches the
+ * trips that are actually running.
+ */
+class TripTable {
+public:
+    TripTable();
+
+    /**
+     * Build the trip table (day plan) for a service day
+     * The service comes from the schedule's calendar. Uses per-trip data from
+     * the loaded timetable when it has trips for that service, otherwise
+     * expands the service's headway schedule
+     * @param scheduleModule Pointer to schedule module
+     * @param serviceDayStart Local midnight of the service day
+     * @return Number of trips loaded
+     */
+    uint16_t build(ScheduleModule* scheduleModule, time_t serviceDayStart);
+
+    /**
+     * Forget the built day, so the next build() runs even for the same day
+     * (e.g. after the schedule it was built from changes)
+     */
+    void clear();
+
+    /**
+     * Get the service day this table was built for
+     * @return Local midnight of the service day, or 0 if not built
+     */
+    time_t getServiceDayStart() { return serviceDayStart_; }
+
+    /**
+     * Get the service this table was built for
+     * @return Service ID (SERVICE_NONE if no trains run)
+     */
+    uint8_t getServiceId() { return serviceId_; }
+
+    /**
+     * Enable or disable informational logging (on by default)
+     * Capacity warnings are always logged
+     * @param enabled true to log each build
+     */
+    void setLogging(bool enabled) { logging_ = enabled; }
+
+    /**
+     * Get number of trips in the table
+     * @return Trip count
+     */
+    uint16_t getTripCount() { return tripCount_; }
+
+    /**
+     * Get trip by index (sorted by departure)
+     * @param index Trip index
+     * @return Pointer to trip, or nullptr if out of range
+     */
+    const Trip* getTrip(uint16_t index);
+
+    /**
+     * Advance the active window to a time
+     * Trips in [begin, end) have departed and departed no earlier than the
+     * longest trip duration ago; callers still check endSeconds. Small steps
+     * forward cost O(trips entering or leaving); moving backward, or forward
+     * by more than the longest trip, repositions by binary search.
+     * @param seconds Seconds after service-day midnight
+     * @param begin Output parameter for first trip in window
+     * @param end Output parameter for one past last trip in window
+     */
+    void advanceWindow(uint32_t seconds, uint16_t* begin, uint16_t* end);
+
+    /**
+     * Find the active window at a time without moving the sliding window
+     * Same trips as advanceWindow(), found by binary search in O(log n), so
+     * lookups may jump in either direction at no extra cost
+     * @param seconds Seconds after service-day midnight
+     * @param begin Output parameter for first trip in window
+     * @param end Output parameter for one past last trip in window
+     */
+    void findWindow(uint32_t seconds, uint16_t* begin, uint16_t* end);
+
+private:
+    /**
+     * Append a trip (callers add trips in departure order)
+     * @param departureSeconds Seconds after service-day midnight
+     * @param pattern Pattern index
+     * @param duration Seconds from departure to terminal arrival
+     * @return false if the table is full
+     */
+    bool addTrip(uint32_t departureSeconds, uint16_t pattern, uint16_t duration);
+
+    Trip trips_[MAX_TRIPS_PER_DAY];
+    uint16_t tripCount_;
+    uint16_t maxDuration_;      // Longest trip, bounds how far back the window reaches
+    time_t serviceDayStart_;
+    uint8_t serviceId_;
+    bool logging_;
+
+    // Sliding window state
+    uint32_t windowSeconds_;
+    uint16_t windowBegin_;
+    uint16_t windowEnd_;
+};
+
+#endif // TRIP_TABLE_H
@@ -19,7 +19,14 @@
 
 // Train Configuration
 #define BREATHING_CYCLE_MS 2000         // Breathing cycle: 1000ms fade up + 1000ms fade down (0.5 Hz)
-#define TRAIN_UPDATE_INTERVAL 1000      // milliseconds
+#define EVENT_DRIVEN_TRAINS 0           // 0: every train recomputed each frame, gliding between LEDs
+                                        // 1: trains recomputed only at departures, arrivals and LED changes
+                                        //    (cheaper, but trains step a whole LED at a time)
+#define LED_SCHEDULE_PLAYBACK 0         // 1: precompute each service day's LED transitions (~75 KB, PSRAM if present)
+                                        //    and replay them with a cursor instead of updating the engine each frame
+
+// Schedule Configuration
+#define TIMETABLE_PARTITION_LABEL "timetable"  // Flash data partition holding the binary timetable
 
 // Color definitions (RGB values for NeoPixel)
 #define STATION_R 0
@@ -30,10 +30,22 @@ public:
 
     /**
      * Set train LEDs (flashing red/green)
+     * Each train's light is split between the two LEDs around its
+     * fractional position, so trains glide rather than step between LEDs
      * @param trains Array of train positions
      * @param count Number of trains
      */
-    void setTrainLEDs(const TrainPosition* trains, uint8_t count);
+    void setTrainLEDs(const TrainPosition* trains, uint16_t count);
+
+    /**
+     * Set station and train LEDs from occupancy bitmaps (whole-LED positions)
+     * Walks only the LEDs set in the union of the station and direction
+     * bitmaps and writes each once; a shared LED's color scales with its
+     * train count. Call after clearAllLEDs() instead of setStationLEDs()
+     * and setTrainLEDs().
+     * @param occupancy Occupancy from the position engine or an LED schedule cursor
+     */
+    void renderOccupancy(const LedOccupancy* occupancy);
 
     /**
      * Update display (call in loop)
@@ -55,6 +67,20 @@ public:
     void setAllLEDs(uint8_t r, uint8_t g, uint8_t b);
 
 private:
+    /**
+     * Get the breathing pulse level for the current time
+     * @return Level in 1/256ths (13-256)
+     */
+    uint16_t getBreathingLevel();
+
+    /**
+     * Add train color to a pixel (additive mixing)
+     * @param ledIndex LED index (ignored if off the strip)
+     * @param isNorthbound Direction (red northbound, green southbound)
+     * @param intensity Train color intensity (0-255)
+     */
+    void addTrainPixel(uint16_t ledIndex, bool isNorthbound, uint8_t intensity);
+
     Adafruit_NeoPixel strip_;
     bool flashState_;
     unsigned long lastFlashToggle_;
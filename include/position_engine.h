@@ -4,17 +4,68 @@
 #include <Arduino.h>
 #include <time.h>
 #include "schedule_module.h"
+#include "trip_table.h"
+#include "timing_wheel.h"
+
+// Train capacity: firmware keeps this static size, host builds may raise it to thousands
+#ifndef MAX_TRAINS
+#define MAX_TRAINS 32
+#endif
+
+static_assert(MAX_TRAINS > 0 && MAX_TRAINS < 0xFFFF, "Train slots are 16-bit indices");
+
+// Words in the active-slot bitsets
+constexpr uint16_t TRAIN_MASK_WORDS = (MAX_TRAINS + 31) / 32;
+
+// Event-mode timer of the next departure; each train's timer ID is its slot index
+constexpr uint16_t SPAWN_TIMER_ID = MAX_TRAINS;
+
+// Words in the per-trip bitset (trips of the current day plan with a train on the line)
+constexpr uint16_t TRIP_MASK_WORDS = (MAX_TRIPS_PER_DAY + 31) / 32;
+
+// Event capacity per update: a train can arrive and change LED in one tick, plus spawns and retirements
+#ifndef MAX_TRAIN_EVENTS
+#define MAX_TRAIN_EVENTS (MAX_TRAINS * 4)
+#endif
+
+static_assert(MAX_TRAIN_EVENTS > 0 && MAX_TRAIN_EVENTS < 0xFFFF, "Event counts are 16-bit");
+
+// Train event types
+constexpr uint8_t TRAIN_EVENT_SPAWNED = 0;       // Train placed on the line
+constexpr uint8_t TRAIN_EVENT_LED_CHANGED = 1;   // Nearest LED moved
+constexpr uint8_t TRAIN_EVENT_ARRIVED = 2;       // Reached a station (the last one reached, after a jump)
+constexpr uint8_t TRAIN_EVENT_RETIRED = 3;       // Trip finished or train cleared; the ID may be reused
+
+// Words in a per-direction LED bitmap (bit n = LED n)
+constexpr uint8_t LED_OCCUPANCY_WORDS = 4;
+
+static_assert(LINE_LED_COUNT <= LED_OCCUPANCY_WORDS * 32, "LED bitmaps hold 128 LEDs");
+
+// LED index for a train that has not been placed yet
+constexpr uint8_t TRAIN_LED_NONE = 0xFF;
+
+// Build the next service day's plan from local midnight, well before the 03:00 rollover
+constexpr uint32_t DAY_PLAN_PREBUILD_SECONDS = 24 * 3600;
+
+// Position engine modes
+constexpr uint8_t POSITION_MODE_TRACKED = 0;     // Train slots persist, spawned and retired as time advances
+constexpr uint8_t POSITION_MODE_STATELESS = 1;   // Every update evaluates the timetable afresh
+constexpr uint8_t POSITION_MODE_EVENT = 2;       // Trains are touched only at their own departures, arrivals and LED changes
 
 /**
  * Train structure
+ * One train's state, for evaluating a single train; the engine itself keeps
+ * its fleet as per-field arrays
  */
 struct Train {
-    uint8_t id;
+    uint16_t id;              // Slot index
     bool isNorthbound;
     uint8_t currentStation;
     uint8_t nextStation;
     float progress;           // 0.0 to 1.0 between stations
     time_t departureTime;
+    uint16_t pattern;         // Service pattern the train runs
+    uint16_t trip;            // Index of the trip in the day plan
     bool isActive;
 };
 
@@ -22,9 +73,34 @@ struct Train {
  * Train Position structure
  */
 struct TrainPosition {
-    uint8_t ledIndex;
+    uint8_t ledIndex;         // Nearest LED
     bool isNorthbound;
     bool isActive;
+    uint16_t ledPosition;     // LED coordinate in 8.8 fixed point, for rendering between LEDs
+};
+
+/**
+ * Train Event structure
+ * One change since the previous update
+ */
+struct TrainEvent {
+    uint8_t type;             // TRAIN_EVENT_*
+    uint16_t trainId;         // Slot index, stable from spawn until retirement
+    uint8_t station;          // Station arrived at, otherwise the station last left (or dwelling at)
+    uint8_t ledIndex;         // Nearest LED after the event (last LED shown, for a retirement)
+    bool isNorthbound;
+};
+
+/**
+ * LED Occupancy structure
+ * Which LEDs show a train, built in the same pass as the positions array.
+ * Direction index 0 is southbound, 1 northbound; renderers can combine the
+ * bitmaps a word at a time and count a span with popcount.
+ */
+struct LedOccupancy {
+    uint32_t bits[2][LED_OCCUPANCY_WORDS];  // Bit n set: a train's nearest LED is n
+    uint8_t counts[2][LINE_LED_COUNT];      // Trains nearest each LED (saturates at 255)
+    uint16_t sharedLEDs;                    // LEDs nearest two or more trains, either direction
 };
 
 /**
@@ -41,12 +117,70 @@ public:
      */
     void init(ScheduleModule* scheduleModule);
 
+    /**
+     * Select how train positions are derived
+     * Stateless mode places each running trip from (t - departure) on every
+     * update and keeps no per-train state, so a query costs O(log trips +
+     * active trains) and gives the same result whether time steps forward,
+     * backward or jumps. Switching modes clears all train slots.
+     * Event mode keeps each train's next departure, arrival or LED change in
+     * a timing wheel, so an update costs O(events due) and an update with
+     * nothing due does no per-train work at all.
+     * @param mode POSITION_MODE_TRACKED (default), POSITION_MODE_STATELESS or POSITION_MODE_EVENT
+     */
+    void setMode(uint8_t mode);
+
+    /**
+     * Get the current mode
+     * @return POSITION_MODE_TRACKED, POSITION_MODE_STATELESS or POSITION_MODE_EVENT
+     */
+    uint8_t getMode() { return mode_; }
+
+    /**
+     * Enable or disable informational logging (on by default)
+     * Batch runs turn it off; capacity warnings are always logged
+     * @param enabled true to log initialization, spawns and day-plan builds
+     */
+    void setLogging(bool enabled);
+
     /**
      * Update all train positions
      * @param currentTime Current time
      */
     void updateAllTrains(time_t currentTime);
 
+    /**
+     * Update all train positions at millisecond resolution
+     * Progress between stations carries the sub-second part, so positions move
+     * smoothly when called every frame; the cost per call is the same as
+     * updateAllTrains() (active trains plus trips departed since the last call)
+     * @param currentMillis Current time in milliseconds since the epoch
+     */
+    void updateAllTrainsMillis(int64_t currentMillis);
+
+    /**
+     * Move to any time, forward or backward, including into another service day
+     * Trains still running at the target keep their IDs and are re-placed;
+     * trains not yet departed at the target are retired and trips running
+     * there are spawned, in O(active trains + log trips). updateAllTrains()
+     * performs the same reconciliation whenever time steps backward or the
+     * service day changes, so scrubbing never needs a new engine.
+     * @param targetTime Time to move to
+     */
+    void seek(time_t targetTime);
+
+    /**
+     * Get the time of the next change (event mode)
+     * Host simulations can update at each returned time in turn and skip the
+     * idle time between, with the same events and positions as any finer step.
+     * In event mode ledPosition is the whole LED (ledIndex << 8), since
+     * nothing is recomputed between events.
+     * @return Milliseconds since the epoch of the next departure, arrival or LED
+     *         change (the next service-day rollover if none is left), or -1 outside
+     *         event mode or before the first update
+     */
+    int64_t getNextEventMillis();
+
     /**
      * Calculate individual train position
      * @param train Pointer to train
@@ -61,29 +195,314 @@ public:
      */
     uint8_t mapPositionToLED(float position);
 
+    /**
+     * Place a train on explicit stop times
+     * The placement the engine uses for every train, for callers with stop
+     * times of their own (e.g. perturbed ones). Binary search: O(log stops)
+     * @param pattern Stops served (first station, stop count, direction)
+     * @param arrivalOffsets Arrival at each stop, seconds from the origin departure
+     * @param departureOffsets Departure from each stop, same clock
+     * @param elapsedSeconds Whole seconds since the trip's departure
+     * @param elapsedMillis Milliseconds past elapsedSeconds (0-999), for progress only
+     * @param currentStation Output parameter for the station left (or dwelling at)
+     * @param nextStation Output parameter for the station ahead
+     * @param progress Output parameter for progress between them (0.0 to 1.0)
+     * @return false if the trip has finished
+     */
+    static bool placeOnStops(const ServicePattern* pattern, const uint16_t* arrivalOffsets,
+                             const uint16_t* departureOffsets, int32_t elapsedSeconds, uint16_t elapsedMillis,
+                             uint8_t* currentStation, uint8_t* nextStation, float* progress);
+
+    /**
+     * Map a position between two stations onto the LED strip
+     * @param currentStation Station left (or dwelling at)
+     * @param nextStation Station ahead
+     * @param progress Progress between them (0.0 to 1.0)
+     * @param ledIndex Output parameter for the nearest LED
+     * @param ledPosition Output parameter for the LED coordinate in 8.8 fixed point
+     * @return false if a station is unknown
+     */
+    bool mapTrainToLED(uint8_t currentStation, uint8_t nextStation, float progress,
+                       uint8_t* ledIndex, uint16_t* ledPosition);
+
     /**
      * Get active train positions
      * @param count Output parameter for number of active trains
      * @return Pointer to train positions array
      */
-    const TrainPosition* getActiveTrainPositions(uint8_t* count);
+    const TrainPosition* getActiveTrainPositions(uint16_t* count);
+
+    /**
+     * Get LED occupancy after the last update (every mode)
+     * @return Per-direction bitmaps and per-LED counts of the positions array
+     */
+    const LedOccupancy* getOccupancy() { return &occupancy_; }
+
+    /**
+     * Empty an occupancy record
+     * @param occupancy Occupancy to clear
+     */
+    static void clearOccupancy(LedOccupancy* occupancy);
 
     /**
-     * Spawn new trains based on schedule
+     * Add one train to an occupancy record
+     * @param occupancy Occupancy to update
+     * @param ledIndex Train's nearest LED (ignored past LINE_LED_COUNT)
+     * @param isNorthbound Direction of travel
+     */
+    static void addToOccupancy(LedOccupancy* occupancy, uint8_t ledIndex, bool isNorthbound);
+
+    /**
+     * Count the LEDs in a span showing a train in one direction
+     * @param occupancy Occupancy to read
+     * @param isNorthbound Direction of travel
+     * @param firstLED First LED of the span
+     * @param lastLED Last LED of the span (inclusive)
+     * @return Occupied LEDs in the span
+     */
+    static uint8_t countOccupiedLEDs(const LedOccupancy* occupancy, bool isNorthbound, uint8_t firstLED, uint8_t lastLED);
+
+    /**
+     * Get the events produced by the last update
+     * Tracked mode only: trains spawned, LED changes, station arrivals and
+     * retirements, so consumers can do work proportional to what changed.
+     * Stateless mode keeps no per-train state and produces no events.
+     * @param count Output parameter for number of events
+     * @return Pointer to events array, in the order they occurred within the update
+     *         (in event mode, in time order)
+     */
+    const TrainEvent* getEvents(uint16_t* count);
+
+    /**
+     * Get the number of events dropped for lack of space (MAX_TRAIN_EVENTS)
+     * @return Dropped event count since init()
+     */
+    uint32_t getEventOverflowCount() { return eventOverflowCount_; }
+
+    /**
+     * Get the number of trains dropped for lack of capacity (MAX_TRAINS)
+     * Tracked mode counts each trip that could not be spawned; stateless
+     * mode counts running trips left out of an update, on every update
+     * @return Overflow count since init()
+     */
+    uint32_t getOverflowCount() { return overflowCount_; }
+
+    /**
+     * Spawn trains for trips that have departed since the last call
+     * A cursor over the day plan's departures (both directions, in departure
+     * order) marks the next trip to spawn, so each trip is considered once and
+     * the per-tick cost does not grow through the service day. Trains are
+     * placed at the sub-second time of the update in progress
      * @param currentTime Current time
      */
     void spawnNewTrains(time_t currentTime);
 
     /**
-     * Remove completed trains
+     * Retire trains that finished during the last update
+     * Clears their active bits and returns their slots to the pool
      */
     void removeCompletedTrains();
 
 private:
+    /**
+     * Bring the fleet in line with a time before the last spawn pass or in another service day
+     * Retires trains that have not departed by then (all of them on a day
+     * change) and rewinds the spawn cursor to the start of the trip window.
+     * Does nothing while time moves forward within a service day.
+     * @param currentTime Current time
+     */
+    void reconcileTrains(time_t currentTime);
+
+    /**
+     * Retire one train now, reporting it, and return its slot to the pool
+     * @param slot Slot index of an active train
+     */
+    void retireTrain(uint16_t slot);
+
+    /**
+     * Event-mode update: handle every timer due by a time
+     * Starts over from the trips running at that time on a new service day
+     * or a step backward; rebuilds the positions array only if anything changed
+     * @param currentTime Current time (updateMillis_ holds the sub-second part)
+     */
+    void processEvents(time_t currentTime);
+
+    /**
+     * Spawn the trips departed by a time and re-arm the spawn timer for the next departure
+     * @param plan Current day plan
+     * @param dayMillis Milliseconds after service-day midnight
+     */
+    void spawnDueTrips(TripTable* plan, uint32_t dayMillis);
+
+    /**
+     * Re-place a train at its timer's expiry, report what changed and schedule its next event
+     * @param slot Slot index of an active train
+     * @param dayMillis Milliseconds after service-day midnight
+     */
+    void advanceTrain(uint16_t slot, uint32_t dayMillis);
+
+    /**
+     * Find a train's next arrival or LED change after a time
+     * The crossing is solved from the segment's end LEDs, then moved to the
+     * first millisecond at which placeOnStops() and mapTrainToLED() agree
+     * @param slot Slot index of an active train, placed at dayMillis
+     * @param dayMillis Milliseconds after service-day midnight
+     * @return Milliseconds after service-day midnight of the next event
+     */
+    uint32_t findNextTrainEvent(uint16_t slot, uint32_t dayMillis);
+
+    /**
+     * Nearest LED of a trip at a time, as an update would show it
+     * @param pattern Stops served
+     * @param arrivalOffsets Pattern arrival offsets
+     * @param departureOffsets Pattern departure offsets
+     * @param elapsedMillis Milliseconds since the trip's departure
+     * @return LED index, or TRAIN_LED_NONE if the trip has finished
+     */
+    uint8_t getLEDAt(const ServicePattern* pattern, const uint16_t* arrivalOffsets,
+                     const uint16_t* departureOffsets, uint32_t elapsedMillis);
+
+    /**
+     * Get the day plan for the service day containing a time
+     * Swaps to (or builds) the right plan and prebuilds the next one after midnight
+     * @param currentTime Current time
+     * @param secondsIntoDay Output parameter for seconds after service-day midnight
+     * @return Day plan
+     */
+    TripTable* resolveDayPlan(time_t currentTime, uint32_t* secondsIntoDay);
+
+    /**
+     * Stateless update: evaluate every trip on the line at a time
+     * @param currentTime Current time
+     */
+    void evaluateAllTrains(time_t currentTime);
+
+    /**
+     * Place a train on its pattern's stop times (see placeOnStops())
+     * @param patternIndex Service pattern the train runs
+     * @param elapsedSeconds Whole seconds since the trip's departure
+     * @param elapsedMillis Milliseconds past elapsedSeconds (0-999), for progress only
+     * @param currentStation Output parameter for the station left (or dwelling at)
+     * @param nextStation Output parameter for the station ahead
+     * @param progress Output parameter for progress between them (0.0 to 1.0)
+     * @return false if the trip has finished (or the pattern is unknown)
+     */
+    bool placeTrain(uint16_t patternIndex, int32_t elapsedSeconds, uint16_t elapsedMillis,
+                    uint8_t* currentStation, uint8_t* nextStation, float* progress);
+
+    /**
+     * Spawn one trip's train, placed at a time
+     * @param plan Day plan holding the trip
+     * @param tripIndex Trip index in the plan
+     * @param currentTime Current time
+     * @param currentMillis Milliseconds past currentTime (0-999)
+     * @return Slot index, or MAX_TRAINS if no slot was free or the trip has finished
+     */
+    uint16_t spawnTrain(TripTable* plan, uint16_t tripIndex, time_t currentTime, uint16_t currentMillis);
+
+    /**
+     * Take a free train slot from the pool
+     * @return Slot index, or MAX_TRAINS if every slot is in use
+     */
+    uint16_t allocateTrain();
+
+    /**
+     * Mark a slot as running a train
+     * @param slot Slot index from allocateTrain()
+     */
+    void activateTrain(uint16_t slot) { activeSlots_[slot / 32] |= 1u << (slot % 32); }
+
+    /**
+     * Deactivate every train and refill the pool
+     */
+    void resetTrains();
+
+    /**
+     * Retire every train on the line, reporting each one, and refill the pool
+     */
+    void retireAllTrains();
+
+    /**
+     * Append an event for the current update
+     * @param type TRAIN_EVENT_*
+     * @param trainId Slot index
+     * @param station Station the event refers to
+     * @param ledIndex Nearest LED
+     * @param isNorthbound Direction of travel
+     */
+    void addEvent(uint8_t type, uint16_t trainId, uint8_t station, uint8_t ledIndex, bool isNorthbound);
+
+    /**
+     * Empty the positions array and occupancy before a rebuild
+     */
+    void clearPositions();
+
+    /**
+     * Append a placed train to the positions array and occupancy
+     * @param ledIndex Nearest LED
+     * @param ledPosition LED coordinate in 8.8 fixed point
+     * @param isNorthbound Direction of travel
+     */
+    void appendPosition(uint8_t ledIndex, uint16_t ledPosition, bool isNorthbound);
+
+    /**
+     * Append a train's interpolated LED position to the positions array
+     * @param currentStation Station left (or dwelling at)
+     * @param nextStation Station ahead
+     * @param progress Progress between them (0.0 to 1.0)
+     * @param isNorthbound Direction of travel
+     * @return Nearest LED index, or TRAIN_LED_NONE if a station is unknown
+     */
+    uint8_t addTrainPosition(uint8_t currentStation, uint8_t nextStation, float progress, bool isNorthbound);
+
     ScheduleModule* scheduleModule_;
-    Train trains_[20];  // Static allocation for max 20 trains
-    TrainPosition trainPositions_[20];
-    uint8_t activeTrainCount_;
+    uint8_t mode_;
+    bool logging_;
+    uint16_t updateMillis_;     // Sub-second part of the time being updated to
+    // Day plans for the current and next service day; the next one is built
+    // ahead of time so the 03:00 rollover is a swap
+    TripTable dayPlans_[2];
+    uint8_t currentPlan_;
+
+    // Spawn cursor: trips before spawnCursor_ in the current plan have been spawned (or finished)
+    uint16_t spawnCursor_;
+    time_t spawnDayStart_;      // Service day the cursor belongs to
+    uint32_t spawnSeconds_;     // Time of the last spawn pass, to detect time going backwards
+    uint32_t tripsOnLine_[TRIP_MASK_WORDS];  // Trips with a train on the line, skipped after a rewind
+
+    // Event mode: one timer per train slot plus the spawn timer, in milliseconds after service-day midnight
+    TimingWheel wheel_;
+    TimerNode timerNodes_[MAX_TRAINS + 1];
+    uint32_t eventMillis_;      // Time of the last event-mode update
+
+    // Train state as parallel arrays indexed by slot, so a pass over the
+    // fleet touches only the fields it needs
+    time_t trainDepartures_[MAX_TRAINS];
+    uint16_t trainPatterns_[MAX_TRAINS];
+    uint16_t trainTrips_[MAX_TRAINS];       // Trip index in the day plan
+    uint8_t trainStations_[MAX_TRAINS];     // Station left (or dwelling at)
+    uint8_t trainNextStations_[MAX_TRAINS];
+    float trainProgress_[MAX_TRAINS];
+    uint8_t trainNorthbound_[MAX_TRAINS];
+    uint8_t trainLEDs_[MAX_TRAINS];         // LED last reported, TRAIN_LED_NONE until first placed
+
+    // Slot bitsets, iterated with count-trailing-zeros
+    uint32_t activeSlots_[TRAIN_MASK_WORDS];     // Slot holds a train on the line
+    uint32_t completedSlots_[TRAIN_MASK_WORDS];  // Finished in this update, awaiting removeCompletedTrains()
+
+    TrainPosition trainPositions_[MAX_TRAINS];
+    uint16_t activeTrainCount_;
+    LedOccupancy occupancy_;
+
+    // Free-list pool: freeSlots_[0, freeCount_) are the unused slots
+    uint16_t freeSlots_[MAX_TRAINS];
+    uint16_t freeCount_;
+    uint32_t overflowCount_;
+
+    // Events since the start of the last update
+    TrainEvent events_[MAX_TRAIN_EVENTS];
+    uint16_t eventCount_;
+    uint32_t eventOverflowCount_;
 };
 
 #endif // POSITION_ENGINE_H
@@ -29,6 +29,12 @@ public:
      */
     time_t getCurrentTime();
 
+    /**
+     * Get current time at millisecond resolution
+     * @return milliseconds since the epoch, 0 if not synced
+     */
+    int64_t getCurrentTimeMillis();
+
     /**
      * Check if time has been synced
      * @return true if synced, false otherwise
@@ -52,6 +58,12 @@ private:
      */
     void setDefaultTime();
 
+    /**
+     * Get milliseconds since last sync, across millis() rollover
+     * @return elapsed milliseconds
+     */
+    uint32_t getMillisSinceSync();
+
     time_t lastSyncTime_;
     uint32_t lastSyncMillis_;
     bool isSynced_;
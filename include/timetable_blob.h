@@ -0,0 +1,96 @@
+#ifndef TIMETABLE_BLOB_H
+#define TIMETABLE_BLOB_H
+
+#include <Arduino.h>
+#include "timetable_format.h"
+
+/**
+ * Timetable Blob
+ * Validates a binary timetable in place and exposes its sections without copying
+ */
+class TimetableBlob {
+public:
+    TimetableBlob();
+    ~TimetableBlob();
+
+    /**
+     * Attach to timetable bytes that are already in memory
+     * The caller keeps ownership; the bytes must outlive this object
+     * @param data Start of blob
+     * @param size Bytes available at data
+     * @return true if header, index and checksum are valid
+     */
+    bool attach(const uint8_t* data, uint32_t size);
+
+    /**
+     * Memory-map a timetable from a flash data partition
+     * The blob is read in place through the flash cache, nothing is copied to RAM
+     * @param label Partition label (see partitions.csv)
+     * @return true if mapped and valid
+     */
+    bool openPartition(const char* label);
+
+    /**
+     * Release the mapping (if any) and detach
+     */
+    void close();
+
+    /**
+     * Check if a valid blob is attached
+     * @return true if valid
+     */
+    bool isValid() const;
+
+    /**
+     * Get station records
+     * @param count Output parameter for number of stations
+     * @return Pointer to stations, or nullptr if missing
+     */
+    const Station* getStations(uint16_t* count) const;
+
+    /**
+     * Get inter-station segment records
+     * @param count Output parameter for number of segments
+     * @return Pointer to segments, or nullptr if missing
+     */
+    const InterStationSegment* getSegments(uint16_t* count) const;
+
+    /**
+     * Get service pattern records
+     * @param count Output parameter for number of patterns
+     * @return Pointer to patterns, or nullptr if missing
+     */
+    const ServicePattern* getPatterns(uint16_t* count) const;
+
+    /**
+     * Get the shared pattern offset pool
+     * @param count Output parameter for number of offsets
+     * @return Pointer to offsets, or nullptr if missing
+     */
+    const uint16_t* getPatternOffsets(uint32_t* count) const;
+
+    /**
+     * Get trip records (sorted by departure)
+     * @param count Output parameter for number of trips
+     * @return Pointer to trips, or nullptr if missing
+     */
+    const TimetableTrip* getTrips(uint32_t* count) const;
+
+private:
+    /**
+     * Look up a section in the index header
+     * @param type Section type
+     * @param recordSize Expected bytes per record
+     * @param maxCount Most records the caller can address
+     * @param count Output parameter for number of records
+     * @return Pointer to first record, or nullptr if missing, mis-sized or too long
+     */
+    const void* findSection(uint32_t type, uint32_t recordSize, uint32_t maxCount, uint32_t* count) const;
+
+    const uint8_t* data_;
+    uint32_t size_;
+    uint32_t mapHandle_;      // spi_flash_mmap_handle_t for the partition mapping
+    bool isMapped_;
+};
+
+#endif // TIMETABLE_BLOB_H
@@ -0,0 +1,196 @@
+/**
+ * Event Mode Parity Check
+ * Checks the timing wheel against a reference priority queue, then drives a
+ * tracked-mode and an event-mode PositionEngine through the same random
+ * millisecond updates (short frame steps, backward seeks and multi-hour
+ * jumps across service days) and checks they agree
+ *
+ * Usage: event_parity_check [updates] [timetable.bin]
+ *   updates        Engine updates to compare (default 200000)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/position_engine.h"
+#include "../../core/timing_wheel.h"
+
+namespace {
+
+/**
+ * Random schedule, cancel and pop operations against a map of pending expiries
+ * @return Number of mismatches
+ */
+uint32_t checkTimingWheel() {
+    const uint16_t timerCount = 500;
+    std::vector<TimerNode> nodes(timerCount);
+    TimingWheel wheel;
+    wheel.init(nodes.data(), timerCount);
+
+    std::mt19937_64 random(5);
+    std::map<uint16_t, uint32_t> pending;
+    uint32_t now = 0;
+    uint32_t mismatches = 0;
+    uint64_t pops = 0;
+    for (uint32_t op = 0; op < 500000; op++) {
+        uint32_t kind = random() % 10;
+        if (kind < 5) {
+            // Mostly near-term timers, with some far enough out to reach the top levels
+            uint16_t id = random() % timerCount;
+            uint32_t span = (random() % 4 == 0) ? (uint32_t)(random() % 4000000000u)
+                                                : (uint32_t)(random() % ((random() & 1) ? 100 : 200000));
+            uint32_t expiry = (now + span < now) ? 0xFFFFFFFF : now + span;
+            wheel.schedule(id, expiry);
+            pending[id] = expiry;
+        } else if (kind < 6) {
+            uint16_t id = random() % timerCount;
+            wheel.cancel(id);
+            pending.erase(id);
+        } else {
+            uint32_t limit = now + (uint32_t)(random() % 300000);
+            if (limit < now) {
+                limit = 0xFFFFFFFF;
+            }
+
+            uint32_t earliest = 0xFFFFFFFF;
+            for (const auto& timer : pending) {
+                earliest = std::min(earliest, timer.second);
+            }
+            uint32_t peeked = 0;
+            bool hasTimer = wheel.peek(&peeked);
+            if (hasTimer != !pending.empty() || (hasTimer && peeked != earliest)) {
+                mismatches++;
+            }
+
+            // Pops must come out in expiry order and match what was scheduled
+            uint16_t id = 0;
+            uint32_t expiry = 0;
+            while (wheel.pop(limit, &id, &expiry)) {
+                pops++;
+                earliest = 0xFFFFFFFF;
+                for (const auto& timer : pending) {
+                    earliest = std::min(earliest, timer.second);
+                }
+                auto found = pending.find(id);
+                if (found == pending.end() || found->second != expiry || expiry != earliest) {
+                    mismatches++;
+                }
+                pending.erase(id);
+            }
+            now = limit;
+        }
+        if (wheel.getPendingCount() != pending.size()) {
+            mismatches++;
+        }
+    }
+
+    printf("timing wheel: %llu pops, %s\n", (unsigned long long)pops, mismatches == 0 ? "matches" : "MISMATCH");
+    return mismatches;
+}
+
+/**
+ * Positions as sorted (direction, LED) keys; train IDs may differ between modes
+ */
+std::vector<uint16_t> positionKeys(PositionEngine& engine) {
+    uint16_t count = 0;
+    const TrainPosition* positions = engine.getActiveTrainPositions(&count);
+    std::vector<uint16_t> keys(count);
+    for (uint16_t i = 0; i < count; i++) {
+        keys[i] = (uint16_t)((positions[i].isNorthbound ? 0x100 : 0) | positions[i].ledIndex);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+/**
+ * Events as sorted (type, station, LED, direction) keys
+ */
+std::vector<uint32_t> eventKeys(PositionEngine& engine) {
+    uint16_t count = 0;
+    const TrainEvent* events = engine.getEvents(&count);
+    std::vector<uint32_t> keys(count);
+    for (uint16_t i = 0; i < count; i++) {
+        keys[i] = ((uint32_t)events[i].type << 24) | ((uint32_t)events[i].station << 16) |
+                  ((uint32_t)events[i].ledIndex << 8) | (events[i].isNorthbound ? 1 : 0);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t updates = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200000;
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 2) {
+        if (!timetable.openFile(argv[2]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[2]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    uint32_t wheelMismatches = checkTimingWheel();
+
+    PositionEngine tracked;
+    PositionEngine event;
+    tracked.setLogging(false);
+    event.setLogging(false);
+    tracked.init(&schedule);
+    event.init(&schedule);
+    event.setMode(POSITION_MODE_EVENT);
+
+    struct tm startInfo = {};
+    startInfo.tm_year = 2025 - 1900;
+    startInfo.tm_mon = 9;
+    startInfo.tm_mday = 15;
+    startInfo.tm_hour = 4;
+    startInfo.tm_isdst = -1;
+    int64_t startMillis = (int64_t)mktime(&startInfo) * 1000;
+
+    // Frame-sized steps, with occasional backward seeks and jumps of up to 20 hours
+    srand(7);
+    int64_t nowMillis = startMillis;
+    uint32_t positionMismatches = 0;
+    uint32_t eventMismatches = 0;
+    for (uint32_t i = 0; i < updates; i++) {
+        int choice = rand() % 1000;
+        int64_t step = (choice < 990) ? rand() % 1500
+                     : (choice < 995) ? -(int64_t)(rand() % 600000)
+                                      : (int64_t)(rand() % (20 * 3600000));
+        nowMillis = std::max(startMillis, nowMillis + step);
+
+        tracked.updateAllTrainsMillis(nowMillis);
+        event.updateAllTrainsMillis(nowMillis);
+        if (positionKeys(tracked) != positionKeys(event)) {
+            if (positionMismatches < 5) {
+                printf("  positions differ at %lld ms (step %lld)\n", (long long)nowMillis, (long long)step);
+            }
+            positionMismatches++;
+        }
+
+        // Events are compared on frame steps; a long jump reports only its net changes
+        if (step >= 0 && step < 1500 && eventKeys(tracked) != eventKeys(event)) {
+            if (eventMismatches < 5) {
+                printf("  events differ at %lld ms (step %lld)\n", (long long)nowMillis, (long long)step);
+            }
+            eventMismatches++;
+        }
+    }
+
+    printf("event vs tracked: %u updates, positions %s, events %s\n", updates,
+           positionMismatches == 0 ? "match" : "MISMATCH", eventMismatches == 0 ? "match" : "MISMATCH");
+    return (wheelMismatches == 0 && positionMismatches == 0 && eventMismatches == 0) ? 0 : 1;
+}
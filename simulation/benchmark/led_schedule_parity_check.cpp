@@ -0,0 +1,147 @@
+/**
+ * LED Schedule Parity Check
+ * Builds each service day's LED schedule, replays it with one cursor over
+ * memory and one through a block reader, and checks both against a
+ * tracked-mode PositionEngine at random times (including backward seeks)
+ *
+ * Usage: led_schedule_parity_check [days] [updates] [timetable.bin]
+ *   days           Service days to check, from 2025-10-13 (default 7)
+ *   updates        Random times per day (default 50000)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/position_engine.h"
+#include "../../core/led_schedule.h"
+
+namespace {
+
+// First and last replayed time: 03:00 to 03:00 the next day, in ms after service-day midnight
+const uint32_t REPLAY_START_MILLIS = 3u * 3600 * 1000;
+const uint32_t REPLAY_END_MILLIS = 27u * 3600 * 1000;
+
+/**
+ * Block reader over an in-memory schedule, standing in for a flash partition
+ */
+bool readBlock(uint32_t blockIndex, uint8_t* block, void* context) {
+    const std::vector<uint8_t>* data = (const std::vector<uint8_t>*)context;
+    size_t offset = (size_t)blockIndex * LED_SCHEDULE_BLOCK_BYTES;
+    if (offset + LED_SCHEDULE_BLOCK_BYTES > data->size()) {
+        return false;
+    }
+    memcpy(block, data->data() + offset, LED_SCHEDULE_BLOCK_BYTES);
+    return true;
+}
+
+/**
+ * Positions as sorted (direction, LED) keys; slot order differs between engine and cursor
+ */
+std::vector<uint16_t> positionKeys(const TrainPosition* positions, uint16_t count) {
+    std::vector<uint16_t> keys(count);
+    for (uint16_t i = 0; i < count; i++) {
+        keys[i] = (uint16_t)((positions[i].isNorthbound ? 0x100 : 0) | positions[i].ledIndex);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t days = (argc > 1) ? (uint32_t)atoi(argv[1]) : 7;
+    uint32_t updates = (argc > 2) ? (uint32_t)atoi(argv[2]) : 50000;
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 3) {
+        if (!timetable.openFile(argv[3]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[3]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    PositionEngine builderEngine;
+    PositionEngine tracked;
+    builderEngine.setLogging(false);
+    tracked.setLogging(false);
+    builderEngine.init(&schedule);
+    tracked.init(&schedule);
+
+    LedScheduleBuilder builder;
+    bool allMatch = true;
+    srand(1);
+    for (uint32_t day = 0; day < days; day++) {
+        struct tm noonInfo = {};
+        noonInfo.tm_year = 2025 - 1900;
+        noonInfo.tm_mon = 9;
+        noonInfo.tm_mday = 13 + (int)day;
+        noonInfo.tm_hour = 12;
+        noonInfo.tm_isdst = -1;
+        time_t dayStart = schedule.getServiceDayStart(mktime(&noonInfo));
+
+        uint32_t size = builder.buildToMemory(&builderEngine, &schedule, dayStart, nullptr, 0);
+        std::vector<uint8_t> data(size);
+        builder.buildToMemory(&builderEngine, &schedule, dayStart, data.data(), size);
+
+        LedScheduleCursor memoryCursor;
+        LedScheduleCursor readerCursor;
+        memoryCursor.initFromMemory(data.data(), size);
+        readerCursor.initFromReader(readBlock, &data, size / LED_SCHEDULE_BLOCK_BYTES);
+
+        // Mostly frame-sized steps, with occasional clock corrections, backward seeks and hour-long jumps
+        uint32_t mismatches = 0;
+        uint32_t dayMillis = REPLAY_START_MILLIS;
+        for (uint32_t i = 0; i < updates; i++) {
+            int choice = rand() % 1000;
+            if (choice < 990) {
+                dayMillis += rand() % 1000;
+            } else if (choice < 995) {
+                dayMillis -= std::min<uint32_t>(dayMillis - REPLAY_START_MILLIS, rand() % 2000);
+            } else if (choice < 998) {
+                dayMillis -= std::min<uint32_t>(dayMillis - REPLAY_START_MILLIS, rand() % 3600000);
+            } else {
+                dayMillis += rand() % 3600000;
+            }
+            if (dayMillis >= REPLAY_END_MILLIS) {
+                // Past the end of the day: seek back near its start
+                dayMillis = REPLAY_START_MILLIS + rand() % 3600000;
+            }
+
+            tracked.updateAllTrainsMillis((int64_t)dayStart * 1000 + dayMillis);
+            memoryCursor.advanceTo(dayMillis);
+            readerCursor.advanceTo(dayMillis);
+
+            uint16_t trackedCount = 0;
+            uint16_t memoryCount = 0;
+            uint16_t readerCount = 0;
+            const TrainPosition* trackedPositions = tracked.getActiveTrainPositions(&trackedCount);
+            const TrainPosition* memoryPositions = memoryCursor.getActiveTrainPositions(&memoryCount);
+            const TrainPosition* readerPositions = readerCursor.getActiveTrainPositions(&readerCount);
+            std::vector<uint16_t> expected = positionKeys(trackedPositions, trackedCount);
+            if (positionKeys(memoryPositions, memoryCount) != expected ||
+                positionKeys(readerPositions, readerCount) != expected) {
+                if (mismatches < 5) {
+                    printf("  positions differ at %u ms after service-day midnight\n", dayMillis);
+                }
+                mismatches++;
+            }
+        }
+
+        printf("day %u: %u transitions in %u blocks, %u times, %s\n", day, builder.getTransitionCount(),
+               size / LED_SCHEDULE_BLOCK_BYTES, updates, mismatches == 0 ? "matches" : "MISMATCH");
+        allMatch = allMatch && mismatches == 0;
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/**
+ * Monte Carlo Thread Check
+ * Runs the same seed, model and window on one thread and on several, and
+ * checks that every metric's histogram, count, extremes and percentiles
+ * are identical (sums may differ in the last bits from merge order)
+ *
+ * Usage: monte_carlo_thread_check [runs] [timetable.bin]
+ *   runs           Runs per simulation (default 64)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/monte_carlo.h"
+
+namespace {
+
+const float PERCENTILES[] = {0.0f, 1.0f, 5.0f, 25.0f, 50.0f, 75.0f, 95.0f, 99.0f, 100.0f};
+
+const char* METRIC_NAMES[MONTE_CARLO_METRIC_COUNT] = {"bunched seconds", "min spacing", "mean delay", "max delay"};
+
+/**
+ * Summaries and percentiles of one simulation
+ */
+struct Result {
+    MonteCarloSummary summaries[MONTE_CARLO_METRIC_COUNT];
+    float percentiles[MONTE_CARLO_METRIC_COUNT][sizeof(PERCENTILES) / sizeof(PERCENTILES[0])];
+};
+
+/**
+ * Run a simulation and copy out its results
+ * @return Number of threads used
+ */
+uint16_t runOnce(MonteCarloSimulator& simulator, time_t start, uint32_t runCount, uint64_t seed,
+                 uint16_t threadCount, Result* result) {
+    uint16_t used = simulator.run(start, start + 4 * 3600, 1, runCount, seed, threadCount);
+    for (uint8_t metric = 0; metric < MONTE_CARLO_METRIC_COUNT; metric++) {
+        result->summaries[metric] = *simulator.getSummary(metric);
+        for (size_t i = 0; i < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); i++) {
+            result->percentiles[metric][i] = simulator.getPercentile(metric, PERCENTILES[i]);
+        }
+    }
+    return used;
+}
+
+/**
+ * Compare two simulations metric by metric
+ * @return Number of metrics that differ
+ */
+uint32_t compare(const Result& expected, const Result& actual, uint16_t threadCount) {
+    uint32_t mismatches = 0;
+    for (uint8_t metric = 0; metric < MONTE_CARLO_METRIC_COUNT; metric++) {
+        const MonteCarloSummary& a = expected.summaries[metric];
+        const MonteCarloSummary& b = actual.summaries[metric];
+        bool same = memcmp(a.bins, b.bins, sizeof(a.bins)) == 0 && a.count == b.count &&
+                    a.lowerBound == b.lowerBound && a.binWidth == b.binWidth && a.minimum == b.minimum &&
+                    a.maximum == b.maximum && std::fabs(a.sum - b.sum) <= 1e-9 * std::fabs(a.sum) &&
+                    memcmp(expected.percentiles[metric], actual.percentiles[metric],
+                           sizeof(expected.percentiles[metric])) == 0;
+        if (!same) {
+            printf("  %s differs on %u threads\n", METRIC_NAMES[metric], threadCount);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t runCount = (argc > 1) ? (uint32_t)atoi(argv[1]) : 64;
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 2) {
+        if (!timetable.openFile(argv[2]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[2]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    struct tm startInfo = {};
+    startInfo.tm_year = 2025 - 1900;
+    startInfo.tm_mon = 9;
+    startInfo.tm_mday = 15;
+    startInfo.tm_hour = 6;
+    startInfo.tm_isdst = -1;
+    time_t start = mktime(&startInfo);
+
+    MonteCarloSimulator simulator;
+    simulator.init(&schedule);
+    simulator.setModel({{DELAY_EXPONENTIAL, 60.0f}, {DELAY_NORMAL, 15.0f}, {DELAY_UNIFORM, 10.0f}});
+
+    // Results are heap-allocated: each holds four full histograms
+    Result* reference = new Result;
+    Result* result = new Result;
+    runOnce(simulator, start, runCount, 42, 1, reference);
+
+    // Fixed counts, so the check is the same on any machine; uneven ones leave some threads more runs
+    const uint16_t threadCounts[] = {2, 3, 5, 8};
+    uint32_t mismatches = 0;
+    for (uint16_t threadCount : threadCounts) {
+        uint16_t used = runOnce(simulator, start, runCount, 42, threadCount, result);
+        mismatches += compare(*reference, *result, used);
+    }
+
+    // A different seed must change the draws, or the comparison above proves nothing
+    runOnce(simulator, start, runCount, 43, 1, result);
+    const MonteCarloSummary& seedA = reference->summaries[MONTE_CARLO_MEAN_DELAY];
+    const MonteCarloSummary& seedB = result->summaries[MONTE_CARLO_MEAN_DELAY];
+    if (memcmp(seedA.bins, seedB.bins, sizeof(seedA.bins)) == 0) {
+        printf("  seeds 42 and 43 give the same mean delay histogram\n");
+        mismatches++;
+    }
+
+    for (uint8_t metric = 0; metric < MONTE_CARLO_METRIC_COUNT; metric++) {
+        printf("%s: p5 %.2f p50 %.2f p95 %.2f\n", METRIC_NAMES[metric], reference->percentiles[metric][2],
+               reference->percentiles[metric][4], reference->percentiles[metric][6]);
+    }
+    printf("monte carlo: %u runs, 1 vs %u-%u threads, %s\n", runCount, threadCounts[0],
+           threadCounts[sizeof(threadCounts) / sizeof(threadCounts[0]) - 1], mismatches == 0 ? "matches" : "MISMATCH");
+
+    delete reference;
+    delete result;
+    return mismatches == 0 ? 0 : 1;
+}
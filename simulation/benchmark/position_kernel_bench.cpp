@@ -0,0 +1,137 @@
+/**
+ * Position Kernel Benchmark
+ * Places a large synthetic fleet with every kernel the CPU supports, checks
+ * each against PositionEngine's scalar placement and reports the throughput
+ *
+ * Usage: position_kernel_bench [trains] [steps] [timetable.bin]
+ *   trains         Fleet size (default 65536)
+ *   steps          Timesteps to evaluate, 5 s apart (default 2000)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/position_engine.h"
+#include "../../core/position_kernel.h"
+
+namespace {
+
+const char* KERNEL_NAMES[] = {"scalar", "sse4.1", "avx2"};
+
+/**
+ * Reference placement: PositionEngine for station and progress, with the
+ * LED rounding used by PositionEngine when it builds positions
+ */
+bool referencePosition(PositionEngine& engine, ScheduleModule& schedule, int32_t currentSeconds,
+                       int32_t departureSeconds, bool isNorthbound, uint8_t* station, float* progress, uint8_t* led) {
+    Train train = {};
+    train.isNorthbound = isNorthbound;
+    train.departureTime = departureSeconds;
+    train.pattern = isNorthbound ? TIMETABLE_PATTERN_FULL_NORTHBOUND : TIMETABLE_PATTERN_FULL_SOUTHBOUND;
+    train.isActive = true;
+    engine.calculateTrainPosition(&train, currentSeconds);
+    if (!train.isActive) {
+        return false;
+    }
+
+    float currentLED = schedule.getStation(train.currentStation)->ledIndex;
+    float nextLED = schedule.getStation(train.nextStation)->ledIndex;
+    float interpolatedLED = currentLED + (nextLED - currentLED) * train.progress;
+    uint8_t ledIndex = (uint8_t)(interpolatedLED + 0.5);
+    if (ledIndex > 99) ledIndex = 99;
+
+    *station = train.currentStation;
+    *progress = train.progress;
+    *led = ledIndex;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t trainCount = (argc > 1) ? (uint32_t)atoi(argv[1]) : 65536;
+    uint32_t steps = (argc > 2) ? (uint32_t)atoi(argv[2]) : 2000;
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 3) {
+        if (!timetable.openFile(argv[3]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[3]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    PositionEngine engine;
+    engine.init(&schedule);
+    PositionKernel kernel;
+    if (!kernel.init(&schedule)) {
+        fprintf(stderr, "Schedule has too many stations for the kernel\n");
+        return 1;
+    }
+
+    // Departures spread over a service day, both directions mixed
+    std::vector<int32_t> departures(trainCount);
+    std::vector<uint8_t> directions(trainCount);
+    srand(1);
+    for (uint32_t i = 0; i < trainCount; i++) {
+        departures[i] = 5 * 3600 + rand() % (20 * 3600);
+        directions[i] = (uint8_t)(rand() & 1);
+    }
+    std::vector<uint8_t> stations(trainCount);
+    std::vector<float> progress(trainCount);
+    std::vector<uint8_t> leds(trainCount);
+
+    uint8_t bestKernel = PositionKernel::getBestKernel();
+    double scalarSeconds = 0.0;
+    bool allMatch = true;
+    printf("%u trains x %u steps, best kernel %s\n", trainCount, steps, KERNEL_NAMES[bestKernel]);
+
+    for (uint8_t k = POSITION_KERNEL_SCALAR; k <= bestKernel; k++) {
+        kernel.setKernel(k);
+
+        // Correctness: every train at a spread of times against the engine
+        uint32_t mismatches = 0;
+        for (int32_t t = 4 * 3600; t < 27 * 3600; t += 397) {
+            kernel.evaluate(t, departures.data(), directions.data(), trainCount, stations.data(), progress.data(), leds.data());
+            for (uint32_t i = 0; i < trainCount; i++) {
+                uint8_t station = 0;
+                float fraction = 0.0f;
+                uint8_t led = 0;
+                bool onLine = referencePosition(engine, schedule, t, departures[i], directions[i] != 0,
+                                                &station, &fraction, &led);
+                bool match = onLine ? (stations[i] == station && progress[i] == fraction && leds[i] == led)
+                                    : (leds[i] == POSITION_KERNEL_FINISHED);
+                if (!match) {
+                    mismatches++;
+                }
+            }
+        }
+        allMatch = allMatch && mismatches == 0;
+
+        // Throughput
+        uint64_t onLine = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t step = 0; step < steps; step++) {
+            int32_t t = 5 * 3600 + (int32_t)step * 5;
+            onLine += kernel.evaluate(t, departures.data(), directions.data(), trainCount,
+                                      stations.data(), progress.data(), leds.data());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (k == POSITION_KERNEL_SCALAR) {
+            scalarSeconds = seconds;
+        }
+
+        double nanosPerTrain = seconds * 1e9 / ((double)trainCount * steps);
+        printf("  %-7s %7.2f ns/train  %6.2fx  %s  (%llu on line)\n", KERNEL_NAMES[k], nanosPerTrain,
+               scalarSeconds / seconds, mismatches == 0 ? "matches" : "MISMATCH", (unsigned long long)onLine);
+    }
+
+    return allMatch ? 0 : 1;
+}
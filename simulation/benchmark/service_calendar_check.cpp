@@ -0,0 +1,154 @@
+/**
+ * Service Calendar Check
+ * Table-driven check of ServiceCalendar over 2024-2027: the day-of-week
+ * pattern, the holiday rules in line_data.h (fixed dates, last Monday in
+ * May, first Monday in September, fourth Thursday in November) and the
+ * days around them, and date exceptions overriding both
+ *
+ * Usage: service_calendar_check
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <cstdio>
+
+#include "../../core/schedule_module.h"
+#include "../../core/service_calendar.h"
+
+namespace {
+
+struct DateCase {
+    uint32_t date;            // YYYYMMDD
+    uint8_t serviceId;        // Expected service
+    const char* note;
+};
+
+const DateCase DATE_CASES[] = {
+    // Day-of-week pattern
+    {20251017, SERVICE_WEEKDAY,  "Friday"},
+    {20251018, SERVICE_SATURDAY, "Saturday"},
+    {20251019, SERVICE_SUNDAY,   "Sunday"},
+    {20251020, SERVICE_WEEKDAY,  "Monday"},
+    {20240229, SERVICE_WEEKDAY,  "leap day (Thursday)"},
+
+    // Fixed-date holidays, including ones that fall on a weekend
+    {20240101, SERVICE_SUNDAY,   "New Year's Day 2024"},
+    {20270101, SERVICE_SUNDAY,   "New Year's Day 2027"},
+    {20240704, SERVICE_SUNDAY,   "Independence Day 2024"},
+    {20260704, SERVICE_SUNDAY,   "Independence Day 2026 (Saturday)"},
+    {20250703, SERVICE_WEEKDAY,  "day before Independence Day 2025"},
+    {20251225, SERVICE_SUNDAY,   "Christmas 2025"},
+    {20271225, SERVICE_SUNDAY,   "Christmas 2027 (Saturday)"},
+    {20251226, SERVICE_WEEKDAY,  "day after Christmas 2025"},
+
+    // Memorial Day: last Monday in May
+    {20240527, SERVICE_SUNDAY,   "Memorial Day 2024"},
+    {20250526, SERVICE_SUNDAY,   "Memorial Day 2025"},
+    {20260525, SERVICE_SUNDAY,   "Memorial Day 2026"},
+    {20270531, SERVICE_SUNDAY,   "Memorial Day 2027 (May 31)"},
+    {20270524, SERVICE_WEEKDAY,  "fourth Monday in May 2027, not the last"},
+    {20250519, SERVICE_WEEKDAY,  "Monday before Memorial Day 2025"},
+    {20250602, SERVICE_WEEKDAY,  "first Monday in June 2025"},
+
+    // Labor Day: first Monday in September
+    {20240902, SERVICE_SUNDAY,   "Labor Day 2024"},
+    {20250901, SERVICE_SUNDAY,   "Labor Day 2025 (September 1)"},
+    {20260907, SERVICE_SUNDAY,   "Labor Day 2026 (September 7)"},
+    {20270906, SERVICE_SUNDAY,   "Labor Day 2027"},
+    {20250908, SERVICE_WEEKDAY,  "second Monday in September 2025"},
+    {20260831, SERVICE_WEEKDAY,  "last Monday in August 2026"},
+
+    // Thanksgiving: fourth Thursday in November
+    {20241128, SERVICE_SUNDAY,   "Thanksgiving 2024 (November 28)"},
+    {20251127, SERVICE_SUNDAY,   "Thanksgiving 2025"},
+    {20261126, SERVICE_SUNDAY,   "Thanksgiving 2026"},
+    {20271125, SERVICE_SUNDAY,   "Thanksgiving 2027"},
+    {20251120, SERVICE_WEEKDAY,  "third Thursday in November 2025"},
+    {20241121, SERVICE_WEEKDAY,  "third Thursday in November 2024"},
+    {20261128, SERVICE_SATURDAY, "Saturday after Thanksgiving 2026"},
+};
+
+/**
+ * Convert YYYYMMDD to days since 1970-01-01
+ */
+int32_t dayNumber(uint32_t date) {
+    return daysFromCivil((int32_t)(date / 10000), (date / 100) % 100, date % 100);
+}
+
+/**
+ * Compare one date's service with the expected one
+ * @return 1 on mismatch, 0 otherwise
+ */
+uint32_t check(ServiceCalendar& calendar, uint32_t date, uint8_t expected, const char* note) {
+    uint8_t actual = calendar.getServiceId(dayNumber(date));
+    if (actual != expected) {
+        printf("  %u (%s): service %u, expected %u\n", date, note, actual, expected);
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main() {
+    uint32_t mismatches = 0;
+    uint32_t caseCount = sizeof(DATE_CASES) / sizeof(DATE_CASES[0]);
+
+    ServiceCalendar calendar;
+    for (uint32_t i = 0; i < caseCount; i++) {
+        mismatches += check(calendar, DATE_CASES[i].date, DATE_CASES[i].serviceId, DATE_CASES[i].note);
+    }
+
+    // Exceptions override both the holiday rules and the weekday pattern
+    calendar.addException(20251127, SERVICE_WEEKDAY);
+    calendar.addException(20251020, SERVICE_NONE);
+    calendar.addException(20251018, SERVICE_SUNDAY);
+    mismatches += check(calendar, 20251127, SERVICE_WEEKDAY, "exception on Thanksgiving");
+    mismatches += check(calendar, 20251020, SERVICE_NONE, "no-service exception");
+    mismatches += check(calendar, 20251018, SERVICE_SUNDAY, "exception on a Saturday");
+    mismatches += check(calendar, 20251021, SERVICE_WEEKDAY, "day after an exception");
+
+    // Adding the same date again replaces it
+    calendar.addException(20251020, SERVICE_SATURDAY);
+    mismatches += check(calendar, 20251020, SERVICE_SATURDAY, "replaced exception");
+
+    // Clearing restores the rules
+    calendar.clearExceptions();
+    mismatches += check(calendar, 20251127, SERVICE_SUNDAY, "Thanksgiving after clear");
+    mismatches += check(calendar, 20251020, SERVICE_WEEKDAY, "Monday after clear");
+
+    // The table holds MAX_SERVICE_EXCEPTIONS dates and refuses the next
+    bool filled = true;
+    for (uint32_t i = 0; i < MAX_SERVICE_EXCEPTIONS; i++) {
+        uint32_t date = (i < 16) ? 20260301 + i : 20260401 + (i - 16);
+        filled = calendar.addException(date, SERVICE_SATURDAY) && filled;
+    }
+    if (!filled || calendar.addException(20260201, SERVICE_SATURDAY)) {
+        printf("  exception table capacity is not MAX_SERVICE_EXCEPTIONS\n");
+        mismatches++;
+    }
+    mismatches += check(calendar, 20260201, SERVICE_SUNDAY, "refused exception (Sunday)");
+
+    // ScheduleModule routes its service-day start through the same calendar
+    ScheduleModule schedule;
+    schedule.loadSchedule();
+    struct tm noonInfo = {};
+    noonInfo.tm_year = 2025 - 1900;
+    noonInfo.tm_mon = 10;
+    noonInfo.tm_mday = 27;
+    noonInfo.tm_hour = 12;
+    noonInfo.tm_isdst = -1;
+    time_t thanksgiving = schedule.getServiceDayStart(mktime(&noonInfo));
+    if (schedule.getServiceId(thanksgiving) != SERVICE_SUNDAY) {
+        printf("  ScheduleModule: Thanksgiving 2025 is not Sunday service\n");
+        mismatches++;
+    }
+    schedule.addServiceException(20251127, SERVICE_NONE);
+    if (schedule.getServiceId(thanksgiving) != SERVICE_NONE) {
+        printf("  ScheduleModule: exception not applied\n");
+        mismatches++;
+    }
+
+    printf("service calendar: %u dates, %s\n", caseCount, mismatches == 0 ? "matches" : "MISMATCH");
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/**
+ * Service Clock Check
+ * Drives a ServiceClock through 2025 in several time zones and compares its
+ * wall-clock time, date, weekday and service-day midnights with localtime():
+ * every 97 s across the year, every second for three hours either side of
+ * each UTC offset change (spring-forward and fall-back), and random jumps
+ * backward and forward
+ *
+ * Usage: service_clock_check [samples]
+ *   samples        Random jumps per time zone (default 20000)
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include "../../core/service_clock.h"
+
+namespace {
+
+struct ZoneCase {
+    const char* tz;
+    uint32_t offsetChanges;   // UTC offset changes expected in 2025
+};
+
+const ZoneCase ZONES[] = {
+    {"UTC0", 0},
+    {"America/Los_Angeles", 2},
+    {"America/New_York", 2},
+    {"America/St_Johns", 2},      // -3:30, half-hour zone with DST
+    {"Europe/London", 2},
+    {"Australia/Sydney", 2},      // Southern hemisphere: fall-back in April, spring-forward in October
+    {"Asia/Kolkata", 0},          // +5:30, no DST
+    {"Pacific/Chatham", 2},       // +12:45/+13:45
+};
+
+// 2025-01-01 00:00 UTC, less three days so the first local days are covered in every zone
+const time_t SWEEP_START = 1735689600 - 3 * 86400;
+const time_t SWEEP_END = 1735689600 + 365 * 86400;
+
+/**
+ * Local date of a time as days since 1970-01-01
+ */
+int32_t localDayNumber(const struct tm& timeinfo) {
+    return daysFromCivil(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday);
+}
+
+/**
+ * Check that a time is local midnight of a date
+ */
+bool isMidnightOf(time_t time, int32_t dayNumber) {
+    struct tm timeinfo;
+    localtime_r(&time, &timeinfo);
+    return timeinfo.tm_hour == 0 && timeinfo.tm_min == 0 && timeinfo.tm_sec == 0 &&
+           localDayNumber(timeinfo) == dayNumber;
+}
+
+/**
+ * Move the clock to a time and compare every getter with localtime()
+ * @return true if all agree
+ */
+bool checkTime(ServiceClock& clock, time_t time) {
+    clock.update(time);
+
+    struct tm timeinfo;
+    localtime_r(&time, &timeinfo);
+    uint32_t secondOfDay = (uint32_t)(timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec);
+    int32_t dayNumber = localDayNumber(timeinfo);
+
+    int32_t year = 0;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    clock.getDate(&year, &month, &day);
+    if (clock.getSecondOfDay() != secondOfDay || clock.getDayNumber() != dayNumber ||
+        clock.getWeekday() != timeinfo.tm_wday || year != timeinfo.tm_year + 1900 ||
+        month != timeinfo.tm_mon + 1 || day != timeinfo.tm_mday || clock.toDayNumber(time) != dayNumber) {
+        return false;
+    }
+
+    // Service day starts at SERVICE_DAY_START_MINUTES; before that it is still yesterday's
+    int32_t serviceDay = (secondOfDay < SERVICE_DAY_START_MINUTES * 60u) ? dayNumber - 1 : dayNumber;
+    return clock.getServiceDayNumber() == serviceDay && isMidnightOf(clock.getMidnight(), dayNumber) &&
+           isMidnightOf(clock.getServiceDayStart(), serviceDay) &&
+           isMidnightOf(clock.getNextServiceDayStart(), serviceDay + 1);
+}
+
+/**
+ * UTC offset from localtime()
+ */
+long utcOffset(time_t time) {
+    struct tm timeinfo;
+    localtime_r(&time, &timeinfo);
+    return timeinfo.tm_gmtoff;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t samples = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20000;
+
+    bool allMatch = true;
+    srand(1);
+    for (const ZoneCase& zone : ZONES) {
+        setenv("TZ", zone.tz, 1);
+        tzset();
+
+        // Find the offset changes first, so the per-second sweeps are independent of the clock
+        std::vector<time_t> changes;
+        for (time_t time = SWEEP_START + 60; time < SWEEP_END; time += 60) {
+            if (utcOffset(time) != utcOffset(time - 60)) {
+                changes.push_back(time);
+            }
+        }
+
+        ServiceClock clock;
+        uint32_t checked = 0;
+        uint32_t mismatches = 0;
+        auto check = [&](time_t time) {
+            checked++;
+            if (!checkTime(clock, time)) {
+                if (mismatches < 5) {
+                    printf("  %s: clock differs from localtime() at %lld\n", zone.tz, (long long)time);
+                }
+                mismatches++;
+            }
+        };
+
+        for (time_t time = SWEEP_START; time < SWEEP_END; time += 97) {
+            check(time);
+        }
+        for (time_t change : changes) {
+            for (time_t time = change - 3 * 3600; time < change + 3 * 3600; time++) {
+                check(time);
+            }
+        }
+        for (uint32_t i = 0; i < samples; i++) {
+            check(SWEEP_START + (time_t)(((uint64_t)rand() * RAND_MAX + rand()) % (SWEEP_END - SWEEP_START)));
+        }
+
+        if (changes.size() != zone.offsetChanges) {
+            printf("  %s: %zu offset changes, expected %u (missing zoneinfo?)\n", zone.tz, changes.size(),
+                   zone.offsetChanges);
+            mismatches++;
+        }
+
+        printf("%s: %zu offset changes, %u times, %s\n", zone.tz, changes.size(), checked,
+               mismatches == 0 ? "matches" : "MISMATCH");
+        allMatch = allMatch && mismatches == 0;
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * Sweep Runner Benchmark
+ * Runs a capacity sweep over a year of service days for several scenarios,
+ * single-threaded and then on every thread, and reports the scaling
+ *
+ * Usage: sweep_bench [scenarios] [days] [threads] [timetable.bin]
+ *   scenarios      Copies of the schedule to sweep, with rising fleet limits (default 12)
+ *   days           Service days from 2025-01-01 (default 365)
+ *   threads        Threads for the parallel run (default: all hardware threads)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/sweep_runner.h"
+
+namespace {
+
+double runSweep(SweepRunner& runner, time_t firstDay, uint16_t days, uint16_t threads, uint16_t* threadsUsed) {
+    auto start = std::chrono::steady_clock::now();
+    *threadsUsed = runner.run(firstDay, days, 1, threads);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint16_t scenarios = (argc > 1) ? (uint16_t)atoi(argv[1]) : 12;
+    uint16_t days = (argc > 2) ? (uint16_t)atoi(argv[2]) : 365;
+    uint16_t threads = (argc > 3) ? (uint16_t)atoi(argv[3]) : 0;
+    if (scenarios == 0 || scenarios > MAX_SWEEP_SCENARIOS || days == 0) {
+        fprintf(stderr, "Need 1-%d scenarios and at least one day\n", MAX_SWEEP_SCENARIOS);
+        return 1;
+    }
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 4) {
+        if (!timetable.openFile(argv[4]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[4]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    // Same schedule, fleet limits from 10 trains up
+    SweepRunner runner;
+    for (uint16_t i = 0; i < scenarios; i++) {
+        runner.addScenario(&schedule, (uint16_t)(10 + i));
+    }
+
+    struct tm dayInfo = {};
+    dayInfo.tm_year = 2025 - 1900;
+    dayInfo.tm_mon = 0;
+    dayInfo.tm_mday = 1;
+    dayInfo.tm_hour = 12;
+    dayInfo.tm_isdst = -1;
+    time_t firstDay = mktime(&dayInfo);
+
+    uint16_t threadsUsed = 0;
+    double serialSeconds = runSweep(runner, firstDay, days, 1, &threadsUsed);
+    std::vector<SweepResult> serialResults(scenarios);
+    for (uint16_t i = 0; i < scenarios; i++) {
+        serialResults[i] = *runner.getResult(i);
+    }
+    double parallelSeconds = runSweep(runner, firstDay, days, threads, &threadsUsed);
+
+    bool match = true;
+    for (uint16_t i = 0; i < scenarios; i++) {
+        const SweepResult* result = runner.getResult(i);
+        match = match && result->peakTrains == serialResults[i].peakTrains &&
+                result->peakTime == serialResults[i].peakTime &&
+                result->secondsOverLimit == serialResults[i].secondsOverLimit &&
+                result->daysOverLimit == serialResults[i].daysOverLimit &&
+                result->trainSeconds == serialResults[i].trainSeconds;
+    }
+
+    printf("%u scenarios x %u days at 1 s steps\n", scenarios, days);
+    printf("  1 thread    %8.2f s\n", serialSeconds);
+    printf("  %-3u threads %8.2f s  %5.2fx  %s\n", threadsUsed, parallelSeconds, serialSeconds / parallelSeconds,
+           match ? "matches" : "MISMATCH");
+    for (uint16_t i = 0; i < scenarios; i++) {
+        const SweepResult* result = runner.getResult(i);
+        struct tm peakInfo;
+        localtime_r(&result->peakTime, &peakInfo);
+        char peakText[32];
+        strftime(peakText, sizeof(peakText), "%Y-%m-%d %H:%M:%S", &peakInfo);
+        printf("  limit %3u: peak %3u at %s, over limit on %u days (%llu s), %llu dropped\n", 10 + i,
+               result->peakTrains, peakText, result->daysOverLimit, (unsigned long long)result->secondsOverLimit,
+               (unsigned long long)result->overflowCount);
+    }
+    return match ? 0 : 1;
+}
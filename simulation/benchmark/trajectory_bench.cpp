@@ -0,0 +1,84 @@
+/**
+ * Trajectory Simulator Benchmark
+ * Simulates whole service days at a fixed step into a preallocated buffer
+ * and reports the time per simulated day
+ *
+ * Usage: trajectory_bench [days] [step] [timetable.bin]
+ *   days           Service days to simulate, from 2025-10-13 03:00 local (default 7)
+ *   step           Seconds between ticks (default 1)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/trajectory_simulator.h"
+
+int main(int argc, char** argv) {
+    uint32_t days = (argc > 1) ? (uint32_t)atoi(argv[1]) : 7;
+    uint32_t step = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1;
+    if (days == 0 || step == 0) {
+        fprintf(stderr, "days and step must be positive\n");
+        return 1;
+    }
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 3) {
+        if (!timetable.openFile(argv[3]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[3]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+
+    TrajectorySimulator simulator;
+    simulator.init(&schedule);
+
+    // One service day of output, reused for every day
+    struct tm startInfo = {};
+    startInfo.tm_year = 2025 - 1900;
+    startInfo.tm_mon = 9;
+    startInfo.tm_mday = 13;
+    startInfo.tm_hour = 3;
+    startInfo.tm_isdst = -1;
+    time_t start = mktime(&startInfo);
+
+    const uint16_t trainsPerTick = 64;
+    uint32_t ticksPerDay = TrajectorySimulator::getTickCount(start, start + 86400, step);
+    std::vector<uint16_t> trainCounts(ticksPerDay);
+    std::vector<uint8_t> ledOccupancy((size_t)ticksPerDay * LINE_LED_COUNT);
+    std::vector<uint16_t> ledPositions((size_t)ticksPerDay * trainsPerTick);
+    std::vector<uint8_t> directions((size_t)ticksPerDay * trainsPerTick);
+    TrajectoryBuffer buffer = {trainCounts.data(), ledOccupancy.data(), ledPositions.data(), directions.data(),
+                               ticksPerDay, trainsPerTick};
+
+    double totalSeconds = 0.0;
+    uint64_t trainTicks = 0;
+    uint16_t peak = 0;
+    for (uint32_t day = 0; day < days; day++) {
+        time_t dayStart = start + (time_t)day * 86400;
+        time_t dayEnd = dayStart + 86400;
+
+        auto begin = std::chrono::steady_clock::now();
+        uint32_t ticks = simulator.simulateRange(dayStart, dayEnd, step, &buffer);
+        totalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            trainTicks += trainCounts[tick];
+            if (trainCounts[tick] > peak) {
+                peak = trainCounts[tick];
+            }
+        }
+    }
+
+    printf("%u service days at %u s steps: %.2f ms per day, %.1f ns per tick, peak %u trains, %llu train-ticks\n",
+           days, step, totalSeconds * 1e3 / days, totalSeconds * 1e9 / ((double)days * ticksPerDay), peak,
+           (unsigned long long)trainTicks);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * Trip Interval Index Check
+ * Builds each service day's TripTable and TripIntervalIndex and compares
+ * query() with a brute-force departure <= t < end scan at every trip's
+ * departure and end (node centers are departures, so this covers
+ * seconds == center), one second either side, and random times
+ *
+ * Usage: trip_interval_index_check [days] [samples] [timetable.bin]
+ *   days           Service days to check, from 2025-10-13 (default 7)
+ *   samples        Random times per day (default 20000)
+ *   timetable.bin  Binary timetable (default: compiled-in schedule)
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/trip_table.h"
+#include "../../core/trip_interval_index.h"
+
+namespace {
+
+TripTable tripTable;
+TripIntervalIndex tripIndex;
+
+/**
+ * Compare one query with a scan of the whole table
+ * @return true if the index reports exactly the running trips
+ */
+bool checkTime(uint32_t seconds) {
+    uint16_t found[MAX_TRIPS_PER_DAY];
+    uint16_t count = tripIndex.query(seconds, found, MAX_TRIPS_PER_DAY);
+    std::vector<uint16_t> actual(found, found + std::min<uint16_t>(count, MAX_TRIPS_PER_DAY));
+    std::sort(actual.begin(), actual.end());
+
+    std::vector<uint16_t> expected;
+    for (uint16_t i = 0; i < tripTable.getTripCount(); i++) {
+        const Trip* trip = tripTable.getTrip(i);
+        if (trip->departureSeconds <= seconds && seconds < trip->endSeconds) {
+            expected.push_back(i);
+        }
+    }
+    if (count != expected.size() || actual != expected) {
+        return false;
+    }
+
+    // A short output array still reports the full count
+    if (count > 1) {
+        uint16_t firstTwo[2];
+        if (tripIndex.query(seconds, firstTwo, 2) != count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t days = (argc > 1) ? (uint32_t)atoi(argv[1]) : 7;
+    uint32_t samples = (argc > 2) ? (uint32_t)atoi(argv[2]) : 20000;
+
+    ScheduleModule schedule;
+    TimetableBlob timetable;
+    if (argc > 3) {
+        if (!timetable.openFile(argv[3]) || !schedule.loadSchedule(&timetable)) {
+            fprintf(stderr, "Could not load timetable %s\n", argv[3]);
+            return 1;
+        }
+    } else {
+        schedule.loadSchedule();
+    }
+    tripTable.setLogging(false);
+
+    bool allMatch = true;
+    srand(1);
+    for (uint32_t day = 0; day < days; day++) {
+        struct tm noonInfo = {};
+        noonInfo.tm_year = 2025 - 1900;
+        noonInfo.tm_mon = 9;
+        noonInfo.tm_mday = 13 + (int)day;
+        noonInfo.tm_hour = 12;
+        noonInfo.tm_isdst = -1;
+        tripTable.build(&schedule, schedule.getServiceDayStart(mktime(&noonInfo)));
+        tripIndex.build(&tripTable);
+
+        // Every span boundary and its neighbours, then random times across the day
+        std::vector<uint32_t> times;
+        for (uint16_t i = 0; i < tripTable.getTripCount(); i++) {
+            const Trip* trip = tripTable.getTrip(i);
+            for (uint32_t edge : {trip->departureSeconds, trip->endSeconds}) {
+                times.push_back(edge);
+                times.push_back(edge + 1);
+                if (edge > 0) {
+                    times.push_back(edge - 1);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < samples; i++) {
+            times.push_back((uint32_t)(rand() % (30 * 3600)));
+        }
+
+        uint32_t mismatches = 0;
+        for (uint32_t seconds : times) {
+            if (!checkTime(seconds)) {
+                if (mismatches < 5) {
+                    printf("  query differs at %u s\n", seconds);
+                }
+                mismatches++;
+            }
+        }
+
+        printf("day %u: %u trips, %zu times, %s\n", day, tripTable.getTripCount(), times.size(),
+               mismatches == 0 ? "matches" : "MISMATCH");
+        allMatch = allMatch && mismatches == 0;
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -1,24 +1,64 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include "../../core/schedule_module.h"
 #include "../../core/position_engine.h"
+#include "../../core/position_kernel.h"
+#include "../../core/trajectory_simulator.h"
+#include "../../core/sweep_runner.h"
+#include "../../core/monte_carlo.h"
+#include "../../core/led_schedule.h"
+#include "../../core/timetable_blob.h"
+#include "../../core/trip_table.h"
+#include "../../core/trip_interval_index.h"
 
 namespace py = pybind11;
 
 PYBIND11_MODULE(link_rail_core, m) {
     m.doc() = "Link Light Rail simulation core";
 
+    // Service IDs used by the service calendar and timetable trips
+    m.attr("SERVICE_WEEKDAY") = SERVICE_WEEKDAY;
+    m.attr("SERVICE_SATURDAY") = SERVICE_SATURDAY;
+    m.attr("SERVICE_SUNDAY") = SERVICE_SUNDAY;
+    m.attr("SERVICE_NONE") = SERVICE_NONE;
+    m.attr("POSITION_MODE_TRACKED") = POSITION_MODE_TRACKED;
+    m.attr("POSITION_MODE_STATELESS") = POSITION_MODE_STATELESS;
+    m.attr("POSITION_MODE_EVENT") = POSITION_MODE_EVENT;
+    m.attr("LED_SCHEDULE_BLOCK_BYTES") = LED_SCHEDULE_BLOCK_BYTES;
+    m.attr("MAX_TRAINS") = MAX_TRAINS;
+    m.attr("MAX_TRAIN_EVENTS") = MAX_TRAIN_EVENTS;
+    m.attr("TRAIN_EVENT_SPAWNED") = TRAIN_EVENT_SPAWNED;
+    m.attr("TRAIN_EVENT_LED_CHANGED") = TRAIN_EVENT_LED_CHANGED;
+    m.attr("TRAIN_EVENT_ARRIVED") = TRAIN_EVENT_ARRIVED;
+    m.attr("TRAIN_EVENT_RETIRED") = TRAIN_EVENT_RETIRED;
+    m.attr("TRAIN_LED_NONE") = TRAIN_LED_NONE;
+    m.attr("POSITION_KERNEL_SCALAR") = POSITION_KERNEL_SCALAR;
+    m.attr("POSITION_KERNEL_SSE41") = POSITION_KERNEL_SSE41;
+    m.attr("POSITION_KERNEL_AVX2") = POSITION_KERNEL_AVX2;
+    m.attr("POSITION_KERNEL_FINISHED") = POSITION_KERNEL_FINISHED;
+    m.attr("DELAY_FIXED") = DELAY_FIXED;
+    m.attr("DELAY_UNIFORM") = DELAY_UNIFORM;
+    m.attr("DELAY_NORMAL") = DELAY_NORMAL;
+    m.attr("DELAY_EXPONENTIAL") = DELAY_EXPONENTIAL;
+    m.attr("MONTE_CARLO_BUNCHED_SECONDS") = MONTE_CARLO_BUNCHED_SECONDS;
+    m.attr("MONTE_CARLO_MIN_SPACING") = MONTE_CARLO_MIN_SPACING;
+    m.attr("MONTE_CARLO_MEAN_DELAY") = MONTE_CARLO_MEAN_DELAY;
+    m.attr("MONTE_CARLO_MAX_DELAY") = MONTE_CARLO_MAX_DELAY;
+
     // Station struct binding
+    // Read-only: stations returned by ScheduleModule point into the constant line tables
     py::class_<Station>(m, "Station")
-        .def(py::init<>())
-        .def_property("name",
-            [](const Station &s) { return std::string(s.name); },
-            [](Station &s, const std::string &name) {
-                strncpy(s.name, name.c_str(), 31);
-                s.name[31] = '\0';
-            })
-        .def_readwrite("ledIndex", &Station::ledIndex)
-        .def_readwrite("distanceFromStart", &Station::distanceFromStart);
+        .def_property_readonly("name",
+            [](const Station &s) { return std::string(s.name); })
+        .def_readonly("ledIndex", &Station::ledIndex)
+        .def_readonly("distanceFromStart", &Station::distanceFromStart);
+
+    // InterStationSegment struct binding (read-only, like Station)
+    py::class_<InterStationSegment>(m, "InterStationSegment")
+        .def_readonly("stationA", &InterStationSegment::stationA)
+        .def_readonly("stationB", &InterStationSegment::stationB)
+        .def_readonly("travelTimeSeconds", &InterStationSegment::travelTimeSeconds);
 
     // TrainSchedule struct binding
     py::class_<TrainSchedule>(m, "TrainSchedule")
@@ -26,41 +66,303 @@ PYBIND11_MODULE(link_rail_core, m) {
         .def_readwrite("firstTrainMinutes", &TrainSchedule::firstTrainMinutes)
         .def_readwrite("lastTrainMinutes", &TrainSchedule::lastTrainMinutes)
         .def_readwrite("headwayMinutes", &TrainSchedule::headwayMinutes)
-        .def_readwrite("isWeekend", &TrainSchedule::isWeekend);
+        .def_readwrite("isWeekend", &TrainSchedule::isWeekend)
+        .def_readwrite("southboundOffsetMinutes", &TrainSchedule::southboundOffsetMinutes)
+        .def_readwrite("serviceId", &TrainSchedule::serviceId);
 
     // TrainPosition struct binding
     py::class_<TrainPosition>(m, "TrainPosition")
         .def(py::init<>())
         .def_readwrite("ledIndex", &TrainPosition::ledIndex)
         .def_readwrite("isNorthbound", &TrainPosition::isNorthbound)
-        .def_readwrite("isActive", &TrainPosition::isActive);
+        .def_readwrite("isActive", &TrainPosition::isActive)
+        .def_readwrite("ledPosition", &TrainPosition::ledPosition);
+
+    // TrainEvent struct binding
+    py::class_<TrainEvent>(m, "TrainEvent")
+        .def(py::init<>())
+        .def_readwrite("type", &TrainEvent::type)
+        .def_readwrite("trainId", &TrainEvent::trainId)
+        .def_readwrite("station", &TrainEvent::station)
+        .def_readwrite("ledIndex", &TrainEvent::ledIndex)
+        .def_readwrite("isNorthbound", &TrainEvent::isNorthbound);
+
+    // LedOccupancy struct binding (bitmaps as 128-bit Python ints, counts as a numpy copy)
+    py::class_<LedOccupancy>(m, "LedOccupancy")
+        .def_property_readonly("southbound", [](const LedOccupancy& o) {
+            py::int_ bits(0);
+            for (int word = LED_OCCUPANCY_WORDS - 1; word >= 0; word--) {
+                bits = (bits << py::int_(32)) | py::int_(o.bits[0][word]);
+            }
+            return bits;
+        })
+        .def_property_readonly("northbound", [](const LedOccupancy& o) {
+            py::int_ bits(0);
+            for (int word = LED_OCCUPANCY_WORDS - 1; word >= 0; word--) {
+                bits = (bits << py::int_(32)) | py::int_(o.bits[1][word]);
+            }
+            return bits;
+        })
+        .def_property_readonly("counts", [](const LedOccupancy& o) {
+            return py::array_t<uint8_t>({(py::ssize_t)2, (py::ssize_t)LINE_LED_COUNT}, &o.counts[0][0]);
+        })
+        .def_readonly("sharedLEDs", &LedOccupancy::sharedLEDs);
+
+    // TimetableBlob class binding (memory-mapped binary timetable)
+    py::class_<TimetableBlob>(m, "TimetableBlob")
+        .def(py::init<>())
+        .def("openFile", &TimetableBlob::openFile)
+        .def("close", &TimetableBlob::close)
+        .def("isValid", &TimetableBlob::isValid);
+
+    // Trip struct binding
+    py::class_<Trip>(m, "Trip")
+        .def_readonly("departureSeconds", &Trip::departureSeconds)
+        .def_readonly("endSeconds", &Trip::endSeconds)
+        .def_readonly("pattern", &Trip::pattern);
+
+    // TripTable class binding (one service day of trips)
+    py::class_<TripTable>(m, "TripTable")
+        .def(py::init<>())
+        .def("build", &TripTable::build, py::keep_alive<1, 2>())
+        .def("getServiceDayStart", &TripTable::getServiceDayStart)
+        .def("getServiceId", &TripTable::getServiceId)
+        .def("getTripCount", &TripTable::getTripCount)
+        .def("getTrip", &TripTable::getTrip,
+             py::return_value_policy::reference_internal);
+
+    // TripIntervalIndex class binding (trips running at arbitrary times)
+    py::class_<TripIntervalIndex>(m, "TripIntervalIndex")
+        .def(py::init<>())
+        .def("build", &TripIntervalIndex::build, py::keep_alive<1, 2>())
+        .def("getTripCount", &TripIntervalIndex::getTripCount)
+        .def("query", [](const TripIntervalIndex& self, uint32_t seconds) {
+            uint16_t trips[MAX_TRIPS_PER_DAY];
+            uint16_t count = self.query(seconds, trips, MAX_TRIPS_PER_DAY);
+            // Convert to Python list
+            py::list result;
+            for (uint16_t i = 0; i < count; i++) {
+                result.append(trips[i]);
+            }
+            return result;
+        });
 
     // ScheduleModule class binding
     py::class_<ScheduleModule>(m, "ScheduleModule")
         .def(py::init<>())
-        .def("loadSchedule", &ScheduleModule::loadSchedule)
+        .def("loadSchedule", [](ScheduleModule& self) { self.loadSchedule(); })
+        .def("loadSchedule", [](ScheduleModule& self, const TimetableBlob& timetable) {
+                 return self.loadSchedule(&timetable);
+             },
+             py::keep_alive<1, 2>())
         .def("getStation", &ScheduleModule::getStation,
              py::return_value_policy::reference)
         .def("getStationCount", &ScheduleModule::getStationCount)
         .def("getTravelTime", &ScheduleModule::getTravelTime)
+        .def("getSegmentRunTime", &ScheduleModule::getSegmentRunTime)
+        .def("getSegment", &ScheduleModule::getSegment,
+             py::return_value_policy::reference)
+        .def("getSegmentCount", &ScheduleModule::getSegmentCount)
+        .def("getDwellTime", &ScheduleModule::getDwellTime)
         .def("getCurrentSchedule", &ScheduleModule::getCurrentSchedule,
              py::return_value_policy::reference)
+        .def("getServiceSchedule", &ScheduleModule::getServiceSchedule,
+             py::return_value_policy::reference)
+        .def("getServiceId", &ScheduleModule::getServiceId)
+        .def("addServiceException", &ScheduleModule::addServiceException)
+        .def("clearServiceExceptions", &ScheduleModule::clearServiceExceptions)
+        .def("getHeadwayMinutes", &ScheduleModule::getHeadwayMinutes)
         .def("getCurrentMinuteOfDay", &ScheduleModule::getCurrentMinuteOfDay)
+        .def("getCurrentSecondOfDay", &ScheduleModule::getCurrentSecondOfDay)
+        .def("getServiceDayStart", &ScheduleModule::getServiceDayStart)
+        .def("getNextServiceDayStart", &ScheduleModule::getNextServiceDayStart)
+        .def("getPatternCount", &ScheduleModule::getPatternCount)
         .def("isServiceHours", &ScheduleModule::isServiceHours);
 
     // PositionEngine class binding
     py::class_<PositionEngine>(m, "PositionEngine")
         .def(py::init<>())
         .def("init", &PositionEngine::init)
+        .def("setMode", &PositionEngine::setMode)
+        .def("getMode", &PositionEngine::getMode)
+        .def("getOverflowCount", &PositionEngine::getOverflowCount)
         .def("updateAllTrains", &PositionEngine::updateAllTrains)
+        .def("updateAllTrainsMillis", &PositionEngine::updateAllTrainsMillis)
+        .def("seek", &PositionEngine::seek)
+        .def("getNextEventMillis", &PositionEngine::getNextEventMillis)
         .def("getActiveTrainPositions", [](PositionEngine& self) {
-            uint8_t count = 0;
+            uint16_t count = 0;
             const TrainPosition* positions = self.getActiveTrainPositions(&count);
             // Convert to Python list
             py::list result;
-            for (uint8_t i = 0; i < count; i++) {
+            for (uint16_t i = 0; i < count; i++) {
                 result.append(positions[i]);
             }
             return result;
+        })
+        .def("getEvents", [](PositionEngine& self) {
+            uint16_t count = 0;
+            const TrainEvent* events = self.getEvents(&count);
+            py::list result;
+            for (uint16_t i = 0; i < count; i++) {
+                result.append(events[i]);
+            }
+            return result;
+        })
+        .def("getEventOverflowCount", &PositionEngine::getEventOverflowCount)
+        .def("getOccupancy", [](PositionEngine& self) {
+            return *self.getOccupancy();
+        })
+        .def_static("countOccupiedLEDs", [](const LedOccupancy& occupancy, bool isNorthbound,
+                                            uint8_t firstLED, uint8_t lastLED) {
+            return PositionEngine::countOccupiedLEDs(&occupancy, isNorthbound, firstLED, lastLED);
         });
+
+    // PositionKernel class binding (batch placement over numpy arrays)
+    py::class_<PositionKernel>(m, "PositionKernel")
+        .def(py::init<>())
+        .def("init", &PositionKernel::init)
+        .def_static("getBestKernel", &PositionKernel::getBestKernel)
+        .def("setKernel", &PositionKernel::setKernel)
+        .def("getKernel", &PositionKernel::getKernel)
+        .def("evaluate", [](PositionKernel& self, int32_t currentSeconds,
+                            py::array_t<int32_t, py::array::c_style | py::array::forcecast> departureSeconds,
+                            py::array_t<uint8_t, py::array::c_style | py::array::forcecast> isNorthbound) {
+            if (departureSeconds.size() != isNorthbound.size()) {
+                throw std::invalid_argument("departureSeconds and isNorthbound must be the same length");
+            }
+            py::ssize_t count = departureSeconds.size();
+            py::array_t<uint8_t> stations(count);
+            py::array_t<float> progress(count);
+            py::array_t<uint8_t> leds(count);
+            self.evaluate(currentSeconds, departureSeconds.data(), isNorthbound.data(), (uint32_t)count,
+                          stations.mutable_data(), progress.mutable_data(), leds.mutable_data());
+            // (stations, progress, leds); finished trains have POSITION_KERNEL_FINISHED station and LED
+            return py::make_tuple(stations, progress, leds);
+        });
+
+    // TrajectorySimulator class binding (headless range simulation into numpy arrays)
+    py::class_<TrajectorySimulator>(m, "TrajectorySimulator")
+        .def(py::init<>())
+        .def("init", &TrajectorySimulator::init, py::keep_alive<1, 2>())
+        .def_static("getTickCount", &TrajectorySimulator::getTickCount)
+        .def("getOverflowCount", [](TrajectorySimulator& self) { return self.getEngine()->getOverflowCount(); })
+        .def("simulateRange", [](TrajectorySimulator& self, time_t start, time_t end, uint32_t step,
+                                 uint16_t trainsPerTick) {
+            uint32_t ticks = TrajectorySimulator::getTickCount(start, end, step);
+
+            // The arrays are the simulator's output buffer, so they reach Python without a copy
+            py::array_t<uint16_t> trainCounts(ticks);
+            py::array_t<uint8_t> ledOccupancy({(py::ssize_t)ticks, (py::ssize_t)LINE_LED_COUNT});
+            py::array_t<uint16_t> ledPositions({(py::ssize_t)ticks, (py::ssize_t)trainsPerTick});
+            py::array_t<uint8_t> directions({(py::ssize_t)ticks, (py::ssize_t)trainsPerTick});
+            TrajectoryBuffer buffer = {trainCounts.mutable_data(), ledOccupancy.mutable_data(),
+                                       ledPositions.mutable_data(), directions.mutable_data(), ticks, trainsPerTick};
+            {
+                py::gil_scoped_release release;
+                self.simulateRange(start, end, step, &buffer);
+            }
+
+            py::dict result;
+            result["trainCounts"] = trainCounts;
+            result["ledOccupancy"] = ledOccupancy;
+            result["ledPositions"] = ledPositions;
+            result["directions"] = directions;
+            return result;
+        }, py::arg("start"), py::arg("end"), py::arg("step") = 1, py::arg("trainsPerTick") = 64);
+
+    // LedScheduleBuilder class binding (a service day's LED transitions as encoded blocks)
+    py::class_<LedScheduleBuilder>(m, "LedScheduleBuilder")
+        .def(py::init<>())
+        .def("build", [](LedScheduleBuilder& self, PositionEngine* engine, ScheduleModule* scheduleModule,
+                         time_t serviceDayStart) {
+            // Sized by a first pass, then built into the array
+            uint32_t size = self.buildToMemory(engine, scheduleModule, serviceDayStart, nullptr, 0);
+            py::array_t<uint8_t> data(size);
+            self.buildToMemory(engine, scheduleModule, serviceDayStart, data.mutable_data(), size);
+            return data;
+        })
+        .def("getTransitionCount", &LedScheduleBuilder::getTransitionCount);
+
+    // LedScheduleCursor class binding (replays an array from LedScheduleBuilder.build)
+    py::class_<LedScheduleCursor>(m, "LedScheduleCursor")
+        .def(py::init<>())
+        .def("initFromMemory", [](LedScheduleCursor& self, py::array_t<uint8_t, py::array::c_style> data) {
+            self.initFromMemory(data.data(), (uint32_t)data.size());
+        }, py::keep_alive<1, 2>())
+        .def("rewind", &LedScheduleCursor::rewind)
+        .def("advanceTo", &LedScheduleCursor::advanceTo)
+        .def("getActiveTrainPositions", [](LedScheduleCursor& self) {
+            uint16_t count = 0;
+            const TrainPosition* positions = self.getActiveTrainPositions(&count);
+            py::list result;
+            for (uint16_t i = 0; i < count; i++) {
+                result.append(positions[i]);
+            }
+            return result;
+        })
+        .def("getOccupancy", [](LedScheduleCursor& self) {
+            return *self.getOccupancy();
+        });
+
+    // SweepResult struct binding
+    py::class_<SweepResult>(m, "SweepResult")
+        .def_readonly("peakTrains", &SweepResult::peakTrains)
+        .def_readonly("peakTime", &SweepResult::peakTime)
+        .def_readonly("daysOverLimit", &SweepResult::daysOverLimit)
+        .def_readonly("secondsOverLimit", &SweepResult::secondsOverLimit)
+        .def_readonly("trainSeconds", &SweepResult::trainSeconds)
+        .def_readonly("overflowCount", &SweepResult::overflowCount)
+        .def_readonly("daysSimulated", &SweepResult::daysSimulated);
+
+    // SweepRunner class binding (multi-threaded capacity sweeps)
+    py::class_<SweepRunner>(m, "SweepRunner")
+        .def(py::init<>())
+        .def("addScenario", &SweepRunner::addScenario, py::keep_alive<1, 2>())
+        .def("clearScenarios", &SweepRunner::clearScenarios)
+        .def("getScenarioCount", &SweepRunner::getScenarioCount)
+        .def("run", &SweepRunner::run, py::arg("firstDay"), py::arg("dayCount"), py::arg("step") = 1,
+             py::arg("threadCount") = 0, py::call_guard<py::gil_scoped_release>())
+        .def("getResult", &SweepRunner::getResult, py::return_value_policy::reference_internal);
+
+    // DelayDistribution struct binding
+    py::class_<DelayDistribution>(m, "DelayDistribution")
+        .def(py::init([](uint8_t type, float spread) { return DelayDistribution{type, spread}; }),
+             py::arg("type") = DELAY_FIXED, py::arg("spread") = 0.0f)
+        .def_readwrite("type", &DelayDistribution::type)
+        .def_readwrite("spread", &DelayDistribution::spread);
+
+    // MonteCarloModel struct binding
+    py::class_<MonteCarloModel>(m, "MonteCarloModel")
+        .def(py::init([]() {
+            return MonteCarloModel{{DELAY_FIXED, 0.0f}, {DELAY_FIXED, 0.0f}, {DELAY_FIXED, 0.0f}};
+        }))
+        .def_readwrite("departure", &MonteCarloModel::departure)
+        .def_readwrite("runTime", &MonteCarloModel::runTime)
+        .def_readwrite("dwell", &MonteCarloModel::dwell);
+
+    // MonteCarloSummary struct binding (histogram as a numpy copy)
+    py::class_<MonteCarloSummary>(m, "MonteCarloSummary")
+        .def_property_readonly("bins", [](const MonteCarloSummary& s) {
+            return py::array_t<uint32_t>(MONTE_CARLO_HISTOGRAM_BINS, s.bins);
+        })
+        .def_readonly("lowerBound", &MonteCarloSummary::lowerBound)
+        .def_readonly("binWidth", &MonteCarloSummary::binWidth)
+        .def_readonly("count", &MonteCarloSummary::count)
+        .def_readonly("sum", &MonteCarloSummary::sum)
+        .def_readonly("minimum", &MonteCarloSummary::minimum)
+        .def_readonly("maximum", &MonteCarloSummary::maximum);
+
+    // MonteCarloSimulator class binding (multi-threaded delay runs)
+    py::class_<MonteCarloSimulator>(m, "MonteCarloSimulator")
+        .def(py::init<>())
+        .def("init", &MonteCarloSimulator::init, py::keep_alive<1, 2>())
+        .def("setModel", &MonteCarloSimulator::setModel)
+        .def("getModel", &MonteCarloSimulator::getModel, py::return_value_policy::copy)
+        .def("run", &MonteCarloSimulator::run, py::arg("start"), py::arg("end"), py::arg("step") = 1,
+             py::arg("runCount") = 1000, py::arg("seed") = 1, py::arg("threadCount") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("getSummary", &MonteCarloSimulator::getSummary, py::return_value_policy::reference_internal)
+        .def("getPercentile", &MonteCarloSimulator::getPercentile)
+        .def_static("drawDelay", &MonteCarloSimulator::drawDelay);
 }
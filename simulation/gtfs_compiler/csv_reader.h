@@ -0,0 +1,215 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Streaming CSV Reader
+ * Reads RFC 4180 CSV (as used by GTFS) in fixed-size chunks so memory use is
+ * bounded by the longest line, not the file size. Fields are returned as
+ * string_views into an internal buffer and are only valid until the next call.
+ */
+class CsvReader {
+public:
+    explicit CsvReader(size_t chunkSize = 1 << 20)
+        : file_(nullptr),
+          buffer_(chunkSize),
+          start_(0),
+          end_(0),
+          eof_(false) {
+    }
+
+    ~CsvReader() {
+        close();
+    }
+
+    /**
+     * Open a CSV file and read its header row
+     * @param path File path
+     * @return true if opened and a header was read
+     */
+    bool open(const std::string& path) {
+        close();
+        file_ = fopen(path.c_str(), "rb");
+        if (file_ == nullptr) {
+            return false;
+        }
+        start_ = end_ = 0;
+        eof_ = false;
+
+        std::vector<std::string_view> fields;
+        if (!next(fields)) {
+            return false;
+        }
+
+        header_.clear();
+        for (size_t i = 0; i < fields.size(); i++) {
+            std::string name(fields[i]);
+            // Strip UTF-8 byte order mark from the first column
+            if (i == 0 && name.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                name.erase(0, 3);
+            }
+            header_.push_back(name);
+        }
+        return true;
+    }
+
+    void close() {
+        if (file_ != nullptr) {
+            fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    /**
+     * Find a column by header name
+     * @param name Column name
+     * @return Column index, or -1 if absent
+     */
+    int column(const char* name) const {
+        for (size_t i = 0; i < header_.size(); i++) {
+            if (header_[i] == name) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Read the next record
+     * @param fields Output fields (cleared first)
+     * @return false at end of file
+     */
+    bool next(std::vector<std::string_view>& fields) {
+        fields.clear();
+
+        while (true) {
+            // Find a complete line in the buffer, honouring quoted newlines
+            size_t lineEnd = 0;
+            bool hasQuotes = false;
+            if (findLineEnd(&lineEnd, &hasQuotes)) {
+                char* line = buffer_.data() + start_;
+                size_t length = lineEnd - start_;
+                start_ = lineEnd + 1;
+
+                if (length > 0 && line[length - 1] == '\r') {
+                    length--;
+                }
+                if (length == 0) {
+                    continue;  // Skip blank lines
+                }
+
+                split(line, length, hasQuotes, fields);
+                return true;
+            }
+
+            if (!refill()) {
+                // Final line without a trailing newline
+                if (start_ < end_) {
+                    char* line = buffer_.data() + start_;
+                    size_t length = end_ - start_;
+                    start_ = end_;
+                    split(line, length, memchr(line, '"', length) != nullptr, fields);
+                    return true;
+                }
+                return false;
+            }
+        }
+    }
+
+private:
+    bool findLineEnd(size_t* lineEnd, bool* hasQuotes) {
+        bool inQuotes = false;
+        for (size_t i = start_; i < end_; i++) {
+            char c = buffer_[i];
+            if (c == '"') {
+                inQuotes = !inQuotes;
+                *hasQuotes = true;
+            } else if (c == '\n' && !inQuotes) {
+                *lineEnd = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool refill() {
+        if (eof_ || file_ == nullptr) {
+            return false;
+        }
+
+        // Move the partial line to the front, growing only if a single line exceeds the buffer
+        size_t remaining = end_ - start_;
+        if (remaining > 0) {
+            memmove(buffer_.data(), buffer_.data() + start_, remaining);
+        }
+        start_ = 0;
+        end_ = remaining;
+        if (end_ == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+
+        size_t bytesRead = fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+        if (bytesRead == 0) {
+            eof_ = true;
+            return false;
+        }
+        end_ += bytesRead;
+        return true;
+    }
+
+    void split(char* line, size_t length, bool hasQuotes, std::vector<std::string_view>& fields) {
+        if (!hasQuotes) {
+            size_t fieldStart = 0;
+            for (size_t i = 0; i <= length; i++) {
+                if (i == length || line[i] == ',') {
+                    fields.emplace_back(line + fieldStart, i - fieldStart);
+                    fieldStart = i + 1;
+                }
+            }
+            return;
+        }
+
+        // Quoted fields are unescaped in place; the output never grows
+        size_t read = 0;
+        size_t write = 0;
+        while (read <= length) {
+            size_t fieldStart = write;
+            bool quoted = (read < length && line[read] == '"');
+            if (quoted) {
+                read++;
+                while (read < length) {
+                    if (line[read] == '"') {
+                        if (read + 1 < length && line[read + 1] == '"') {
+                            line[write++] = '"';
+                            read += 2;
+                            continue;
+                        }
+                        read++;
+                        break;
+                    }
+                    line[write++] = line[read++];
+                }
+            }
+            while (read < length && line[read] != ',') {
+                line[write++] = line[read++];
+            }
+            fields.emplace_back(line + fieldStart, write - fieldStart);
+            read++;   // Skip the comma (or step past the end)
+            write++;  // Keep output aligned behind input
+        }
+    }
+
+    FILE* file_;
+    std::vector<char> buffer_;
+    size_t start_;
+    size_t end_;
+    bool eof_;
+    std::vector<std::string> header_;
+};
+
+#endif // CSV_READER_H
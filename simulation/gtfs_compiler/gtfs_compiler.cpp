@@ -0,0 +1,836 @@
+/**
+ * GTFS Compiler
+ * Streams a GTFS-static feed and emits the binary timetable read by ScheduleModule
+ *
+ * Usage: gtfs_compiler <gtfs_dir> <output.bin> [options]
+ *   --route <id|short name|long name>   Route to compile (default "1 Line")
+ *   --date <YYYYMMDD>                   Reference date for picking service IDs
+ *   --leds <count>                      LED strip length (default 100)
+ *   --led-spacing <even|distance>       Station LED placement (default even)
+ *   --reverse                           Flip station order (station 0 = other terminal)
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "csv_reader.h"
+#include "../../core/schedule_module.h"
+#include "../../core/timetable_blob.h"
+
+namespace {
+
+// Day types stored in TimetableTrip::serviceId (SERVICE_WEEKDAY..SERVICE_SUNDAY from line_data.h)
+const uint8_t SERVICE_DAY_TYPES = 3;
+
+struct Options {
+    std::string gtfsDir;
+    std::string outputPath;
+    std::string route = "1 Line";
+    int32_t referenceDay = INT32_MIN;   // Days since 1970-01-01, INT32_MIN = derive from feed
+    uint16_t ledCount = 100;
+    bool distanceSpacing = false;
+    bool reverse = false;
+};
+
+struct StopInfo {
+    uint32_t stationKey;      // Interned parent station (or the stop itself)
+    std::string name;
+    double lat;
+    double lon;
+};
+
+struct StopTimeRow {
+    uint32_t stopSequence;
+    uint32_t stationKey;
+    int32_t arrival;          // Seconds after service-day midnight
+    int32_t departure;
+};
+
+struct TripInfo {
+    uint32_t service;         // Index into service table
+    uint8_t directionId;
+    std::vector<StopTimeRow> rows;
+};
+
+struct ServiceInfo {
+    uint8_t weekdays;         // Bit 0 = Sunday ... bit 6 = Saturday
+    int32_t startDay;
+    int32_t endDay;
+    std::vector<std::pair<int32_t, uint8_t>> exceptions;  // (day, exception_type)
+    uint8_t dayTypeMask;      // Bit per SERVICE_* day type
+};
+
+/**
+ * Interns strings into dense indices; views stay valid because storage is a deque
+ */
+class Interner {
+public:
+    uint32_t intern(std::string_view value) {
+        auto found = index_.find(value);
+        if (found != index_.end()) {
+            return found->second;
+        }
+        storage_.emplace_back(value);
+        uint32_t id = (uint32_t)(storage_.size() - 1);
+        index_.emplace(std::string_view(storage_.back()), id);
+        return id;
+    }
+
+    int64_t find(std::string_view value) const {
+        auto found = index_.find(value);
+        return (found == index_.end()) ? -1 : (int64_t)found->second;
+    }
+
+    const std::string& name(uint32_t id) const {
+        return storage_[id];
+    }
+
+    size_t size() const {
+        return storage_.size();
+    }
+
+private:
+    std::deque<std::string> storage_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+};
+
+// Howard Hinnant's days_from_civil
+int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t yearOfEra = (uint32_t)(year - era * 400);
+    const uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+uint8_t weekdayFromDays(int32_t days) {
+    // 1970-01-01 was a Thursday (4); result 0 = Sunday
+    return (uint8_t)(((days % 7) + 11) % 7);
+}
+
+bool parseDate(std::string_view text, int32_t* days) {
+    if (text.size() != 8) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (uint32_t)(c - '0');
+    }
+    *days = daysFromCivil((int32_t)(value / 10000), (value / 100) % 100, value % 100);
+    return true;
+}
+
+bool parseTime(std::string_view text, int32_t* seconds) {
+    // H:MM:SS or HH:MM:SS, hours may exceed 23 for after-midnight service
+    int32_t parts[3] = {0, 0, 0};
+    int part = 0;
+    bool digits = false;
+    for (char c : text) {
+        if (c == ':') {
+            if (++part > 2) {
+                return false;
+            }
+        } else if (c >= '0' && c <= '9') {
+            parts[part] = parts[part] * 10 + (c - '0');
+            digits = true;
+        } else if (c != ' ') {
+            return false;
+        }
+    }
+    if (part != 2 || !digits) {
+        return false;
+    }
+    *seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+    return true;
+}
+
+uint32_t parseUnsigned(std::string_view text) {
+    uint32_t value = 0;
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (uint32_t)(c - '0');
+        }
+    }
+    return value;
+}
+
+double haversineKm(double lat1, double lon1, double lat2, double lon2) {
+    const double EARTH_RADIUS_KM = 6371.0;
+    const double DEG_TO_RAD = M_PI / 180.0;
+    double dLat = (lat2 - lat1) * DEG_TO_RAD;
+    double dLon = (lon2 - lon1) * DEG_TO_RAD;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) * sin(dLon / 2) * sin(dLon / 2);
+    return 2.0 * EARTH_RADIUS_KM * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+std::string cleanStationName(std::string name) {
+    const std::string SUFFIX = " Station";
+    if (name.size() > SUFFIX.size() && name.compare(name.size() - SUFFIX.size(), SUFFIX.size(), SUFFIX) == 0) {
+        name.erase(name.size() - SUFFIX.size());
+    }
+    if (name.size() > 31) {
+        name.resize(31);
+    }
+    return name;
+}
+
+bool openTable(CsvReader& reader, const Options& options, const char* file, bool required) {
+    if (reader.open(options.gtfsDir + "/" + file)) {
+        return true;
+    }
+    if (required) {
+        fprintf(stderr, "[GtfsCompiler] Cannot read %s/%s\n", options.gtfsDir.c_str(), file);
+    }
+    return false;
+}
+
+bool parseArguments(int argc, char** argv, Options* options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--route" && hasValue) {
+            options->route = argv[++i];
+        } else if (arg == "--date" && hasValue) {
+            if (!parseDate(argv[++i], &options->referenceDay)) {
+                fprintf(stderr, "[GtfsCompiler] --date expects YYYYMMDD\n");
+                return false;
+            }
+        } else if (arg == "--leds" && hasValue) {
+            options->ledCount = (uint16_t)atoi(argv[++i]);
+        } else if (arg == "--led-spacing" && hasValue) {
+            options->distanceSpacing = (std::string(argv[++i]) == "distance");
+        } else if (arg == "--reverse") {
+            options->reverse = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            fprintf(stderr, "[GtfsCompiler] Unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 2 || options->ledCount < 2 || options->ledCount > 256) {
+        fprintf(stderr,
+                "Usage: %s <gtfs_dir> <output.bin> [--route NAME] [--date YYYYMMDD]\n"
+                "          [--leds N] [--led-spacing even|distance] [--reverse]\n",
+                argv[0]);
+        return false;
+    }
+    options->gtfsDir = positional[0];
+    options->outputPath = positional[1];
+    return true;
+}
+
+/**
+ * Timetable Compiler
+ * Holds only the selected route's data; stop_times.txt is streamed row by row
+ */
+class GtfsCompiler {
+public:
+    explicit GtfsCompiler(const Options& options)
+        : options_(options) {
+    }
+
+    bool run() {
+        return readRoutes() && readTrips() && readCalendar() && readStops() &&
+               readStopTimes() && buildStations() && buildPatterns() && write();
+    }
+
+private:
+    bool readRoutes() {
+        CsvReader reader;
+        if (!openTable(reader, options_, "routes.txt", true)) {
+            return false;
+        }
+        int idColumn = reader.column("route_id");
+        int shortColumn = reader.column("route_short_name");
+        int longColumn = reader.column("route_long_name");
+
+        std::vector<std::string_view> fields;
+        while (reader.next(fields)) {
+            for (int column : {idColumn, shortColumn, longColumn}) {
+                if (column >= 0 && (size_t)column < fields.size() && fields[column] == options_.route) {
+                    routeIds_.intern(fields[idColumn]);
+                    break;
+                }
+            }
+        }
+
+        if (routeIds_.size() == 0) {
+            fprintf(stderr, "[GtfsCompiler] Route '%s' not found\n", options_.route.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool readTrips() {
+        CsvReader reader;
+        if (!openTable(reader, options_, "trips.txt", true)) {
+            return false;
+        }
+        int routeColumn = reader.column("route_id");
+        int serviceColumn = reader.column("service_id");
+        int tripColumn = reader.column("trip_id");
+        int directionColumn = reader.column("direction_id");
+        if (routeColumn < 0 || serviceColumn < 0 || tripColumn < 0) {
+            fprintf(stderr, "[GtfsCompiler] trips.txt is missing required columns\n");
+            return false;
+        }
+
+        std::vector<std::string_view> fields;
+        while (reader.next(fields)) {
+            if (fields.size() <= (size_t)std::max({routeColumn, serviceColumn, tripColumn}) ||
+                routeIds_.find(fields[routeColumn]) < 0) {
+                continue;
+            }
+            uint32_t trip = tripIds_.intern(fields[tripColumn]);
+            if (trip == trips_.size()) {
+                TripInfo info;
+                info.service = serviceIds_.intern(fields[serviceColumn]);
+                info.directionId = (directionColumn >= 0 && (size_t)directionColumn < fields.size())
+                                       ? (uint8_t)parseUnsigned(fields[directionColumn]) : 0;
+                trips_.push_back(std::move(info));
+            }
+        }
+
+        services_.resize(serviceIds_.size(), ServiceInfo{0, INT32_MAX, INT32_MIN, {}, 0});
+        printf("[GtfsCompiler] Route '%s': %zu trips, %zu service IDs\n",
+               options_.route.c_str(), trips_.size(), serviceIds_.size());
+        return !trips_.empty();
+    }
+
+    bool readCalendar() {
+        std::vector<std::string_view> fields;
+        CsvReader reader;
+        static const char* DAY_COLUMNS[7] = {
+            "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"
+        };
+
+        if (openTable(reader, options_, "calendar.txt", false)) {
+            int serviceColumn = reader.column("service_id");
+            int startColumn = reader.column("start_date");
+            int endColumn = reader.column("end_date");
+            int dayColumns[7];
+            for (int day = 0; day < 7; day++) {
+                dayColumns[day] = reader.column(DAY_COLUMNS[day]);
+            }
+
+            while (reader.next(fields)) {
+                if (serviceColumn < 0 || (size_t)serviceColumn >= fields.size()) {
+                    continue;
+                }
+                int64_t service = serviceIds_.find(fields[serviceColumn]);
+                if (service < 0) {
+                    continue;  // Not used by the selected route
+                }
+                ServiceInfo& info = services_[service];
+                for (int day = 0; day < 7; day++) {
+                    if (dayColumns[day] >= 0 && (size_t)dayColumns[day] < fields.size() &&
+                        fields[dayColumns[day]] == "1") {
+                        info.weekdays |= (uint8_t)(1 << day);
+                    }
+                }
+                if (startColumn >= 0 && (size_t)startColumn < fields.size()) {
+                    parseDate(fields[startColumn], &info.startDay);
+                }
+                if (endColumn >= 0 && (size_t)endColumn < fields.size()) {
+                    parseDate(fields[endColumn], &info.endDay);
+                }
+            }
+        }
+
+        if (openTable(reader, options_, "calendar_dates.txt", false)) {
+            int serviceColumn = reader.column("service_id");
+            int dateColumn = reader.column("date");
+            int typeColumn = reader.column("exception_type");
+
+            while (reader.next(fields)) {
+                if (serviceColumn < 0 || dateColumn < 0 || typeColumn < 0 ||
+                    fields.size() <= (size_t)std::max({serviceColumn, dateColumn, typeColumn})) {
+                    continue;
+                }
+                int64_t service = serviceIds_.find(fields[serviceColumn]);
+                int32_t day = 0;
+                if (service < 0 || !parseDate(fields[dateColumn], &day)) {
+                    continue;
+                }
+                services_[service].exceptions.emplace_back(day, (uint8_t)parseUnsigned(fields[typeColumn]));
+            }
+        }
+
+        // Pick one representative date per day type: today if the feed covers it,
+        // otherwise the first date the feed has service
+        int32_t reference = options_.referenceDay;
+        if (reference == INT32_MIN) {
+            int32_t today = (int32_t)(time(nullptr) / 86400);
+            int32_t earliest = INT32_MAX;
+            bool coversToday = false;
+            for (const ServiceInfo& info : services_) {
+                if (info.weekdays != 0) {
+                    earliest = std::min(earliest, info.startDay);
+                    coversToday = coversToday || (today >= info.startDay && today <= info.endDay);
+                }
+                for (const auto& exception : info.exceptions) {
+                    if (exception.second == 1) {
+                        earliest = std::min(earliest, exception.first);
+                    }
+                }
+            }
+            if (earliest == INT32_MAX) {
+                fprintf(stderr, "[GtfsCompiler] No calendar data for the selected route\n");
+                return false;
+            }
+            reference = coversToday ? today : earliest;
+        }
+
+        uint8_t DAY_TYPE_WEEKDAY[SERVICE_DAY_TYPES];
+        DAY_TYPE_WEEKDAY[SERVICE_WEEKDAY] = 3;   // Wednesday
+        DAY_TYPE_WEEKDAY[SERVICE_SATURDAY] = 6;
+        DAY_TYPE_WEEKDAY[SERVICE_SUNDAY] = 0;
+        for (uint8_t type = 0; type < SERVICE_DAY_TYPES; type++) {
+            int32_t day = reference;
+            while (weekdayFromDays(day) != DAY_TYPE_WEEKDAY[type]) {
+                day++;
+            }
+            for (ServiceInfo& info : services_) {
+                if (isServiceActive(info, day)) {
+                    info.dayTypeMask |= (uint8_t)(1 << type);
+                }
+            }
+        }
+
+        // Drop trips that run on none of the chosen dates before buffering stop times
+        size_t kept = 0;
+        for (TripInfo& trip : trips_) {
+            if (services_[trip.service].dayTypeMask != 0) {
+                kept++;
+            }
+        }
+        printf("[GtfsCompiler] %zu trips run on the reference dates\n", kept);
+        return kept > 0;
+    }
+
+    static bool isServiceActive(const ServiceInfo& info, int32_t day) {
+        for (const auto& exception : info.exceptions) {
+            if (exception.first == day) {
+                return exception.second == 1;  // 1 = added, 2 = removed
+            }
+        }
+        return day >= info.startDay && day <= info.endDay &&
+               (info.weekdays & (1 << weekdayFromDays(day))) != 0;
+    }
+
+    bool readStops() {
+        CsvReader reader;
+        if (!openTable(reader, options_, "stops.txt", true)) {
+            return false;
+        }
+        int idColumn = reader.column("stop_id");
+        int nameColumn = reader.column("stop_name");
+        int latColumn = reader.column("stop_lat");
+        int lonColumn = reader.column("stop_lon");
+        int parentColumn = reader.column("parent_station");
+        if (idColumn < 0) {
+            fprintf(stderr, "[GtfsCompiler] stops.txt has no stop_id column\n");
+            return false;
+        }
+
+        auto field = [](const std::vector<std::string_view>& fields, int column) {
+            return (column >= 0 && (size_t)column < fields.size()) ? fields[column] : std::string_view();
+        };
+
+        std::vector<std::string_view> fields;
+        while (reader.next(fields)) {
+            std::string_view parent = field(fields, parentColumn);
+            uint32_t stop = stopIds_.intern(field(fields, idColumn));
+            if (stop >= stops_.size()) {
+                stops_.resize(stop + 1);
+            }
+            StopInfo& info = stops_[stop];
+            info.stationKey = stationKeys_.intern(parent.empty() ? field(fields, idColumn) : parent);
+            info.name = std::string(field(fields, nameColumn));
+            info.lat = atof(std::string(field(fields, latColumn)).c_str());
+            info.lon = atof(std::string(field(fields, lonColumn)).c_str());
+        }
+        return true;
+    }
+
+    bool readStopTimes() {
+        CsvReader reader;
+        if (!openTable(reader, options_, "stop_times.txt", true)) {
+            return false;
+        }
+        int tripColumn = reader.column("trip_id");
+        int arrivalColumn = reader.column("arrival_time");
+        int departureColumn = reader.column("departure_time");
+        int stopColumn = reader.column("stop_id");
+        int sequenceColumn = reader.column("stop_sequence");
+        if (tripColumn < 0 || arrivalColumn < 0 || departureColumn < 0 || stopColumn < 0 || sequenceColumn < 0) {
+            fprintf(stderr, "[GtfsCompiler] stop_times.txt is missing required columns\n");
+            return false;
+        }
+        size_t minFields = (size_t)std::max({tripColumn, arrivalColumn, departureColumn, stopColumn, sequenceColumn}) + 1;
+
+        // Rows are grouped by trip in practice, so cache the last lookup
+        std::vector<std::string_view> fields;
+        std::string lastTripId;
+        int64_t lastTrip = -1;
+        size_t rows = 0;
+        size_t kept = 0;
+
+        while (reader.next(fields)) {
+            rows++;
+            if (fields.size() < minFields) {
+                continue;
+            }
+
+            if (fields[tripColumn] != lastTripId) {
+                lastTripId.assign(fields[tripColumn]);
+                lastTrip = tripIds_.find(fields[tripColumn]);
+                if (lastTrip >= 0 && services_[trips_[lastTrip].service].dayTypeMask == 0) {
+                    lastTrip = -1;
+                }
+            }
+            if (lastTrip < 0) {
+                continue;
+            }
+
+            int64_t stop = stopIds_.find(fields[stopColumn]);
+            StopTimeRow row;
+            if (stop < 0 ||
+                !parseTime(fields[arrivalColumn], &row.arrival) ||
+                !parseTime(fields[departureColumn], &row.departure)) {
+                continue;  // Untimed or unknown stop; Link publishes times at every stop
+            }
+            row.stopSequence = parseUnsigned(fields[sequenceColumn]);
+            row.stationKey = stops_[stop].stationKey;
+            trips_[lastTrip].rows.push_back(row);
+            kept++;
+        }
+
+        printf("[GtfsCompiler] Streamed %zu stop_times rows, kept %zu\n", rows, kept);
+        return kept > 0;
+    }
+
+    bool buildStations() {
+        // The longest trip (direction 0 preferred) defines the station order
+        const TripInfo* longest = nullptr;
+        for (TripInfo& trip : trips_) {
+            std::sort(trip.rows.begin(), trip.rows.end(),
+                      [](const StopTimeRow& a, const StopTimeRow& b) { return a.stopSequence < b.stopSequence; });
+            if (longest == nullptr || trip.rows.size() > longest->rows.size() ||
+                (trip.rows.size() == longest->rows.size() && trip.directionId < longest->directionId)) {
+                longest = &trip;
+            }
+        }
+        if (longest == nullptr || longest->rows.size() < 2 || longest->rows.size() > 255) {
+            fprintf(stderr, "[GtfsCompiler] Route has no usable trips\n");
+            return false;
+        }
+
+        for (const StopTimeRow& row : longest->rows) {
+            stationOrder_.push_back(row.stationKey);
+        }
+        if (options_.reverse) {
+            std::reverse(stationOrder_.begin(), stationOrder_.end());
+        }
+        stationIndex_.assign(stationKeys_.size(), -1);
+        for (size_t i = 0; i < stationOrder_.size(); i++) {
+            stationIndex_[stationOrder_[i]] = (int)i;
+        }
+
+        // Parent stations carry the display name and coordinates
+        std::vector<const StopInfo*> stationStop(stationKeys_.size(), nullptr);
+        for (uint32_t stop = 0; stop < stops_.size(); stop++) {
+            const StopInfo& info = stops_[stop];
+            bool isParent = (stationKeys_.name(info.stationKey) == stopIds_.name(stop));
+            if (stationStop[info.stationKey] == nullptr || isParent) {
+                stationStop[info.stationKey] = &info;
+            }
+        }
+
+        uint8_t count = (uint8_t)stationOrder_.size();
+        double distance = 0.0;
+        stations_.resize(count);
+        for (uint8_t i = 0; i < count; i++) {
+            const StopInfo* info = stationStop[stationOrder_[i]];
+            if (i > 0) {
+                const StopInfo* previous = stationStop[stationOrder_[i - 1]];
+                distance += haversineKm(previous->lat, previous->lon, info->lat, info->lon);
+            }
+            Station& station = stations_[i];
+            memset(&station, 0, sizeof(station));
+            std::string name = cleanStationName(info->name);
+            memcpy(station.name, name.c_str(), name.size());
+            station.distanceFromStart = (float)distance;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint16_t lastLED = options_.ledCount - 1;
+            if (options_.distanceSpacing && distance > 0.0) {
+                stations_[i].ledIndex = (uint8_t)lround(stations_[i].distanceFromStart / distance * lastLED);
+            } else {
+                stations_[i].ledIndex = (uint8_t)((i * lastLED) / (count - 1));
+            }
+        }
+
+        printf("[GtfsCompiler] %u stations, %.1f km from %s to %s\n",
+               count, distance, stations_.front().name, stations_.back().name);
+        return true;
+    }
+
+    bool buildPatterns() {
+        struct PatternBuild {
+            ServicePattern pattern;
+            std::vector<uint16_t> offsets;  // Arrivals then departures
+            size_t tripCount;
+        };
+        std::vector<PatternBuild> builds;
+        std::unordered_map<std::string, uint32_t> dedupe;
+
+        struct TripBuild {
+            uint32_t departure;
+            uint32_t pattern;
+            uint8_t dayTypeMask;
+        };
+        std::vector<TripBuild> tripBuilds;
+        size_t skipped = 0;
+
+        for (const TripInfo& trip : trips_) {
+            if (trip.rows.size() < 2) {
+                continue;
+            }
+
+            // Trips must serve a contiguous run of stations on the line, in one direction
+            bool valid = true;
+            for (size_t k = 0; valid && k < trip.rows.size(); k++) {
+                valid = stationIndex_[trip.rows[k].stationKey] >= 0;
+            }
+            int first = stationIndex_[trip.rows[0].stationKey];
+            int step = stationIndex_[trip.rows[1].stationKey] - first;
+            valid = valid && (step == 1 || step == -1);
+            for (size_t k = 2; valid && k < trip.rows.size(); k++) {
+                valid = (stationIndex_[trip.rows[k].stationKey] == first + step * (int)k);
+            }
+
+            // Offsets are delta-encoded against the origin departure and must be monotonic
+            int32_t origin = trip.rows[0].departure;
+            size_t stopCount = trip.rows.size();
+            PatternBuild build;
+            build.offsets.assign(stopCount * 2, 0);
+            for (size_t k = 1; valid && k < stopCount; k++) {
+                int32_t arrival = trip.rows[k].arrival - origin;
+                int32_t departure = (k == stopCount - 1) ? arrival : trip.rows[k].departure - origin;
+                valid = arrival >= build.offsets[stopCount + k - 1] && departure >= arrival && departure <= 0xFFFF;
+                build.offsets[k] = (uint16_t)arrival;
+                build.offsets[stopCount + k] = (uint16_t)departure;
+            }
+            if (!valid) {
+                skipped++;
+                continue;
+            }
+
+            build.pattern.offsetsIndex = 0;
+            build.pattern.firstStation = (uint8_t)first;
+            build.pattern.stopCount = (uint8_t)stopCount;
+            build.pattern.isNorthbound = (step == 1) ? 1 : 0;
+            build.pattern.reserved = 0;
+            build.tripCount = 0;
+
+            std::string key(reinterpret_cast<const char*>(&build.pattern), sizeof(build.pattern));
+            key.append(reinterpret_cast<const char*>(build.offsets.data()), build.offsets.size() * sizeof(uint16_t));
+            auto found = dedupe.find(key);
+            uint32_t patternIndex;
+            if (found == dedupe.end()) {
+                patternIndex = (uint32_t)builds.size();
+                dedupe.emplace(std::move(key), patternIndex);
+                builds.push_back(std::move(build));
+            } else {
+                patternIndex = found->second;
+            }
+            builds[patternIndex].tripCount++;
+            tripBuilds.push_back({(uint32_t)origin, patternIndex, services_[trip.service].dayTypeMask});
+        }
+
+        // The most common full-length pattern in each direction becomes pattern 0 / 1
+        uint8_t count = (uint8_t)stations_.size();
+        int64_t full[2] = {-1, -1};
+        for (size_t i = 0; i < builds.size(); i++) {
+            const ServicePattern& pattern = builds[i].pattern;
+            int direction = pattern.isNorthbound ? 0 : 1;
+            if (pattern.stopCount == count &&
+                (full[direction] < 0 || builds[i].tripCount > builds[full[direction]].tripCount)) {
+                full[direction] = (int64_t)i;
+            }
+        }
+        if (full[0] < 0 || full[1] < 0) {
+            fprintf(stderr, "[GtfsCompiler] Need at least one full-length trip in each direction\n");
+            return false;
+        }
+
+        std::vector<uint32_t> order = {(uint32_t)full[0], (uint32_t)full[1]};
+        for (uint32_t i = 0; i < builds.size(); i++) {
+            if (i != full[0] && i != full[1]) {
+                order.push_back(i);
+            }
+        }
+        if (order.size() > 0xFFFF) {
+            fprintf(stderr, "[GtfsCompiler] Too many distinct patterns\n");
+            return false;
+        }
+
+        std::vector<uint16_t> remap(builds.size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            PatternBuild& build = builds[order[i]];
+            remap[order[i]] = (uint16_t)i;
+            build.pattern.offsetsIndex = (uint32_t)patternOffsets_.size();
+            patterns_.push_back(build.pattern);
+            patternOffsets_.insert(patternOffsets_.end(), build.offsets.begin(), build.offsets.end());
+        }
+
+        for (const TripBuild& trip : tripBuilds) {
+            for (uint8_t type = 0; type < SERVICE_DAY_TYPES; type++) {
+                if (trip.dayTypeMask & (1 << type)) {
+                    outputTrips_.push_back({trip.departure, remap[trip.pattern], type, 0});
+                }
+            }
+        }
+        std::sort(outputTrips_.begin(), outputTrips_.end(), [](const TimetableTrip& a, const TimetableTrip& b) {
+            if (a.departureSeconds != b.departureSeconds) return a.departureSeconds < b.departureSeconds;
+            if (a.serviceId != b.serviceId) return a.serviceId < b.serviceId;
+            return a.pattern < b.pattern;
+        });
+        outputTrips_.erase(std::unique(outputTrips_.begin(), outputTrips_.end(), [](const TimetableTrip& a, const TimetableTrip& b) {
+            return a.departureSeconds == b.departureSeconds && a.serviceId == b.serviceId && a.pattern == b.pattern;
+        }), outputTrips_.end());
+
+        // Segments use the full-route running times in each direction
+        const uint16_t* offsets = patternOffsets_.data();
+        for (uint8_t direction = 0; direction < 2; direction++) {
+            const uint16_t* arrival = offsets + patterns_[direction].offsetsIndex;
+            const uint16_t* departure = arrival + count;
+            for (uint8_t stop = 0; stop + 1 < count; stop++) {
+                uint8_t from = (direction == 0) ? stop : (count - 1 - stop);
+                uint8_t to = (direction == 0) ? (from + 1) : (from - 1);
+                segments_.push_back({from, to, (uint16_t)(arrival[stop + 1] - departure[stop])});
+            }
+        }
+
+        printf("[GtfsCompiler] %zu trips -> %zu patterns, %zu timetable trips (%zu skipped)\n",
+               tripBuilds.size(), patterns_.size(), outputTrips_.size(), skipped);
+        return true;
+    }
+
+    bool write() {
+        struct Payload {
+            uint32_t type;
+            const void* data;
+            uint32_t count;
+            uint32_t recordSize;
+        };
+        const Payload payloads[] = {
+            {TIMETABLE_SECTION_STATIONS, stations_.data(), (uint32_t)stations_.size(), sizeof(Station)},
+            {TIMETABLE_SECTION_SEGMENTS, segments_.data(), (uint32_t)segments_.size(), sizeof(InterStationSegment)},
+            {TIMETABLE_SECTION_PATTERNS, patterns_.data(), (uint32_t)patterns_.size(), sizeof(ServicePattern)},
+            {TIMETABLE_SECTION_PATTERN_OFFSETS, patternOffsets_.data(), (uint32_t)patternOffsets_.size(), sizeof(uint16_t)},
+            {TIMETABLE_SECTION_TRIPS, outputTrips_.data(), (uint32_t)outputTrips_.size(), sizeof(TimetableTrip)},
+        };
+        const uint16_t sectionCount = sizeof(payloads) / sizeof(payloads[0]);
+
+        std::vector<uint8_t> blob(sizeof(TimetableHeader) + sectionCount * sizeof(TimetableSection), 0);
+        for (uint16_t i = 0; i < sectionCount; i++) {
+            while (blob.size() % 4 != 0) {
+                blob.push_back(0);
+            }
+            TimetableSection section = {payloads[i].type, (uint32_t)blob.size(), payloads[i].count, payloads[i].recordSize};
+            memcpy(blob.data() + sizeof(TimetableHeader) + i * sizeof(TimetableSection), &section, sizeof(section));
+            const uint8_t* bytes = static_cast<const uint8_t*>(payloads[i].data);
+            blob.insert(blob.end(), bytes, bytes + (size_t)payloads[i].count * payloads[i].recordSize);
+        }
+        while (blob.size() % 4 != 0) {
+            blob.push_back(0);
+        }
+
+        TimetableHeader header;
+        header.magic = TIMETABLE_MAGIC;
+        header.version = TIMETABLE_VERSION;
+        header.sectionCount = sectionCount;
+        header.totalSize = (uint32_t)blob.size();
+        header.checksum = timetableChecksum(blob.data() + sizeof(TimetableHeader), header.totalSize - sizeof(TimetableHeader));
+        memcpy(blob.data(), &header, sizeof(header));
+
+        FILE* file = fopen(options_.outputPath.c_str(), "wb");
+        if (file == nullptr || fwrite(blob.data(), 1, blob.size(), file) != blob.size()) {
+            fprintf(stderr, "[GtfsCompiler] Cannot write %s\n", options_.outputPath.c_str());
+            if (file != nullptr) fclose(file);
+            return false;
+        }
+        fclose(file);
+
+        // Round-trip through the same loader the firmware and simulator use
+        TimetableBlob check;
+        ScheduleModule schedule;
+        if (!check.openFile(options_.outputPath.c_str()) || !schedule.loadSchedule(&check)) {
+            fprintf(stderr, "[GtfsCompiler] Written timetable failed validation\n");
+            return false;
+        }
+
+        printf("[GtfsCompiler] Wrote %s (%zu bytes), route time %u s\n",
+               options_.outputPath.c_str(), blob.size(), schedule.getRouteTime(true));
+        return true;
+    }
+
+    const Options& options_;
+
+    Interner routeIds_;
+    Interner tripIds_;
+    Interner serviceIds_;
+    Interner stopIds_;
+    Interner stationKeys_;
+
+    std::vector<TripInfo> trips_;
+    std::vector<ServiceInfo> services_;
+    std::vector<StopInfo> stops_;
+    std::vector<uint32_t> stationOrder_;
+    std::vector<int> stationIndex_;
+
+    std::vector<Station> stations_;
+    std::vector<InterStationSegment> segments_;
+    std::vector<ServicePattern> patterns_;
+    std::vector<uint16_t> patternOffsets_;
+    std::vector<TimetableTrip> outputTrips_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArguments(argc, argv, &options)) {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    GtfsCompiler compiler(options);
+    if (!compiler.run()) {
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    printf("[GtfsCompiler] Done in %lld ms\n", (long long)elapsed.count());
+    return 0;
+}
@@ -15,16 +15,31 @@ import time
 class LinkRailSimulatorGUI:
     """Main simulator GUI application"""
 
-    def __init__(self, root):
-        """Initialize the GUI"""
+    def __init__(self, root, timetable_path=None):
+        """
+        Initialize the GUI
+
+        Args:
+            root: Tk root window
+            timetable_path: Optional binary timetable file (falls back to compiled-in data)
+        """
         self.root = root
 
         # Initialize C++ core modules
         print("Initializing core modules...")
         self.schedule = link_rail_core.ScheduleModule()
-        self.schedule.loadSchedule()
+        self.timetable = None
+        if timetable_path:
+            self.timetable = link_rail_core.TimetableBlob()
+            if not (self.timetable.openFile(timetable_path) and self.schedule.loadSchedule(self.timetable)):
+                print(f"Could not load timetable {timetable_path}, using compiled-in schedule")
+                self.timetable = None
+        if self.timetable is None:
+            self.schedule.loadSchedule()
         self.position_engine = link_rail_core.PositionEngine()
         self.position_engine.init(self.schedule)
+        # Stateless mode evaluates the timetable at each update, so time can jump freely
+        self.position_engine.setMode(link_rail_core.POSITION_MODE_STATELESS)
 
         # Simulation state
         self.is_running = False
@@ -132,7 +147,8 @@ class LinkRailSimulatorGUI:
 
         # Always update train positions and display (even when stopped/paused)
         # This ensures display updates when time or speed changes
-        self.position_engine.updateAllTrains(self.sim_time)
+        # Millisecond time keeps trains moving smoothly between whole seconds
+        self.position_engine.updateAllTrainsMillis(int(self.sim_time_float * 1000))
         trains = self.position_engine.getActiveTrainPositions()
         self._render_display(trains)
         self._update_status(trains)
@@ -153,12 +169,19 @@ class LinkRailSimulatorGUI:
                 self.led_display.set_led(station.ledIndex, (0, 0, 255), flashing=False)
 
         # Draw trains (red/green, flashing)
-        # Trains add their color on top of station blue if they overlap
+        # Trains add their color on top of station blue if they overlap.
+        # Like the firmware, each train's light is split between the two LEDs
+        # around its 8.8 fixed-point position, using integer math only
         for train in trains:
             if train.isActive:
+                led_index = train.ledPosition >> 8
+                fraction = train.ledPosition & 0xFF
                 # Northbound = red, Southbound = green
-                color = (255, 0, 0) if train.isNorthbound else (0, 255, 0)
-                self.led_display.set_led(train.ledIndex, color, flashing=True)
+                for index, weight in ((led_index, 256 - fraction), (led_index + 1, fraction)):
+                    intensity = (255 * weight) >> 8
+                    if intensity > 0:
+                        color = (intensity, 0, 0) if train.isNorthbound else (0, intensity, 0)
+                        self.led_display.set_led(index, color, flashing=True)
 
         # Update display (handles flashing logic)
         self.led_display.update()
@@ -181,8 +204,9 @@ class LinkRailSimulatorGUI:
         # Update stats
         num_trains = len(trains)
         num_stations = self.schedule.getStationCount()
+        shared_leds = self.position_engine.getOccupancy().sharedLEDs
         self.stats_label.config(
-            text=f"Active Trains: {num_trains} | Stations: {num_stations}"
+            text=f"Active Trains: {num_trains} | Stations: {num_stations} | Shared LEDs: {shared_leds}"
         )
 
     def _start_simulation(self):
@@ -202,11 +226,11 @@ class LinkRailSimulatorGUI:
         self.is_running = False
         self.is_paused = False
         self.sim_time = int(time.time())
+        self.sim_time_float = float(time.time())
         self.sim_speed = 1.0
 
-        # Reinitialize position engine
-        self.position_engine = link_rail_core.PositionEngine()
-        self.position_engine.init(self.schedule)
+        # The engine follows the clock back without being rebuilt
+        self.position_engine.seek(self.sim_time)
 
         # Clear display
         self.led_display.clear()
@@ -234,13 +258,8 @@ class LinkRailSimulatorGUI:
             self.sim_time = int(timestamp)
             self.sim_time_float = float(timestamp)
 
-            # Reinitialize position engine to spawn trains for this time
-            # This clears old trains and spawns new ones based on the custom time
-            self.position_engine = link_rail_core.PositionEngine()
-            self.position_engine.init(self.schedule)
-
-            # Immediately update trains to spawn them for the new time
-            self.position_engine.updateAllTrains(self.sim_time)
+            # Jump the engine straight to the new time
+            self.position_engine.seek(self.sim_time)
 
             print(f"Custom time set to {custom_time}")
 
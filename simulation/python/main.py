@@ -4,6 +4,7 @@ Seattle Link Light Rail Simulator
 Main entry point for the simulation GUI
 """
 
+import sys
 import tkinter as tk
 from gui import LinkRailSimulatorGUI
 
@@ -13,7 +14,9 @@ def main():
     root.title("Seattle Link Light Rail Simulator")
     root.resizable(False, False)
 
-    app = LinkRailSimulatorGUI(root)
+    # Optional binary timetable: python3 main.py path/to/timetable.bin
+    timetable_path = sys.argv[1] if len(sys.argv) > 1 else None
+    app = LinkRailSimulatorGUI(root, timetable_path)
 
     # Center window on screen
     root.update_idletasks()
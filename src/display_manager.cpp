@@ -52,7 +52,63 @@ void DisplayManager::setStationLEDs() {
     }
 }
 
-void DisplayManager::setTrainLEDs(const TrainPosition* trains, uint8_t count) {
+void DisplayManager::setTrainLEDs(const TrainPosition* trains, uint16_t count) {
+    // Breathing level in 1/256ths, so the per-train blend below is integer only
+    uint16_t level = getBreathingLevel();
+
+    // Render trains with additive color mixing and breathing brightness
+    for (uint16_t i = 0; i < count; i++) {
+        if (trains[i].isActive) {
+            // Split the train's light between the LED at or behind its position
+            // and the next one, in proportion to the fractional part (8.8 fixed point)
+            uint16_t ledIndex = trains[i].ledPosition >> 8;
+            uint16_t fraction = trains[i].ledPosition & 0xFF;
+            uint16_t peak = trains[i].isNorthbound ? NORTH_TRAIN_R : SOUTH_TRAIN_G;
+            uint16_t intensity = (peak * level) >> 8;
+
+            addTrainPixel(ledIndex, trains[i].isNorthbound, (uint8_t)((intensity * (256 - fraction)) >> 8));
+            if (fraction > 0) {
+                addTrainPixel(ledIndex + 1, trains[i].isNorthbound, (uint8_t)((intensity * fraction) >> 8));
+            }
+        }
+    }
+}
+
+void DisplayManager::renderOccupancy(const LedOccupancy* occupancy) {
+    uint16_t level = getBreathingLevel();
+    uint16_t northIntensity = (NORTH_TRAIN_R * level) >> 8;
+    uint16_t southIntensity = (SOUTH_TRAIN_G * level) >> 8;
+
+    // Station bitmap, in the same layout as the train bitmaps
+    uint32_t stationBits[LED_OCCUPANCY_WORDS] = {0};
+    uint8_t stationCount = scheduleModule.getStationCount();
+    for (uint8_t i = 0; i < stationCount; i++) {
+        const Station* station = scheduleModule.getStation(i);
+        if (station != nullptr && station->ledIndex < LINE_LED_COUNT) {
+            stationBits[station->ledIndex >> 5] |= 1u << (station->ledIndex & 31);
+        }
+    }
+
+    // Visit each lit LED once, lowest first
+    for (uint8_t word = 0; word < LED_OCCUPANCY_WORDS; word++) {
+        uint32_t lit = stationBits[word] | occupancy->bits[0][word] | occupancy->bits[1][word];
+        while (lit != 0) {
+            uint8_t ledIndex = (uint8_t)((word << 5) + __builtin_ctz(lit));
+            lit &= lit - 1;
+            if (ledIndex >= NUM_LEDS) {
+                continue;
+            }
+
+            // Northbound = red, southbound = green, station = blue; clamp to 255
+            uint32_t r = occupancy->counts[1][ledIndex] * northIntensity;
+            uint32_t g = occupancy->counts[0][ledIndex] * southIntensity;
+            uint8_t b = (stationBits[word] >> (ledIndex & 31)) & 1 ? STATION_B : 0;
+            strip_.setPixelColor(ledIndex, strip_.Color(r > 255 ? 255 : r, g > 255 ? 255 : g, b));
+        }
+    }
+}
+
+uint16_t DisplayManager::getBreathingLevel() {
     // Calculate breathing pulse brightness using sine wave
     // Breathing cycle: 2000ms (0.5 Hz) - smooth acceleration/deceleration
     unsigned long currentMillis = millis();
@@ -64,38 +120,30 @@ void DisplayManager::setTrainLEDs(const TrainPosition* trains, uint8_t count) {
     float sinValue = sin(timeInCycle * 2.0f * PI - PI / 2.0f);
     float brightness = 0.05f + (sinValue + 1.0f) / 2.0f * 0.95f;  // Range: 0.05 to 1.0
 
-    // Render trains with additive color mixing and breathing brightness
-    for (uint8_t i = 0; i < count; i++) {
-        if (trains[i].isActive) {
-            uint8_t ledIndex = trains[i].ledIndex;
-            if (ledIndex < NUM_LEDS) {
-                // Get current pixel color
-                uint32_t currentColor = strip_.getPixelColor(ledIndex);
-                uint8_t r = (currentColor >> 16) & 0xFF;
-                uint8_t g = (currentColor >> 8) & 0xFF;
-                uint8_t b = currentColor & 0xFF;
-
-                // Calculate train color with brightness applied
-                uint8_t trainR = 0;
-                uint8_t trainG = 0;
-
-                if (trains[i].isNorthbound) {
-                    // Northbound = red with breathing
-                    trainR = (uint8_t)(NORTH_TRAIN_R * brightness);
-                } else {
-                    // Southbound = green with breathing
-                    trainG = (uint8_t)(SOUTH_TRAIN_G * brightness);
-                }
+    return (uint16_t)(brightness * 256.0f + 0.5f);
+}
 
-                // Add train color (additive mixing with clamping)
-                r = (r + trainR > 255) ? 255 : (r + trainR);
-                g = (g + trainG > 255) ? 255 : (g + trainG);
+void DisplayManager::addTrainPixel(uint16_t ledIndex, bool isNorthbound, uint8_t intensity) {
+    if (ledIndex >= NUM_LEDS || intensity == 0) {
+        return;
+    }
 
-                // Set the combined color
-                strip_.setPixelColor(ledIndex, strip_.Color(r, g, b));
-            }
-        }
+    // Get current pixel color
+    uint32_t currentColor = strip_.getPixelColor(ledIndex);
+    uint8_t r = (currentColor >> 16) & 0xFF;
+    uint8_t g = (currentColor >> 8) & 0xFF;
+    uint8_t b = currentColor & 0xFF;
+
+    // Add train color (additive mixing with clamping)
+    // Northbound = red, southbound = green
+    if (isNorthbound) {
+        r = (r + intensity > 255) ? 255 : (r + intensity);
+    } else {
+        g = (g + intensity > 255) ? 255 : (g + intensity);
     }
+
+    // Set the combined color
+    strip_.setPixelColor(ledIndex, strip_.Color(r, g, b));
 }
 
 void DisplayManager::updateDisplay() {
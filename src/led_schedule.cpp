@@ -0,0 +1,285 @@
+#include "led_schedule.h"
+#include <string.h>
+
+namespace {
+
+/**
+ * Memory destination for LedScheduleBuilder::buildToMemory()
+ */
+struct MemoryTarget {
+    uint8_t* buffer;
+    uint32_t capacity;
+};
+
+bool writeToMemory(uint32_t blockIndex, const uint8_t* block, void* context) {
+    MemoryTarget* target = (MemoryTarget*)context;
+    uint32_t offset = blockIndex * LED_SCHEDULE_BLOCK_BYTES;
+    if (target->buffer != nullptr && offset + LED_SCHEDULE_BLOCK_BYTES <= target->capacity) {
+        memcpy(target->buffer + offset, block, LED_SCHEDULE_BLOCK_BYTES);
+    }
+    return true;
+}
+
+}  // namespace
+
+LedScheduleBuilder::LedScheduleBuilder()
+    : writer_(nullptr),
+      context_(nullptr),
+      blockBytes_(LED_SCHEDULE_HEADER_BYTES),
+      blockRecords_(0),
+      blockCount_(0),
+      lastMillis_(0),
+      transitionCount_(0) {
+}
+
+uint32_t LedScheduleBuilder::build(PositionEngine* engine, ScheduleModule* scheduleModule, time_t serviceDayStart,
+                                   LedBlockWriter writer, void* context) {
+    writer_ = writer;
+    context_ = context;
+    memset(block_, 0, sizeof(block_));
+    blockBytes_ = LED_SCHEDULE_HEADER_BYTES;
+    blockRecords_ = 0;
+    blockCount_ = 0;
+    lastMillis_ = 0;
+    transitionCount_ = 0;
+    memset(trainLEDs_, TRAIN_LED_NONE, sizeof(trainLEDs_));
+
+    // Run the day from its rollover to the next, visiting only the times something changes
+    engine->setMode(POSITION_MODE_EVENT);
+    int64_t dayStartMillis = (int64_t)serviceDayStart * 1000;
+    int64_t eventMillis = ((int64_t)serviceDayStart + SERVICE_DAY_START_MINUTES * 60) * 1000;
+    while (eventMillis >= 0 && scheduleModule->getServiceDayStart((time_t)(eventMillis / 1000)) == serviceDayStart) {
+        engine->updateAllTrainsMillis(eventMillis);
+        uint32_t dayMillis = (uint32_t)(eventMillis - dayStartMillis);
+
+        uint16_t eventCount = 0;
+        const TrainEvent* events = engine->getEvents(&eventCount);
+        for (uint16_t i = 0; i < eventCount; i++) {
+            const TrainEvent& event = events[i];
+            uint8_t previous = trainLEDs_[event.trainId];
+            bool ok = true;
+            if (event.type == TRAIN_EVENT_RETIRED) {
+                if (previous != TRAIN_LED_NONE) {
+                    ok = addRecord(dayMillis, event.trainId, LED_OP_RETIRE, 0);
+                }
+                trainLEDs_[event.trainId] = TRAIN_LED_NONE;
+            } else if ((event.type == TRAIN_EVENT_SPAWNED || event.type == TRAIN_EVENT_LED_CHANGED) &&
+                       event.ledIndex != TRAIN_LED_NONE && event.ledIndex != previous) {
+                if (previous != TRAIN_LED_NONE && event.ledIndex == previous + 1) {
+                    ok = addRecord(dayMillis, event.trainId, LED_OP_STEP_UP, 0);
+                } else if (previous != TRAIN_LED_NONE && event.ledIndex + 1 == previous) {
+                    ok = addRecord(dayMillis, event.trainId, LED_OP_STEP_DOWN, 0);
+                } else {
+                    ok = addRecord(dayMillis, event.trainId, LED_OP_SET,
+                                   (uint8_t)((event.isNorthbound ? 0x80 : 0) | event.ledIndex));
+                }
+                trainLEDs_[event.trainId] = event.ledIndex;
+            }
+            if (!ok) {
+                return blockCount_;
+            }
+        }
+        eventMillis = engine->getNextEventMillis();
+    }
+
+    if (blockRecords_ > 0) {
+        flushBlock();
+    }
+    return blockCount_;
+}
+
+uint32_t LedScheduleBuilder::buildToMemory(PositionEngine* engine, ScheduleModule* scheduleModule,
+                                           time_t serviceDayStart, uint8_t* buffer, uint32_t capacity) {
+    MemoryTarget target = {buffer, capacity};
+    return build(engine, scheduleModule, serviceDayStart, writeToMemory, &target) * LED_SCHEDULE_BLOCK_BYTES;
+}
+
+bool LedScheduleBuilder::addRecord(uint32_t dayMillis, uint16_t trainId, uint8_t op, uint8_t ledByte) {
+    if (blockBytes_ + LED_SCHEDULE_MAX_RECORD_BYTES > LED_SCHEDULE_BLOCK_BYTES && !flushBlock()) {
+        return false;
+    }
+
+    // Two unsigned LEB128 varints, then the LED byte for LED_OP_SET
+    uint32_t values[2] = {dayMillis - lastMillis_, ((uint32_t)trainId << 2) | op};
+    for (uint8_t v = 0; v < 2; v++) {
+        uint32_t value = values[v];
+        while (value >= 0x80) {
+            block_[blockBytes_++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        block_[blockBytes_++] = (uint8_t)value;
+    }
+    if (op == LED_OP_SET) {
+        block_[blockBytes_++] = ledByte;
+    }
+
+    lastMillis_ = dayMillis;
+    blockRecords_++;
+    transitionCount_++;
+    return true;
+}
+
+bool LedScheduleBuilder::flushBlock() {
+    // The header's base time was set when the block was started; add the record count
+    block_[4] = (uint8_t)blockRecords_;
+    block_[5] = (uint8_t)(blockRecords_ >> 8);
+    bool ok = writer_(blockCount_, block_, context_);
+    blockCount_++;
+
+    // Next block's base: the time the first record's delta counts from
+    memset(block_, 0, sizeof(block_));
+    block_[0] = (uint8_t)lastMillis_;
+    block_[1] = (uint8_t)(lastMillis_ >> 8);
+    block_[2] = (uint8_t)(lastMillis_ >> 16);
+    block_[3] = (uint8_t)(lastMillis_ >> 24);
+    blockBytes_ = LED_SCHEDULE_HEADER_BYTES;
+    blockRecords_ = 0;
+    return ok;
+}
+
+LedScheduleCursor::LedScheduleCursor()
+    : memory_(nullptr),
+      reader_(nullptr),
+      context_(nullptr),
+      blockCount_(0) {
+    rewind();
+}
+
+void LedScheduleCursor::initFromMemory(const uint8_t* data, uint32_t size) {
+    memory_ = data;
+    reader_ = nullptr;
+    context_ = nullptr;
+    blockCount_ = size / LED_SCHEDULE_BLOCK_BYTES;
+    rewind();
+}
+
+void LedScheduleCursor::initFromReader(LedBlockReader reader, void* context, uint32_t blockCount) {
+    memory_ = nullptr;
+    reader_ = reader;
+    context_ = context;
+    blockCount_ = blockCount;
+    rewind();
+}
+
+void LedScheduleCursor::rewind() {
+    block_ = nullptr;
+    blockIndex_ = 0;
+    blockOffset_ = 0;
+    blockRecords_ = 0;
+    recordMillis_ = 0;
+    hasRecord_ = false;
+    currentMillis_ = 0;
+    memset(trainLEDs_, TRAIN_LED_NONE, sizeof(trainLEDs_));
+    memset(trainNorthbound_, 0, sizeof(trainNorthbound_));
+    activeTrainCount_ = 0;
+    PositionEngine::clearOccupancy(&occupancy_);
+    positionsDirty_ = false;
+}
+
+uint32_t LedScheduleCursor::advanceTo(uint32_t dayMillis) {
+    if (dayMillis < currentMillis_) {
+        rewind();
+        positionsDirty_ = true;
+    }
+    currentMillis_ = dayMillis;
+
+    uint32_t applied = 0;
+    while ((hasRecord_ || peekRecord()) && recordMillis_ <= dayMillis) {
+        uint32_t word = readVarint();
+        uint16_t trainId = (uint16_t)(word >> 2);
+        uint8_t op = word & 3;
+        uint8_t ledByte = (op == LED_OP_SET) ? block_[blockOffset_++] : 0;
+        blockRecords_--;
+        hasRecord_ = false;
+        if (trainId >= MAX_TRAINS) {
+            continue;
+        }
+
+        if (op == LED_OP_STEP_UP) {
+            trainLEDs_[trainId]++;
+        } else if (op == LED_OP_STEP_DOWN) {
+            trainLEDs_[trainId]--;
+        } else if (op == LED_OP_SET) {
+            trainLEDs_[trainId] = ledByte & 0x7F;
+            trainNorthbound_[trainId] = (ledByte & 0x80) ? 1 : 0;
+        } else {
+            trainLEDs_[trainId] = TRAIN_LED_NONE;
+        }
+        applied++;
+    }
+    if (applied > 0) {
+        positionsDirty_ = true;
+    }
+    return applied;
+}
+
+const TrainPosition* LedScheduleCursor::getActiveTrainPositions(uint16_t* count) {
+    rebuildPositions();
+    *count = activeTrainCount_;
+    return trainPositions_;
+}
+
+const LedOccupancy* LedScheduleCursor::getOccupancy() {
+    rebuildPositions();
+    return &occupancy_;
+}
+
+void LedScheduleCursor::rebuildPositions() {
+    // Rebuilt only after a transition
+    if (!positionsDirty_) {
+        return;
+    }
+    activeTrainCount_ = 0;
+    PositionEngine::clearOccupancy(&occupancy_);
+    for (uint16_t slot = 0; slot < MAX_TRAINS; slot++) {
+        if (trainLEDs_[slot] == TRAIN_LED_NONE) {
+            continue;
+        }
+        bool isNorthbound = trainNorthbound_[slot] != 0;
+        trainPositions_[activeTrainCount_].ledIndex = trainLEDs_[slot];
+        trainPositions_[activeTrainCount_].ledPosition = (uint16_t)trainLEDs_[slot] << 8;
+        trainPositions_[activeTrainCount_].isNorthbound = isNorthbound;
+        trainPositions_[activeTrainCount_].isActive = true;
+        activeTrainCount_++;
+        PositionEngine::addToOccupancy(&occupancy_, trainLEDs_[slot], isNorthbound);
+    }
+    positionsDirty_ = false;
+}
+
+bool LedScheduleCursor::peekRecord() {
+    while (block_ == nullptr || blockRecords_ == 0) {
+        if (blockIndex_ >= blockCount_) {
+            return false;
+        }
+        if (memory_ != nullptr) {
+            block_ = memory_ + blockIndex_ * LED_SCHEDULE_BLOCK_BYTES;
+        } else if (reader_ != nullptr && reader_(blockIndex_, blockBuffer_, context_)) {
+            block_ = blockBuffer_;
+        } else {
+            return false;
+        }
+        blockIndex_++;
+
+        // The block's base time replaces the running time, so blocks decode independently
+        recordMillis_ = block_[0] | (block_[1] << 8) | (block_[2] << 16) | ((uint32_t)block_[3] << 24);
+        blockRecords_ = block_[4] | (block_[5] << 8);
+        blockOffset_ = LED_SCHEDULE_HEADER_BYTES;
+    }
+
+    recordMillis_ += readVarint();
+    hasRecord_ = true;
+    return true;
+}
+
+uint32_t LedScheduleCursor::readVarint() {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    while (true) {
+        uint8_t byte = block_[blockOffset_++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+        shift += 7;
+    }
+}
@@ -3,20 +3,89 @@
 #include "wifi_manager.h"
 #include "time_manager.h"
 #include "schedule_module.h"
+#include "timetable_blob.h"
 #include "position_engine.h"
+#include "led_schedule.h"
 #include "display_manager.h"
 
 // Global module instances
 WiFiManager wifiManager;
 TimeManager timeManager;
 ScheduleModule scheduleModule;
+TimetableBlob timetable;
 PositionEngine positionEngine;
 DisplayManager displayManager;
 
+#if LED_SCHEDULE_PLAYBACK
+LedScheduleBuilder ledScheduleBuilder;
+LedScheduleCursor ledScheduleCursor;
+uint8_t* ledSchedule = nullptr;     // Kept across days; nullptr when out of memory (trains placed live)
+uint32_t ledScheduleCapacity = 0;   // Bytes allocated for ledSchedule
+time_t ledScheduleDay = 0;          // Service day the schedule covers
+#endif
+
 // Timing variables
-unsigned long lastTrainUpdate = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastStatusPrint = 0;
+uint16_t displayedTrainCount = 0;
+
+#if LED_SCHEDULE_PLAYBACK
+/**
+ * Block writer that appends to ledSchedule, growing it by half (in PSRAM if present)
+ * @param blockIndex Index of the block
+ * @param block Block contents
+ * @param context Set to true if the buffer could not grow
+ * @return false if the buffer could not grow
+ */
+bool appendLedScheduleBlock(uint32_t blockIndex, const uint8_t* block, void* context) {
+    uint32_t offset = blockIndex * LED_SCHEDULE_BLOCK_BYTES;
+    if (offset + LED_SCHEDULE_BLOCK_BYTES > ledScheduleCapacity) {
+        uint32_t capacity = (ledScheduleCapacity > 0) ? ledScheduleCapacity + ledScheduleCapacity / 2
+                                                      : 16 * LED_SCHEDULE_BLOCK_BYTES;
+        uint8_t* grown = (uint8_t*)(psramFound() ? ps_realloc(ledSchedule, capacity) : realloc(ledSchedule, capacity));
+        if (grown == nullptr) {
+            *(bool*)context = true;
+            return false;
+        }
+        ledSchedule = grown;
+        ledScheduleCapacity = capacity;
+    }
+    memcpy(ledSchedule + offset, block, LED_SCHEDULE_BLOCK_BYTES);
+    return true;
+}
+
+/**
+ * Precompute the LED transitions of the service day containing a time
+ * The position engine drives a single build pass; until the next service
+ * day the display only replays the result. If the buffer cannot grow, the
+ * schedule is dropped and the loop places trains with the engine instead
+ * @param now Current time
+ */
+void loadLedSchedule(time_t now) {
+    ledScheduleDay = scheduleModule.getServiceDayStart(now);
+    bool outOfMemory = false;
+    uint32_t blockCount = ledScheduleBuilder.build(&positionEngine, &scheduleModule, ledScheduleDay,
+                                                   appendLedScheduleBlock, &outOfMemory);
+
+    if (outOfMemory) {
+        // The engine was left in event mode by the build, so it is ready to place trains live
+        free(ledSchedule);
+        ledSchedule = nullptr;
+        ledScheduleCapacity = 0;
+        Serial.println("[LEDSchedule] Out of memory, placing trains live");
+        return;
+    }
+
+    uint32_t size = blockCount * LED_SCHEDULE_BLOCK_BYTES;
+    ledScheduleCursor.initFromMemory(ledSchedule, size);
+
+    Serial.print("[LEDSchedule] ");
+    Serial.print(ledScheduleBuilder.getTransitionCount());
+    Serial.print(" transitions in ");
+    Serial.print(size);
+    Serial.println(" bytes");
+}
+#endif
 
 void setup() {
     // Initialize serial communication
@@ -36,12 +105,18 @@ void setup() {
 
     // Load schedule data
     Serial.println("Loading Schedule Module...");
-    scheduleModule.loadSchedule();
+    // Prefer the timetable partition; fall back to the compiled-in line data
+    if (!timetable.openPartition(TIMETABLE_PARTITION_LABEL) || !scheduleModule.loadSchedule(&timetable)) {
+        scheduleModule.loadSchedule();
+    }
     Serial.println();
 
     // Initialize position engine
     Serial.println("Initializing Position Engine...");
     positionEngine.init(&scheduleModule);
+#if EVENT_DRIVEN_TRAINS
+    positionEngine.setMode(POSITION_MODE_EVENT);
+#endif
     Serial.println();
 
     // Initialize display manager
@@ -56,10 +131,13 @@ void setup() {
     positionEngine.updateAllTrains(currentTime);
 
     // Get initial train count
-    uint8_t trainCount = 0;
+    uint16_t trainCount = 0;
     const TrainPosition* trains = positionEngine.getActiveTrainPositions(&trainCount);
     Serial.print("Initial active trains: ");
     Serial.println(trainCount);
+#if LED_SCHEDULE_PLAYBACK
+    loadLedSchedule(currentTime);
+#endif
     Serial.println();
 
     Serial.println("========================================");
@@ -75,25 +153,53 @@ void setup() {
 void loop() {
     unsigned long currentMillis = millis();
 
-    // Update train positions (every 1 second)
-    if (currentMillis - lastTrainUpdate >= TRAIN_UPDATE_INTERVAL) {
-        time_t now = timeManager.getCurrentTime();
-        positionEngine.updateAllTrains(now);
-        lastTrainUpdate = currentMillis;
-    }
-
-    // Update display rendering (every ~33ms for 30fps)
+    // Update train positions and display rendering (every ~33ms for 30fps)
     if (currentMillis - lastDisplayUpdate >= (1000 / FRAME_RATE)) {
+        uint16_t trainCount = 0;
+#if LED_SCHEDULE_PLAYBACK
+        // Advance the day's transition cursor; a new service day builds the next schedule
+        int64_t nowMillis = timeManager.getCurrentTimeMillis();
+        if (scheduleModule.getServiceDayStart((time_t)(nowMillis / 1000)) != ledScheduleDay) {
+            loadLedSchedule((time_t)(nowMillis / 1000));
+        }
+        const LedOccupancy* occupancy = nullptr;
+        if (ledSchedule != nullptr) {
+            ledScheduleCursor.advanceTo((uint32_t)(nowMillis - (int64_t)ledScheduleDay * 1000));
+            ledScheduleCursor.getActiveTrainPositions(&trainCount);
+            occupancy = ledScheduleCursor.getOccupancy();
+        } else {
+            // No memory for the schedule: place trains each frame, as EVENT_DRIVEN_TRAINS does
+            positionEngine.updateAllTrainsMillis(nowMillis);
+            positionEngine.getActiveTrainPositions(&trainCount);
+            occupancy = positionEngine.getOccupancy();
+        }
+#elif EVENT_DRIVEN_TRAINS
+        // Bring trains to this frame's time: only trains with a departure,
+        // arrival or LED change due are touched
+        positionEngine.updateAllTrainsMillis(timeManager.getCurrentTimeMillis());
+        positionEngine.getActiveTrainPositions(&trainCount);
+        const LedOccupancy* occupancy = positionEngine.getOccupancy();
+#else
+        // Bring trains to this frame's time: every train is placed at this
+        // frame's time so it glides between LEDs
+        positionEngine.updateAllTrainsMillis(timeManager.getCurrentTimeMillis());
+        const TrainPosition* trains = positionEngine.getActiveTrainPositions(&trainCount);
+#endif
+        displayedTrainCount = trainCount;
+
         // Clear LED buffer
         displayManager.clearAllLEDs();
 
+#if LED_SCHEDULE_PLAYBACK || EVENT_DRIVEN_TRAINS
+        // Whole-LED positions: render stations and trains straight from the occupancy bitmaps
+        displayManager.renderOccupancy(occupancy);
+#else
         // Render stations (solid blue, never flash)
         displayManager.setStationLEDs();
 
-        // Get train positions and render them (flashing red/green)
-        uint8_t trainCount = 0;
-        const TrainPosition* trains = positionEngine.getActiveTrainPositions(&trainCount);
+        // Render trains (flashing red/green)
         displayManager.setTrainLEDs(trains, trainCount);
+#endif
 
         // Update physical display (handles flash timing and strip.show())
         displayManager.updateDisplay();
@@ -104,21 +210,25 @@ void loop() {
     // Print status every 10 seconds
     if (currentMillis - lastStatusPrint >= 10000) {
         time_t now = timeManager.getCurrentTime();
-        struct tm* timeinfo = localtime(&now);
-
-        uint8_t trainCount = 0;
-        positionEngine.getActiveTrainPositions(&trainCount);
+        uint32_t secondOfDay = scheduleModule.getCurrentSecondOfDay(now);
+        uint8_t hour = secondOfDay / 3600;
+        uint8_t minute = (secondOfDay / 60) % 60;
+        uint8_t second = secondOfDay % 60;
 
         Serial.print("[Status] Time: ");
-        Serial.print(timeinfo->tm_hour);
+        Serial.print(hour);
         Serial.print(":");
-        if (timeinfo->tm_min < 10) Serial.print("0");
-        Serial.print(timeinfo->tm_min);
+        if (minute < 10) Serial.print("0");
+        Serial.print(minute);
         Serial.print(":");
-        if (timeinfo->tm_sec < 10) Serial.print("0");
-        Serial.print(timeinfo->tm_sec);
+        if (second < 10) Serial.print("0");
+        Serial.print(second);
         Serial.print(" | Active Trains: ");
-        Serial.print(trainCount);
+        Serial.print(displayedTrainCount);
+        if (positionEngine.getOverflowCount() > 0) {
+            Serial.print(" | Dropped (over capacity): ");
+            Serial.print(positionEngine.getOverflowCount());
+        }
         Serial.print(" | Uptime: ");
         Serial.print(currentMillis / 1000);
         Serial.println(" sec");
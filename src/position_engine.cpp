@@ -1,42 +1,101 @@
 #include "position_engine.h"
+#include <math.h>
+#include <string.h>
 
 PositionEngine::PositionEngine()
     : scheduleModule_(nullptr),
-      activeTrainCount_(0) {
+      mode_(POSITION_MODE_TRACKED),
+      logging_(true),
+      updateMillis_(0),
+      currentPlan_(0),
+      spawnCursor_(0),
+      spawnDayStart_(0),
+      spawnSeconds_(0),
+      eventMillis_(0),
+      activeTrainCount_(0),
+      freeCount_(0),
+      overflowCount_(0),
+      eventCount_(0),
+      eventOverflowCount_(0) {
+    wheel_.init(timerNodes_, MAX_TRAINS + 1);
+    resetTrains();
+    clearOccupancy(&occupancy_);
 }
 
 void PositionEngine::init(ScheduleModule* scheduleModule) {
     scheduleModule_ = scheduleModule;
 
     // Initialize all trains as inactive
-    for (uint8_t i = 0; i < 20; i++) {
-        trains_[i].isActive = false;
+    resetTrains();
+    clearPositions();
+
+    // Day plans and the spawn cursor belong to the previous schedule, if any
+    dayPlans_[0].clear();
+    dayPlans_[1].clear();
+    spawnDayStart_ = 0;
+    overflowCount_ = 0;
+    eventCount_ = 0;
+    eventOverflowCount_ = 0;
+
+    if (logging_) {
+        Serial.println("[PositionEngine] init() - stub");
     }
-
-    Serial.println("[PositionEngine] init() - stub");
 }
 
 void PositionEngine::updateAllTrains(time_t currentTime) {
+    updateAllTrainsMillis((int64_t)currentTime * 1000);
+}
+
+void PositionEngine::updateAllTrainsMillis(int64_t currentMillis) {
     if (scheduleModule_ == nullptr) {
         return;
     }
 
-    uint16_t minuteOfDay = scheduleModule_->getCurrentMinuteOfDay(currentTime);
+    // Whole seconds drive the timetable; the remainder only moves trains along their segment
+    int64_t wholeSeconds = currentMillis / 1000;
+    int64_t remainder = currentMillis % 1000;
+    if (remainder < 0) {
+        wholeSeconds--;
+        remainder += 1000;
+    }
+    time_t currentTime = (time_t)wholeSeconds;
+    updateMillis_ = (uint16_t)remainder;
 
-    // Check if in service gap (01:00 - 05:00)
-    if (!scheduleModule_->isServiceHours(minuteOfDay)) {
-        // Remove all active trains during gap period
-        for (uint8_t i = 0; i < 20; i++) {
-            trains_[i].isActive = false;
-        }
-        activeTrainCount_ = 0;
+    // Events describe this update only
+    eventCount_ = 0;
+
+    // The overnight gap needs no special case: the trip table has no trips running then
+
+    if (mode_ == POSITION_MODE_STATELESS) {
+        evaluateAllTrains(currentTime);
+        return;
+    }
+    if (mode_ == POSITION_MODE_EVENT) {
+        processEvents(currentTime);
         return;
     }
 
-    // Update existing trains
-    for (uint8_t i = 0; i < 20; i++) {
-        if (trains_[i].isActive) {
-            calculateTrainPosition(&trains_[i], currentTime);
+    // After a step backward or into another service day, drop trains that do not belong
+    reconcileTrains(currentTime);
+
+    // Update existing trains; finished ones are flagged for removal
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        uint32_t bits = activeSlots_[word];
+        while (bits != 0) {
+            uint16_t slot = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            int32_t elapsedSeconds = (int32_t)(currentTime - trainDepartures_[slot]);
+            uint8_t previousStation = trainStations_[slot];
+            if (!placeTrain(trainPatterns_[slot], elapsedSeconds, updateMillis_,
+                            &trainStations_[slot], &trainNextStations_[slot], &trainProgress_[slot])) {
+                completedSlots_[word] |= 1u << (slot % 32);
+                addEvent(TRAIN_EVENT_RETIRED, slot, previousStation, trainLEDs_[slot], trainNorthbound_[slot] != 0);
+            } else if (trainStations_[slot] != previousStation) {
+                // The current station only changes when the train reaches the next stop
+                const Station* station = scheduleModule_->getStation(trainStations_[slot]);
+                addEvent(TRAIN_EVENT_ARRIVED, slot, trainStations_[slot],
+                         station != nullptr ? station->ledIndex : TRAIN_LED_NONE, trainNorthbound_[slot] != 0);
+            }
         }
     }
 
@@ -47,85 +106,273 @@ void PositionEngine::updateAllTrains(time_t currentTime) {
     spawnNewTrains(currentTime);
 
     // Build train positions array for display
-    activeTrainCount_ = 0;
-    for (uint8_t i = 0; i < 20; i++) {
-        if (trains_[i].isActive) {
-            // Get LED indices for current and next stations
-            const Station* currentStation = scheduleModule_->getStation(trains_[i].currentStation);
-            const Station* nextStation = scheduleModule_->getStation(trains_[i].nextStation);
-
-            if (currentStation != nullptr && nextStation != nullptr) {
-                // Interpolate LED position based on progress
-                float currentLED = currentStation->ledIndex;
-                float nextLED = nextStation->ledIndex;
-                float interpolatedLED = currentLED + (nextLED - currentLED) * trains_[i].progress;
-
-                // Round to nearest LED index
-                uint8_t ledIndex = (uint8_t)(interpolatedLED + 0.5);
-
-                // Clamp to valid range (0-99)
-                if (ledIndex > 99) ledIndex = 99;
-
-                trainPositions_[activeTrainCount_].ledIndex = ledIndex;
-                trainPositions_[activeTrainCount_].isNorthbound = trains_[i].isNorthbound;
-                trainPositions_[activeTrainCount_].isActive = true;
-                activeTrainCount_++;
+    clearPositions();
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        uint32_t bits = activeSlots_[word];
+        while (bits != 0) {
+            uint16_t slot = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            bool isNorthbound = trainNorthbound_[slot] != 0;
+            uint8_t ledIndex = addTrainPosition(trainStations_[slot], trainNextStations_[slot], trainProgress_[slot],
+                                                isNorthbound);
+
+            // Trains spawned this update report their first LED; the rest only when it moves
+            if (trainLEDs_[slot] == TRAIN_LED_NONE) {
+                addEvent(TRAIN_EVENT_SPAWNED, slot, trainStations_[slot], ledIndex, isNorthbound);
+            } else if (ledIndex != trainLEDs_[slot]) {
+                addEvent(TRAIN_EVENT_LED_CHANGED, slot, trainStations_[slot], ledIndex, isNorthbound);
             }
+            trainLEDs_[slot] = ledIndex;
         }
     }
 }
 
+void PositionEngine::seek(time_t targetTime) {
+    updateAllTrains(targetTime);
+}
+
 void PositionEngine::calculateTrainPosition(Train* train, time_t currentTime) {
     if (train == nullptr || !train->isActive || scheduleModule_ == nullptr) {
         return;
     }
 
     // Calculate elapsed time since departure
-    int32_t elapsedSeconds = currentTime - train->departureTime;
+    int32_t elapsedSeconds = (int32_t)(currentTime - train->departureTime);
+    if (!placeTrain(train->pattern, elapsedSeconds, 0, &train->currentStation, &train->nextStation, &train->progress)) {
+        train->isActive = false;
+    }
+}
+
+bool PositionEngine::placeTrain(uint16_t patternIndex, int32_t elapsedSeconds, uint16_t elapsedMillis,
+                                uint8_t* currentStation, uint8_t* nextStation, float* progress) {
+    const ServicePattern* pattern = scheduleModule_->getPattern(patternIndex);
+    if (pattern == nullptr) {
+        return false;
+    }
+    return placeOnStops(pattern, scheduleModule_->getPatternArrivals(pattern),
+                        scheduleModule_->getPatternDepartures(pattern), elapsedSeconds, elapsedMillis,
+                        currentStation, nextStation, progress);
+}
+
+bool PositionEngine::placeOnStops(const ServicePattern* pattern, const uint16_t* arrivalOffsets,
+                                  const uint16_t* departureOffsets, int32_t elapsedSeconds, uint16_t elapsedMillis,
+                                  uint8_t* currentStation, uint8_t* nextStation, float* progress) {
     if (elapsedSeconds < 0) {
         elapsedSeconds = 0;
+        elapsedMillis = 0;
     }
+    bool isNorthbound = pattern->isNorthbound != 0;
+    uint8_t stopCount = pattern->stopCount;
 
-    uint8_t stationCount = scheduleModule_->getStationCount();
+    // Check if train has completed its trip
+    uint16_t totalRouteTime = arrivalOffsets[stopCount - 1];
+    if (elapsedSeconds >= totalRouteTime) {
+        return false;
+    }
 
-    // Determine total route time
-    uint8_t startStation = train->isNorthbound ? 0 : (stationCount - 1);
-    uint8_t endStation = train->isNorthbound ? (stationCount - 1) : 0;
-    uint16_t totalRouteTime = scheduleModule_->getTravelTime(startStation, endStation);
+    // Binary search for the last stop the train has departed from
+    // Invariant: departureOffsets[low] <= elapsed < departureOffsets[high]
+    uint8_t low = 0;
+    uint8_t high = stopCount - 1;
+    while (high - low > 1) {
+        uint8_t mid = (low + high) / 2;
+        if (departureOffsets[mid] <= elapsedSeconds) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
 
-    // Check if train has completed route
-    if (elapsedSeconds >= totalRouteTime) {
-        train->isActive = false;
-        return;
+    // Convert stop numbers in travel order back to station indices
+    uint8_t fromStation = isNorthbound ? (pattern->firstStation + low) : (pattern->firstStation - low);
+    uint8_t toStation = isNorthbound ? (fromStation + 1) : (fromStation - 1);
+
+    if (elapsedSeconds >= arrivalOffsets[high]) {
+        // Dwelling at the platform of the next stop
+        *currentStation = toStation;
+        *nextStation = isNorthbound ? (toStation + 1) : (toStation - 1);
+        *progress = 0.0;
+        return true;
     }
 
-    // Find which segment the train is currently in
-    uint16_t accumulatedTime = 0;
-    uint8_t currentSeg = train->isNorthbound ? 0 : (stationCount - 1);
+    // Running between stops: progress through this segment (0.0 to 1.0)
+    // Offsets are whole seconds, so the milliseconds never cross a stop boundary
+    uint16_t segmentTime = arrivalOffsets[high] - departureOffsets[low];
+    *currentStation = fromStation;
+    *nextStation = toStation;
+    *progress = ((float)(elapsedSeconds - departureOffsets[low]) + elapsedMillis * 0.001f) / (float)segmentTime;
+    return true;
+}
+
+void PositionEngine::setMode(uint8_t mode) {
+    mode_ = mode;
+
+    // Stateless mode never uses the slots; tracked mode respawns them from the trip window
+    resetTrains();
+    clearPositions();
+    spawnDayStart_ = 0;  // Restart the spawn cursor from the trips on the line
+}
 
-    while (currentSeg != endStation) {
-        uint8_t nextSeg = train->isNorthbound ? (currentSeg + 1) : (currentSeg - 1);
-        uint16_t segmentTime = scheduleModule_->getTravelTime(currentSeg, nextSeg);
+void PositionEngine::setLogging(bool enabled) {
+    logging_ = enabled;
+    dayPlans_[0].setLogging(enabled);
+    dayPlans_[1].setLogging(enabled);
+}
 
-        if (accumulatedTime + segmentTime > elapsedSeconds) {
-            // Train is in this segment
-            train->currentStation = currentSeg;
-            train->nextStation = nextSeg;
+void PositionEngine::evaluateAllTrains(time_t currentTime) {
+    clearPositions();
 
-            // Calculate progress through this segment (0.0 to 1.0)
-            uint16_t timeInSegment = elapsedSeconds - accumulatedTime;
-            train->progress = (float)timeInSegment / (float)segmentTime;
+    uint32_t secondsIntoDay = 0;
+    TripTable* plan = resolveDayPlan(currentTime, &secondsIntoDay);
 
-            // Clamp progress
-            if (train->progress < 0.0) train->progress = 0.0;
-            if (train->progress > 1.0) train->progress = 1.0;
+    // Binary search rather than the sliding window, so no state carries over between calls
+    uint16_t windowBegin = 0;
+    uint16_t windowEnd = 0;
+    plan->findWindow(secondsIntoDay, &windowBegin, &windowEnd);
 
-            break;
+    for (uint16_t t = windowBegin; t < windowEnd; t++) {
+        const Trip* trip = plan->getTrip(t);
+        if (trip->endSeconds <= secondsIntoDay) {
+            continue;
+        }
+        if (activeTrainCount_ >= MAX_TRAINS) {
+            overflowCount_++;
+            continue;
+        }
+        const ServicePattern* pattern = scheduleModule_->getPattern(trip->pattern);
+        if (pattern == nullptr) {
+            continue;
+        }
+
+        // Placed from the trip alone; nothing is kept for the next call
+        time_t departureTime = plan->getServiceDayStart() + trip->departureSeconds;
+        uint8_t currentStation = 0;
+        uint8_t nextStation = 0;
+        float progress = 0.0;
+        if (placeTrain(trip->pattern, (int32_t)(currentTime - departureTime), updateMillis_, &currentStation, &nextStation, &progress)) {
+            addTrainPosition(currentStation, nextStation, progress, pattern->isNorthbound != 0);
+        }
+    }
+}
+
+uint16_t PositionEngine::allocateTrain() {
+    if (freeCount_ == 0) {
+        return MAX_TRAINS;
+    }
+    return freeSlots_[--freeCount_];
+}
+
+void PositionEngine::resetTrains() {
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        activeSlots_[word] = 0;
+        completedSlots_[word] = 0;
+    }
+
+    for (uint16_t word = 0; word < TRIP_MASK_WORDS; word++) {
+        tripsOnLine_[word] = 0;
+    }
+
+    // Lowest slots on top of the stack, so they are handed out first
+    for (uint16_t i = 0; i < MAX_TRAINS; i++) {
+        freeSlots_[i] = MAX_TRAINS - 1 - i;
+    }
+    freeCount_ = MAX_TRAINS;
+}
+
+uint8_t PositionEngine::addTrainPosition(uint8_t currentStation, uint8_t nextStation, float progress, bool isNorthbound) {
+    uint8_t ledIndex = 0;
+    uint16_t ledPosition = 0;
+    if (!mapTrainToLED(currentStation, nextStation, progress, &ledIndex, &ledPosition)) {
+        return TRAIN_LED_NONE;
+    }
+
+    appendPosition(ledIndex, ledPosition, isNorthbound);
+    return ledIndex;
+}
+
+void PositionEngine::clearPositions() {
+    activeTrainCount_ = 0;
+    clearOccupancy(&occupancy_);
+}
+
+void PositionEngine::appendPosition(uint8_t ledIndex, uint16_t ledPosition, bool isNorthbound) {
+    trainPositions_[activeTrainCount_].ledIndex = ledIndex;
+    trainPositions_[activeTrainCount_].ledPosition = ledPosition;
+    trainPositions_[activeTrainCount_].isNorthbound = isNorthbound;
+    trainPositions_[activeTrainCount_].isActive = true;
+    activeTrainCount_++;
+    addToOccupancy(&occupancy_, ledIndex, isNorthbound);
+}
+
+void PositionEngine::clearOccupancy(LedOccupancy* occupancy) {
+    memset(occupancy, 0, sizeof(LedOccupancy));
+}
+
+void PositionEngine::addToOccupancy(LedOccupancy* occupancy, uint8_t ledIndex, bool isNorthbound) {
+    if (ledIndex >= LINE_LED_COUNT) {
+        return;
+    }
+    uint8_t direction = isNorthbound ? 1 : 0;
+    occupancy->bits[direction][ledIndex / 32] |= 1u << (ledIndex % 32);
+    if (occupancy->counts[direction][ledIndex] < 0xFF) {
+        occupancy->counts[direction][ledIndex]++;
+    }
+
+    // An LED is shared from its second train on; count it once
+    if (occupancy->counts[0][ledIndex] + occupancy->counts[1][ledIndex] == 2) {
+        occupancy->sharedLEDs++;
+    }
+}
+
+uint8_t PositionEngine::countOccupiedLEDs(const LedOccupancy* occupancy, bool isNorthbound,
+                                          uint8_t firstLED, uint8_t lastLED) {
+    if (lastLED >= LINE_LED_COUNT) {
+        lastLED = LINE_LED_COUNT - 1;
+    }
+    if (firstLED > lastLED) {
+        return 0;
+    }
+
+    // Mask each word to the span and popcount it
+    const uint32_t* bits = occupancy->bits[isNorthbound ? 1 : 0];
+    uint8_t count = 0;
+    for (uint8_t word = firstLED / 32; word <= lastLED / 32; word++) {
+        uint32_t mask = 0xFFFFFFFFu;
+        if (word == firstLED / 32) {
+            mask &= 0xFFFFFFFFu << (firstLED % 32);
+        }
+        if (word == lastLED / 32) {
+            mask &= 0xFFFFFFFFu >> (31 - lastLED % 32);
         }
+        count += __builtin_popcount(bits[word] & mask);
+    }
+    return count;
+}
 
-        accumulatedTime += segmentTime;
-        currentSeg = nextSeg;
+bool PositionEngine::mapTrainToLED(uint8_t currentStation, uint8_t nextStation, float progress,
+                                   uint8_t* ledIndex, uint16_t* ledPosition) {
+    // Get LED indices for current and next stations
+    const Station* current = scheduleModule_->getStation(currentStation);
+    const Station* next = scheduleModule_->getStation(nextStation);
+    if (current == nullptr || next == nullptr) {
+        return false;
     }
+
+    // Interpolate LED position based on progress
+    float currentLED = current->ledIndex;
+    float nextLED = next->ledIndex;
+    float interpolatedLED = currentLED + (nextLED - currentLED) * progress;
+
+    // Round to nearest LED index
+    *ledIndex = (uint8_t)(interpolatedLED + 0.5);
+
+    // Clamp to valid range (0-99)
+    if (*ledIndex > 99) *ledIndex = 99;
+
+    // Fractional coordinate: whole LEDs in the high byte, 1/256ths in the low byte
+    *ledPosition = (uint16_t)(interpolatedLED * 256.0f + 0.5f);
+    if (*ledPosition > (99 << 8)) *ledPosition = 99 << 8;
+    return true;
 }
 
 uint8_t PositionEngine::mapPositionToLED(float position) {
@@ -135,147 +382,398 @@ uint8_t PositionEngine::mapPositionToLED(float position) {
     return 0;
 }
 
-const TrainPosition* PositionEngine::getActiveTrainPositions(uint8_t* count) {
+const TrainPosition* PositionEngine::getActiveTrainPositions(uint16_t* count) {
     // TODO: Implement get active positions
     *count = activeTrainCount_;
     return trainPositions_;
 }
 
+const TrainEvent* PositionEngine::getEvents(uint16_t* count) {
+    *count = eventCount_;
+    return events_;
+}
+
+void PositionEngine::addEvent(uint8_t type, uint16_t trainId, uint8_t station, uint8_t ledIndex, bool isNorthbound) {
+    if (eventCount_ >= MAX_TRAIN_EVENTS) {
+        eventOverflowCount_++;
+        return;
+    }
+    events_[eventCount_].type = type;
+    events_[eventCount_].trainId = trainId;
+    events_[eventCount_].station = station;
+    events_[eventCount_].ledIndex = ledIndex;
+    events_[eventCount_].isNorthbound = isNorthbound;
+    eventCount_++;
+}
+
+void PositionEngine::retireAllTrains() {
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        uint32_t bits = activeSlots_[word];
+        while (bits != 0) {
+            uint16_t slot = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            addEvent(TRAIN_EVENT_RETIRED, slot, trainStations_[slot], trainLEDs_[slot], trainNorthbound_[slot] != 0);
+        }
+    }
+    resetTrains();
+}
+
 void PositionEngine::spawnNewTrains(time_t currentTime) {
     if (scheduleModule_ == nullptr) {
         return;
     }
 
-    // Get current schedule
-    const TrainSchedule* schedule = scheduleModule_->getCurrentSchedule(currentTime);
-    if (schedule == nullptr) {
-        return;
+    // A new service day, or time going backwards, rewinds the cursor (no-op after updateAllTrains())
+    reconcileTrains(currentTime);
+
+    uint32_t secondsIntoDay = 0;
+    TripTable* plan = resolveDayPlan(currentTime, &secondsIntoDay);
+
+    // Only trips in the active window can be on the line
+    uint16_t windowBegin = 0;
+    uint16_t windowEnd = 0;
+    plan->advanceWindow(secondsIntoDay, &windowBegin, &windowEnd);
+    spawnSeconds_ = secondsIntoDay;
+
+    // Trips the window has already passed finished while no one was looking
+    if (spawnCursor_ < windowBegin) {
+        spawnCursor_ = windowBegin;
     }
 
-    uint16_t minuteOfDay = scheduleModule_->getCurrentMinuteOfDay(currentTime);
-    uint8_t stationCount = scheduleModule_->getStationCount();
+    // Only trips departed since the last pass: normally zero or one per tick
+    while (spawnCursor_ < windowEnd) {
+        uint16_t t = spawnCursor_;
+        const Trip* trip = plan->getTrip(t);
 
-    // Calculate total route time (for determining which trains are still active)
-    uint16_t totalRouteTime = scheduleModule_->getTravelTime(0, stationCount - 1);
-    uint16_t routeTimeMinutes = (totalRouteTime + 59) / 60;  // Round up to minutes
+        // Skip if trip has completed its run (e.g. after a jump forward),
+        // or still has its train on the line (after a rewind)
+        if (trip->endSeconds <= secondsIntoDay || (tripsOnLine_[t / 32] & (1u << (t % 32))) != 0) {
+            spawnCursor_++;
+            continue;
+        }
 
-    // Spawn ALL northbound trains that should currently be on the line
-    if (minuteOfDay >= schedule->firstTrainMinutes) {
-        uint16_t minutesSinceFirst = minuteOfDay - schedule->firstTrainMinutes;
-        uint16_t maxTrainNumber = minutesSinceFirst / schedule->headwayMinutes;
+        spawnCursor_++;
+        spawnTrain(plan, t, currentTime, updateMillis_);
+    }
+}
 
-        // Loop through all trains that have departed and might still be running
-        for (uint16_t trainNum = 0; trainNum <= maxTrainNumber; trainNum++) {
-            uint16_t departureMinute = schedule->firstTrainMinutes + (trainNum * schedule->headwayMinutes);
+uint16_t PositionEngine::spawnTrain(TripTable* plan, uint16_t tripIndex, time_t currentTime, uint16_t currentMillis) {
+    const Trip* trip = plan->getTrip(tripIndex);
+    time_t serviceDayStart = plan->getServiceDayStart();
+
+    // Take a slot from the pool; at capacity the trip is dropped and counted
+    uint16_t i = allocateTrain();
+    if (i == MAX_TRAINS) {
+        overflowCount_++;
+        Serial.print("[PositionEngine] No free train slot (");
+        Serial.print(MAX_TRAINS);
+        Serial.print("), dropping train departing at minute ");
+        Serial.println(trip->departureSeconds / 60);
+        return MAX_TRAINS;
+    }
 
-            // Stop if we've exceeded the last train time
-            if (departureMinute > schedule->lastTrainMinutes) {
-                break;
-            }
+    const ServicePattern* pattern = scheduleModule_->getPattern(trip->pattern);
+    bool isNorthbound = pattern->isNorthbound != 0;
+    trainDepartures_[i] = serviceDayStart + trip->departureSeconds;
+    trainPatterns_[i] = trip->pattern;
+    trainTrips_[i] = tripIndex;
+    trainNorthbound_[i] = isNorthbound ? 1 : 0;
+    trainLEDs_[i] = TRAIN_LED_NONE;  // Reported as spawned once it has an LED
+
+    // Place trains that spawn mid-trip (e.g. at boot) where they belong
+    if (!placeTrain(trainPatterns_[i], (int32_t)(currentTime - trainDepartures_[i]), currentMillis,
+                    &trainStations_[i], &trainNextStations_[i], &trainProgress_[i])) {
+        freeSlots_[freeCount_++] = i;
+        return MAX_TRAINS;
+    }
+    activateTrain(i);
+    tripsOnLine_[tripIndex / 32] |= 1u << (tripIndex % 32);
+    if (logging_) {
+        Serial.print(isNorthbound ? "[PositionEngine] Spawned northbound train ID "
+                                  : "[PositionEngine] Spawned southbound train ID ");
+        Serial.print(i);
+        Serial.print(" departing at minute ");
+        Serial.println(trip->departureSeconds / 60);
+    }
+    return i;
+}
 
-            // Check if this train would still be on the line (hasn't completed route yet)
-            uint16_t minutesSinceDeparture = minuteOfDay - departureMinute;
-            if (minutesSinceDeparture < routeTimeMinutes) {
-                // Calculate departure time
-                struct tm* timeinfo = localtime(&currentTime);
-                struct tm departureTimeInfo = *timeinfo;
-                departureTimeInfo.tm_hour = departureMinute / 60;
-                departureTimeInfo.tm_min = departureMinute % 60;
-                departureTimeInfo.tm_sec = 0;
-                time_t thisDepartureTime = mktime(&departureTimeInfo);
-
-                // Check if this train already exists
-                bool alreadyExists = false;
-                for (uint8_t j = 0; j < 20; j++) {
-                    if (trains_[j].isActive &&
-                        trains_[j].isNorthbound &&
-                        trains_[j].departureTime == thisDepartureTime) {
-                        alreadyExists = true;
-                        break;
-                    }
-                }
+void PositionEngine::reconcileTrains(time_t currentTime) {
+    uint32_t secondsIntoDay = 0;
+    TripTable* plan = resolveDayPlan(currentTime, &secondsIntoDay);
+    time_t serviceDayStart = plan->getServiceDayStart();
+    if (serviceDayStart == spawnDayStart_ && secondsIntoDay >= spawnSeconds_) {
+        return;
+    }
 
-                // Spawn if it doesn't exist
-                if (!alreadyExists) {
-                    for (uint8_t i = 0; i < 20; i++) {
-                        if (!trains_[i].isActive) {
-                            trains_[i].id = i;
-                            trains_[i].isNorthbound = true;
-                            trains_[i].currentStation = 0;
-                            trains_[i].nextStation = 1;
-                            trains_[i].progress = 0.0;
-                            trains_[i].departureTime = thisDepartureTime;
-                            trains_[i].isActive = true;
-                            Serial.print("[PositionEngine] Spawned northbound train ID ");
-                            Serial.print(i);
-                            Serial.print(" departing at minute ");
-                            Serial.println(departureMinute);
-                            break;
-                        }
-                    }
+    if (serviceDayStart != spawnDayStart_) {
+        // Trip indices refer to the old day plan: nothing carries over
+        retireAllTrains();
+        spawnDayStart_ = serviceDayStart;
+    } else {
+        // Earlier in the same day: trains that had departed by then are still
+        // running then, and the update re-places them; the rest leave
+        for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+            uint32_t bits = activeSlots_[word];
+            while (bits != 0) {
+                uint16_t slot = word * 32 + __builtin_ctz(bits);
+                bits &= bits - 1;
+                if (trainDepartures_[slot] > currentTime) {
+                    retireTrain(slot);
                 }
             }
         }
     }
 
-    // Spawn ALL southbound trains that should currently be on the line
-    uint16_t southboundFirstTrain = schedule->firstTrainMinutes + 15;
-    if (minuteOfDay >= southboundFirstTrain) {
-        uint16_t minutesSinceFirst = minuteOfDay - southboundFirstTrain;
-        uint16_t maxTrainNumber = minutesSinceFirst / schedule->headwayMinutes;
+    // Respawn from the start of the window; trips still on the line are skipped
+    uint16_t windowBegin = 0;
+    uint16_t windowEnd = 0;
+    plan->advanceWindow(secondsIntoDay, &windowBegin, &windowEnd);
+    spawnCursor_ = windowBegin;
+    spawnSeconds_ = secondsIntoDay;
+}
 
-        for (uint16_t trainNum = 0; trainNum <= maxTrainNumber; trainNum++) {
-            uint16_t departureMinute = southboundFirstTrain + (trainNum * schedule->headwayMinutes);
+void PositionEngine::retireTrain(uint16_t slot) {
+    addEvent(TRAIN_EVENT_RETIRED, slot, trainStations_[slot], trainLEDs_[slot], trainNorthbound_[slot] != 0);
+    activeSlots_[slot / 32] &= ~(1u << (slot % 32));
+    uint16_t trip = trainTrips_[slot];
+    tripsOnLine_[trip / 32] &= ~(1u << (trip % 32));
+    freeSlots_[freeCount_++] = slot;
+}
 
-            if (departureMinute > schedule->lastTrainMinutes) {
-                break;
-            }
+TripTable* PositionEngine::resolveDayPlan(time_t currentTime, uint32_t* secondsIntoDay) {
+    // On a new service day switch to the prebuilt plan, or build it now (first tick, time jump)
+    time_t serviceDayStart = scheduleModule_->getServiceDayStart(currentTime);
+    TripTable* plan = &dayPlans_[currentPlan_];
+    if (serviceDayStart != plan->getServiceDayStart()) {
+        currentPlan_ ^= 1;
+        plan = &dayPlans_[currentPlan_];
+        if (serviceDayStart != plan->getServiceDayStart()) {
+            plan->build(scheduleModule_, serviceDayStart);
+        }
+    }
+    *secondsIntoDay = (uint32_t)(currentTime - serviceDayStart);
+
+    // After midnight, hours before the rollover, prepare the next service day
+    if (*secondsIntoDay >= DAY_PLAN_PREBUILD_SECONDS) {
+        time_t nextServiceDayStart = scheduleModule_->getNextServiceDayStart(currentTime);
+        TripTable* nextPlan = &dayPlans_[currentPlan_ ^ 1];
+        if (nextServiceDayStart != nextPlan->getServiceDayStart()) {
+            nextPlan->build(scheduleModule_, nextServiceDayStart);
+        }
+    }
 
-            uint16_t minutesSinceDeparture = minuteOfDay - departureMinute;
-            if (minutesSinceDeparture < routeTimeMinutes) {
-                struct tm* timeinfo = localtime(&currentTime);
-                struct tm departureTimeInfo = *timeinfo;
-                departureTimeInfo.tm_hour = departureMinute / 60;
-                departureTimeInfo.tm_min = departureMinute % 60;
-                departureTimeInfo.tm_sec = 0;
-                time_t thisDepartureTime = mktime(&departureTimeInfo);
-
-                bool alreadyExists = false;
-                for (uint8_t j = 0; j < 20; j++) {
-                    if (trains_[j].isActive &&
-                        !trains_[j].isNorthbound &&
-                        trains_[j].departureTime == thisDepartureTime) {
-                        alreadyExists = true;
-                        break;
-                    }
-                }
+    return plan;
+}
 
-                if (!alreadyExists) {
-                    for (uint8_t i = 0; i < 20; i++) {
-                        if (!trains_[i].isActive) {
-                            trains_[i].id = i;
-                            trains_[i].isNorthbound = false;
-                            trains_[i].currentStation = stationCount - 1;
-                            trains_[i].nextStation = stationCount - 2;
-                            trains_[i].progress = 0.0;
-                            trains_[i].departureTime = thisDepartureTime;
-                            trains_[i].isActive = true;
-                            Serial.print("[PositionEngine] Spawned southbound train ID ");
-                            Serial.print(i);
-                            Serial.print(" departing at minute ");
-                            Serial.println(departureMinute);
-                            break;
-                        }
-                    }
-                }
+void PositionEngine::removeCompletedTrains() {
+    // Trains are flagged in completedSlots_ when they reach the end of their trip
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        uint32_t bits = completedSlots_[word];
+        activeSlots_[word] &= ~bits;
+        completedSlots_[word] = 0;
+        while (bits != 0) {
+            uint16_t slot = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            uint16_t trip = trainTrips_[slot];
+            tripsOnLine_[trip / 32] &= ~(1u << (trip % 32));
+            freeSlots_[freeCount_++] = slot;
+        }
+    }
+}
+
+void PositionEngine::processEvents(time_t currentTime) {
+    uint32_t secondsIntoDay = 0;
+    TripTable* plan = resolveDayPlan(currentTime, &secondsIntoDay);
+    uint32_t dayMillis = secondsIntoDay * 1000 + updateMillis_;
+    bool changed = false;
+
+    // A new service day or a step backward: start over from the trips running now
+    if (plan->getServiceDayStart() != spawnDayStart_ || dayMillis < eventMillis_) {
+        retireAllTrains();
+        spawnDayStart_ = plan->getServiceDayStart();
+        wheel_.reset(dayMillis);
+        uint16_t windowBegin = 0;
+        uint16_t windowEnd = 0;
+        plan->findWindow(secondsIntoDay, &windowBegin, &windowEnd);
+        spawnCursor_ = windowBegin;
+        wheel_.schedule(SPAWN_TIMER_ID, dayMillis);
+        changed = true;
+    }
+    eventMillis_ = dayMillis;
+
+    // Every departure, arrival and LED change due by now, in time order
+    uint16_t timer = 0;
+    uint32_t expiry = 0;
+    while (wheel_.pop(dayMillis, &timer, &expiry)) {
+        if (timer == SPAWN_TIMER_ID) {
+            spawnDueTrips(plan, expiry);
+        } else {
+            advanceTrain(timer, expiry);
+        }
+        changed = true;
+    }
+
+    // Positions only change with an event; otherwise last update's array stands
+    if (!changed) {
+        return;
+    }
+    clearPositions();
+    for (uint16_t word = 0; word < TRAIN_MASK_WORDS; word++) {
+        uint32_t bits = activeSlots_[word];
+        while (bits != 0) {
+            uint16_t slot = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            if (trainLEDs_[slot] != TRAIN_LED_NONE) {
+                appendPosition(trainLEDs_[slot], (uint16_t)trainLEDs_[slot] << 8, trainNorthbound_[slot] != 0);
             }
         }
     }
 }
 
-void PositionEngine::removeCompletedTrains() {
-    // Remove trains that are marked as inactive
-    // Note: Trains are marked as inactive in calculateTrainPosition when they complete their route
-    // This function is a placeholder for any additional cleanup logic
-    // The trains array is already being filtered in updateAllTrains() when building trainPositions_
+void PositionEngine::spawnDueTrips(TripTable* plan, uint32_t dayMillis) {
+    time_t currentTime = plan->getServiceDayStart() + dayMillis / 1000;
+    uint16_t tripCount = plan->getTripCount();
+    while (spawnCursor_ < tripCount) {
+        uint16_t t = spawnCursor_;
+        const Trip* trip = plan->getTrip(t);
+        if (trip->departureSeconds * 1000 > dayMillis) {
+            break;
+        }
+        spawnCursor_++;
+
+        // Finished before now (only when starting over mid-day)
+        if (trip->endSeconds * 1000 <= dayMillis) {
+            continue;
+        }
+        uint16_t slot = spawnTrain(plan, t, currentTime, dayMillis % 1000);
+        if (slot == MAX_TRAINS) {
+            continue;
+        }
+        uint8_t ledIndex = TRAIN_LED_NONE;
+        uint16_t ledPosition = 0;
+        mapTrainToLED(trainStations_[slot], trainNextStations_[slot], trainProgress_[slot], &ledIndex, &ledPosition);
+        trainLEDs_[slot] = ledIndex;
+        addEvent(TRAIN_EVENT_SPAWNED, slot, trainStations_[slot], ledIndex, trainNorthbound_[slot] != 0);
+        wheel_.schedule(slot, findNextTrainEvent(slot, dayMillis));
+    }
+
+    // Wake again at the next departure
+    if (spawnCursor_ < tripCount) {
+        wheel_.schedule(SPAWN_TIMER_ID, plan->getTrip(spawnCursor_)->departureSeconds * 1000);
+    }
+}
+
+void PositionEngine::advanceTrain(uint16_t slot, uint32_t dayMillis) {
+    time_t currentTime = spawnDayStart_ + dayMillis / 1000;
+    uint8_t previousStation = trainStations_[slot];
+    if (!placeTrain(trainPatterns_[slot], (int32_t)(currentTime - trainDepartures_[slot]), dayMillis % 1000,
+                    &trainStations_[slot], &trainNextStations_[slot], &trainProgress_[slot])) {
+        retireTrain(slot);
+        return;
+    }
+
+    bool isNorthbound = trainNorthbound_[slot] != 0;
+    if (trainStations_[slot] != previousStation) {
+        const Station* station = scheduleModule_->getStation(trainStations_[slot]);
+        addEvent(TRAIN_EVENT_ARRIVED, slot, trainStations_[slot],
+                 station != nullptr ? station->ledIndex : TRAIN_LED_NONE, isNorthbound);
+    }
+
+    uint8_t ledIndex = TRAIN_LED_NONE;
+    uint16_t ledPosition = 0;
+    mapTrainToLED(trainStations_[slot], trainNextStations_[slot], trainProgress_[slot], &ledIndex, &ledPosition);
+    if (ledIndex != trainLEDs_[slot]) {
+        addEvent(TRAIN_EVENT_LED_CHANGED, slot, trainStations_[slot], ledIndex, isNorthbound);
+    }
+    trainLEDs_[slot] = ledIndex;
+    wheel_.schedule(slot, findNextTrainEvent(slot, dayMillis));
+}
+
+uint32_t PositionEngine::findNextTrainEvent(uint16_t slot, uint32_t dayMillis) {
+    const ServicePattern* pattern = scheduleModule_->getPattern(trainPatterns_[slot]);
+    const uint16_t* arrivalOffsets = scheduleModule_->getPatternArrivals(pattern);
+    const uint16_t* departureOffsets = scheduleModule_->getPatternDepartures(pattern);
+    uint32_t departureMillis = (uint32_t)(trainDepartures_[slot] - spawnDayStart_) * 1000;
+    uint32_t elapsed = dayMillis - departureMillis;
+
+    // Last stop departed from, as in placeOnStops()
+    uint8_t low = 0;
+    uint8_t high = pattern->stopCount - 1;
+    while (high - low > 1) {
+        uint8_t mid = (low + high) / 2;
+        if (departureOffsets[mid] * 1000u <= elapsed) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    // Dwelling: nothing changes until the train leaves for the following stop
+    if (elapsed >= arrivalOffsets[high] * 1000u) {
+        low = high;
+        high = low + 1;
+    }
+    uint32_t segmentStart = departureOffsets[low] * 1000u;
+    uint32_t arrival = arrivalOffsets[high] * 1000u;
+
+    // Progress at which rounding moves the LED off the current one
+    uint8_t fromStation = pattern->isNorthbound ? (pattern->firstStation + low) : (pattern->firstStation - low);
+    uint8_t toStation = pattern->isNorthbound ? (fromStation + 1) : (fromStation - 1);
+    const Station* from = scheduleModule_->getStation(fromStation);
+    const Station* to = scheduleModule_->getStation(toStation);
+    uint8_t currentLED = trainLEDs_[slot];
+    if (from == nullptr || to == nullptr || from->ledIndex == to->ledIndex || currentLED == TRAIN_LED_NONE) {
+        return departureMillis + arrival;
+    }
+    float boundary = (to->ledIndex > from->ledIndex) ? currentLED + 0.5f : currentLED - 0.5f;
+    float crossing = (boundary - from->ledIndex) / (float)(to->ledIndex - from->ledIndex);
+    if (crossing >= 1.0f) {
+        return departureMillis + arrival;
+    }
+    uint32_t change = segmentStart + (crossing > 0.0f ? (uint32_t)ceilf(crossing * (arrival - segmentStart)) : 0);
+    if (change <= elapsed) {
+        change = elapsed + 1;
+    }
+
+    // Settle on the first millisecond the engine's own float placement shows the new LED
+    while (change < arrival && getLEDAt(pattern, arrivalOffsets, departureOffsets, change) == currentLED) {
+        change++;
+    }
+    while (change - 1 > elapsed && getLEDAt(pattern, arrivalOffsets, departureOffsets, change - 1) != currentLED) {
+        change--;
+    }
+    return departureMillis + (change < arrival ? change : arrival);
+}
+
+uint8_t PositionEngine::getLEDAt(const ServicePattern* pattern, const uint16_t* arrivalOffsets,
+                                 const uint16_t* departureOffsets, uint32_t elapsedMillis) {
+    uint8_t currentStation = 0;
+    uint8_t nextStation = 0;
+    float progress = 0.0f;
+    uint8_t ledIndex = TRAIN_LED_NONE;
+    uint16_t ledPosition = 0;
+    if (placeOnStops(pattern, arrivalOffsets, departureOffsets, (int32_t)(elapsedMillis / 1000), elapsedMillis % 1000,
+                     &currentStation, &nextStation, &progress)) {
+        mapTrainToLED(currentStation, nextStation, progress, &ledIndex, &ledPosition);
+    }
+    return ledIndex;
+}
+
+int64_t PositionEngine::getNextEventMillis() {
+    if (mode_ != POSITION_MODE_EVENT || scheduleModule_ == nullptr || spawnDayStart_ == 0) {
+        return -1;
+    }
+    uint32_t expiry = 0;
+    if (wheel_.peek(&expiry)) {
+        return (int64_t)spawnDayStart_ * 1000 + expiry;
+    }
+
+    // Nothing left today: the next service day starts over at its rollover
+    time_t rollover = scheduleModule_->getNextServiceDayStart(spawnDayStart_ + eventMillis_ / 1000) +
+                      SERVICE_DAY_START_MINUTES * 60;
+    while (scheduleModule_->getServiceDayStart(rollover) == spawnDayStart_) {
+        rollover += 3600;  // Clock set back overnight: 03:00 comes an hour later
+    }
+    return (int64_t)rollover * 1000;
 }
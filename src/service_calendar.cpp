@@ -0,0 +1,83 @@
+#include "service_calendar.h"
+
+ServiceCalendar::ServiceCalendar()
+    : exceptionCount_(0) {
+}
+
+bool ServiceCalendar::addException(uint32_t date, uint8_t serviceId) {
+    for (uint8_t i = 0; i < exceptionCount_; i++) {
+        if (exceptions_[i].date == date) {
+            exceptions_[i].serviceId = serviceId;
+            return true;
+        }
+    }
+
+    if (exceptionCount_ >= MAX_SERVICE_EXCEPTIONS) {
+        return false;
+    }
+    exceptions_[exceptionCount_].date = date;
+    exceptions_[exceptionCount_].serviceId = serviceId;
+    exceptionCount_++;
+    return true;
+}
+
+void ServiceCalendar::clearExceptions() {
+    exceptionCount_ = 0;
+}
+
+uint8_t ServiceCalendar::getServiceId(int32_t dayNumber) {
+    int32_t year = 0;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    civilFromDays(dayNumber, &year, &month, &day);
+
+    // Explicit exceptions first
+    uint32_t date = (uint32_t)year * 10000 + month * 100 + day;
+    for (uint8_t i = 0; i < exceptionCount_; i++) {
+        if (exceptions_[i].date == date) {
+            return exceptions_[i].serviceId;
+        }
+    }
+
+    // Then recurring holidays
+    for (uint8_t i = 0; i < LINE_HOLIDAY_COUNT; i++) {
+        if (matchesHoliday(LINE_HOLIDAYS[i], year, month, day)) {
+            return LINE_HOLIDAYS[i].serviceId;
+        }
+    }
+
+    // Otherwise the day of the week decides
+    uint8_t weekday = weekdayFromDays(dayNumber);
+    if (weekday == 6) {
+        return SERVICE_SATURDAY;
+    }
+    if (weekday == 0) {
+        return SERVICE_SUNDAY;
+    }
+    return SERVICE_WEEKDAY;
+}
+
+bool ServiceCalendar::matchesHoliday(const HolidayRule& rule, int32_t year, uint8_t month, uint8_t day) {
+    if (rule.month != month) {
+        return false;
+    }
+    if (rule.day != 0) {
+        return rule.day == day;
+    }
+
+    // First occurrence of the weekday in the month
+    int32_t firstOfMonth = daysFromCivil(year, month, 1);
+    uint8_t target = 1 + (rule.weekday + 7 - weekdayFromDays(firstOfMonth)) % 7;
+
+    if (rule.week == 5) {
+        // Last occurrence: step by weeks while still inside the month
+        int32_t firstOfNextMonth = (month == 12) ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, month + 1, 1);
+        uint8_t daysInMonth = (uint8_t)(firstOfNextMonth - firstOfMonth);
+        while (target + 7 <= daysInMonth) {
+            target += 7;
+        }
+    } else {
+        target += 7 * (rule.week - 1);
+    }
+    return day == target;
+}
@@ -0,0 +1,82 @@
+#include "service_clock.h"
+
+ServiceClock::ServiceClock()
+    : time_(0),
+      secondOfDay_(0),
+      dayNumber_(0),
+      weekday_(0),
+      previousMidnight_(0),
+      midnight_(0),
+      nextMidnight_(0),
+      offsetBefore_(0),
+      offsetAfter_(0),
+      offsetChange_(0) {
+}
+
+void ServiceClock::update(time_t currentTime) {
+    if (currentTime < midnight_ || currentTime >= nextMidnight_) {
+        refreshDay(currentTime);
+    }
+
+    time_ = currentTime;
+    int32_t offset = (currentTime < offsetChange_) ? offsetBefore_ : offsetAfter_;
+    secondOfDay_ = (uint32_t)((int64_t)currentTime + offset - (int64_t)dayNumber_ * 86400);
+}
+
+void ServiceClock::getDate(int32_t* year, uint8_t* month, uint8_t* day) {
+    civilFromDays(dayNumber_, year, month, day);
+}
+
+int32_t ServiceClock::toDayNumber(time_t time) {
+    int64_t local = (int64_t)time + ((time < offsetChange_) ? offsetBefore_ : offsetAfter_);
+    return (int32_t)((local >= 0 ? local : local - 86399) / 86400);
+}
+
+void ServiceClock::refreshDay(time_t currentTime) {
+    offsetBefore_ = utcOffsetAt(currentTime);
+    int64_t local = (int64_t)currentTime + offsetBefore_;
+    dayNumber_ = (int32_t)((local >= 0 ? local : local - 86399) / 86400);
+    weekday_ = weekdayFromDays(dayNumber_);
+
+    previousMidnight_ = localMidnight(dayNumber_ - 1);
+    midnight_ = localMidnight(dayNumber_);
+    nextMidnight_ = localMidnight(dayNumber_ + 1);
+
+    // Offsets at both ends of the day; they differ only on DST-change days
+    offsetBefore_ = utcOffsetAt(midnight_);
+    offsetAfter_ = utcOffsetAt(nextMidnight_ - 1);
+    offsetChange_ = nextMidnight_;
+
+    if (offsetBefore_ != offsetAfter_) {
+        // Binary search for the first second on the new offset
+        time_t low = midnight_;
+        time_t high = nextMidnight_ - 1;
+        while (high - low > 1) {
+            time_t mid = low + (high - low) / 2;
+            if (utcOffsetAt(mid) == offsetBefore_) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        offsetChange_ = high;
+    }
+}
+
+int32_t ServiceClock::utcOffsetAt(time_t time) {
+    // Reentrant form, so schedules on different threads can convert times concurrently
+    struct tm timeinfo;
+    if (localtime_r(&time, &timeinfo) == nullptr) {
+        return 0;  // No timezone information: treat as UTC
+    }
+    int64_t local = (int64_t)daysFromCivil(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday) * 86400 +
+                    timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec;
+    return (int32_t)(local - (int64_t)time);
+}
+
+time_t ServiceClock::localMidnight(int32_t dayNumber) {
+    // Guess with the current offset, then correct with the offset in effect at the guess
+    int64_t localMidnightSeconds = (int64_t)dayNumber * 86400;
+    time_t guess = (time_t)(localMidnightSeconds - offsetBefore_);
+    return (time_t)(localMidnightSeconds - utcOffsetAt(guess));
+}
@@ -148,6 +148,23 @@ time_t TimeManager::getCurrentTime() {
         return 0;
     }
 
+    // Convert milliseconds to seconds
+    uint32_t elapsedSeconds = getMillisSinceSync() / 1000;
+
+    // Return current time
+    return lastSyncTime_ + elapsedSeconds;
+}
+
+int64_t TimeManager::getCurrentTimeMillis() {
+    if (!isSynced_) {
+        return 0;
+    }
+
+    // Keep the sub-second part that getCurrentTime() truncates
+    return (int64_t)lastSyncTime_ * 1000 + getMillisSinceSync();
+}
+
+uint32_t TimeManager::getMillisSinceSync() {
     // Calculate elapsed time since last sync using millis()
     unsigned long currentMillis = millis();
     unsigned long elapsedMillis;
@@ -160,11 +177,7 @@ time_t TimeManager::getCurrentTime() {
         elapsedMillis = (0xFFFFFFFF - lastSyncMillis_) + currentMillis + 1;
     }
 
-    // Convert milliseconds to seconds
-    uint32_t elapsedSeconds = elapsedMillis / 1000;
-
-    // Return current time
-    return lastSyncTime_ + elapsedSeconds;
+    return elapsedMillis;
 }
 
 bool TimeManager::isTimeSynced() {
@@ -176,18 +189,7 @@ uint32_t TimeManager::getSecondsSinceSync() {
         return 0;
     }
 
-    unsigned long currentMillis = millis();
-    unsigned long elapsedMillis;
-
-    // Handle millis() rollover
-    if (currentMillis >= lastSyncMillis_) {
-        elapsedMillis = currentMillis - lastSyncMillis_;
-    } else {
-        // Rollover occurred
-        elapsedMillis = (0xFFFFFFFF - lastSyncMillis_) + currentMillis + 1;
-    }
-
-    return elapsedMillis / 1000;
+    return getMillisSinceSync() / 1000;
 }
 
 void TimeManager::update() {
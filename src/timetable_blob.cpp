@@ -0,0 +1,185 @@
+#include "timetable_blob.h"
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+
+uint32_t timetableChecksum(const uint8_t* data, uint32_t length) {
+    // Nibble-wise CRC-32 (reflected polynomial 0xEDB88320)
+    // 16-entry table keeps it small enough for flash on the ESP32
+    static const uint32_t CRC_TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+TimetableBlob::TimetableBlob()
+    : data_(nullptr),
+      size_(0),
+      mapHandle_(0),
+      isMapped_(false) {
+}
+
+TimetableBlob::~TimetableBlob() {
+    close();
+}
+
+bool TimetableBlob::attach(const uint8_t* data, uint32_t size) {
+    data_ = nullptr;
+    size_ = 0;
+
+    if (data == nullptr || size < sizeof(TimetableHeader)) {
+        return false;
+    }
+
+    const TimetableHeader* header = reinterpret_cast<const TimetableHeader*>(data);
+    if (header->magic != TIMETABLE_MAGIC) {
+        Serial.println("[TimetableBlob] Bad magic");
+        return false;
+    }
+    if (header->version != TIMETABLE_VERSION) {
+        Serial.print("[TimetableBlob] Unsupported version ");
+        Serial.println(header->version);
+        return false;
+    }
+    if (header->totalSize > size || header->totalSize < sizeof(TimetableHeader)) {
+        Serial.println("[TimetableBlob] Truncated blob");
+        return false;
+    }
+
+    // Index header must fit
+    uint32_t indexEnd = sizeof(TimetableHeader) + header->sectionCount * sizeof(TimetableSection);
+    if (indexEnd > header->totalSize) {
+        Serial.println("[TimetableBlob] Section index out of range");
+        return false;
+    }
+
+    uint32_t checksum = timetableChecksum(data + sizeof(TimetableHeader),
+                                          header->totalSize - sizeof(TimetableHeader));
+    if (checksum != header->checksum) {
+        Serial.println("[TimetableBlob] Checksum mismatch");
+        return false;
+    }
+
+    // Every section payload must be aligned and inside the blob
+    const TimetableSection* sections = reinterpret_cast<const TimetableSection*>(data + sizeof(TimetableHeader));
+    for (uint16_t i = 0; i < header->sectionCount; i++) {
+        uint64_t end = (uint64_t)sections[i].offset + (uint64_t)sections[i].count * sections[i].recordSize;
+        if (sections[i].offset < indexEnd || (sections[i].offset & 3) != 0 || end > header->totalSize) {
+            Serial.print("[TimetableBlob] Section out of range: ");
+            Serial.println(sections[i].type);
+            return false;
+        }
+    }
+
+    data_ = data;
+    size_ = header->totalSize;
+    return true;
+}
+
+bool TimetableBlob::openPartition(const char* label) {
+    close();
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == nullptr) {
+        Serial.print("[TimetableBlob] No partition labelled ");
+        Serial.println(label);
+        return false;
+    }
+
+    // Map the whole partition into the data address space
+    const void* mapped = nullptr;
+    spi_flash_mmap_handle_t handle;
+    if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+        Serial.println("[TimetableBlob] Partition mmap failed");
+        return false;
+    }
+
+    mapHandle_ = handle;
+    isMapped_ = true;
+
+    if (!attach(static_cast<const uint8_t*>(mapped), partition->size)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TimetableBlob::close() {
+    if (isMapped_) {
+        spi_flash_munmap(mapHandle_);
+        mapHandle_ = 0;
+        isMapped_ = false;
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool TimetableBlob::isValid() const {
+    return data_ != nullptr;
+}
+
+const Station* TimetableBlob::getStations(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_STATIONS, sizeof(Station), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const Station*>(section);
+}
+
+const InterStationSegment* TimetableBlob::getSegments(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_SEGMENTS, sizeof(InterStationSegment), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const InterStationSegment*>(section);
+}
+
+const ServicePattern* TimetableBlob::getPatterns(uint16_t* count) const {
+    uint32_t records = 0;
+    const void* section = findSection(TIMETABLE_SECTION_PATTERNS, sizeof(ServicePattern), 0xFFFF, &records);
+    *count = (uint16_t)records;
+    return static_cast<const ServicePattern*>(section);
+}
+
+const uint16_t* TimetableBlob::getPatternOffsets(uint32_t* count) const {
+    return static_cast<const uint16_t*>(
+        findSection(TIMETABLE_SECTION_PATTERN_OFFSETS, sizeof(uint16_t), 0xFFFFFFFF, count));
+}
+
+const TimetableTrip* TimetableBlob::getTrips(uint32_t* count) const {
+    return static_cast<const TimetableTrip*>(
+        findSection(TIMETABLE_SECTION_TRIPS, sizeof(TimetableTrip), 0xFFFFFFFF, count));
+}
+
+const void* TimetableBlob::findSection(uint32_t type, uint32_t recordSize, uint32_t maxCount,
+                                       uint32_t* count) const {
+    *count = 0;
+    if (data_ == nullptr) {
+        return nullptr;
+    }
+
+    const TimetableHeader* header = reinterpret_cast<const TimetableHeader*>(data_);
+    const TimetableSection* sections = reinterpret_cast<const TimetableSection*>(data_ + sizeof(TimetableHeader));
+
+    for (uint16_t i = 0; i < header->sectionCount; i++) {
+        if (sections[i].type == type) {
+            if (sections[i].recordSize != recordSize) {
+                return nullptr;  // Written by an incompatible tool
+            }
+            if (sections[i].count > maxCount) {
+                return nullptr;  // More records than the caller's count type holds
+            }
+            *count = sections[i].count;
+            return data_ + sections[i].offset;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,171 @@
+#include "timing_wheel.h"
+
+TimingWheel::TimingWheel()
+    : nodes_(nullptr),
+      capacity_(0),
+      pendingCount_(0),
+      now_(0) {
+    reset(0);
+}
+
+void TimingWheel::init(TimerNode* nodes, uint16_t capacity) {
+    nodes_ = nodes;
+    capacity_ = capacity;
+    reset(0);
+}
+
+void TimingWheel::reset(uint32_t now) {
+    for (uint8_t level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+        for (uint8_t slot = 0; slot < TIMING_WHEEL_SLOTS; slot++) {
+            heads_[level][slot] = TIMER_NONE;
+        }
+        occupied_[level] = 0;
+    }
+    for (uint16_t id = 0; id < capacity_; id++) {
+        nodes_[id].level = TIMING_WHEEL_LEVELS;
+    }
+    pendingCount_ = 0;
+    now_ = now;
+}
+
+void TimingWheel::schedule(uint16_t id, uint32_t expiry) {
+    if (id >= capacity_) {
+        return;
+    }
+    if (nodes_[id].level < TIMING_WHEEL_LEVELS) {
+        unlink(id);
+    } else {
+        pendingCount_++;
+    }
+    nodes_[id].expiry = (expiry < now_) ? now_ : expiry;
+    link(id);
+}
+
+void TimingWheel::cancel(uint16_t id) {
+    if (!isScheduled(id)) {
+        return;
+    }
+    unlink(id);
+    pendingCount_--;
+}
+
+bool TimingWheel::pop(uint32_t limit, uint16_t* id, uint32_t* expiry) {
+    while (true) {
+        // Level 0 holds single times: the first occupied slot from now is the earliest timer
+        uint8_t nowSlot = now_ & (TIMING_WHEEL_SLOTS - 1);
+        uint64_t bits = occupied_[0] & (~0ull << nowSlot);
+        if (bits != 0) {
+            uint8_t slot = __builtin_ctzll(bits);
+            uint32_t slotTime = (now_ & ~(uint32_t)(TIMING_WHEEL_SLOTS - 1)) | slot;
+            if (slotTime > limit) {
+                return false;
+            }
+            *id = heads_[0][slot];
+            *expiry = slotTime;
+            unlink(*id);
+            pendingCount_--;
+            now_ = slotTime;
+            return true;
+        }
+
+        // Lower levels are empty: find the next occupied slot above the current one
+        uint8_t level = 1;
+        for (; level < TIMING_WHEEL_LEVELS; level++) {
+            uint8_t shift = level * TIMING_WHEEL_SLOT_BITS;
+            uint8_t currentSlot = (uint8_t)((now_ >> shift) & (TIMING_WHEEL_SLOTS - 1));
+            bits = (currentSlot == TIMING_WHEEL_SLOTS - 1) ? 0 : (occupied_[level] & (~0ull << (currentSlot + 1)));
+            if (bits != 0) {
+                break;
+            }
+        }
+        if (level == TIMING_WHEEL_LEVELS) {
+            return false;
+        }
+
+        // Jump to the start of that slot and spread its timers over the levels below
+        uint8_t slot = __builtin_ctzll(bits);
+        uint8_t shift = level * TIMING_WHEEL_SLOT_BITS;
+        uint8_t upperShift = shift + TIMING_WHEEL_SLOT_BITS;
+        uint32_t upper = (upperShift >= 32) ? 0 : ((now_ >> upperShift) << upperShift);
+        uint32_t slotStart = upper | ((uint32_t)slot << shift);
+        if (slotStart > limit) {
+            return false;
+        }
+        now_ = slotStart;
+
+        uint16_t timer = heads_[level][slot];
+        heads_[level][slot] = TIMER_NONE;
+        occupied_[level] &= ~(1ull << slot);
+        while (timer != TIMER_NONE) {
+            uint16_t next = nodes_[timer].next;
+            link(timer);
+            timer = next;
+        }
+    }
+}
+
+bool TimingWheel::peek(uint32_t* expiry) {
+    if (pendingCount_ == 0) {
+        return false;
+    }
+
+    uint8_t nowSlot = now_ & (TIMING_WHEEL_SLOTS - 1);
+    uint64_t bits = occupied_[0] & (~0ull << nowSlot);
+    if (bits != 0) {
+        *expiry = (now_ & ~(uint32_t)(TIMING_WHEEL_SLOTS - 1)) | __builtin_ctzll(bits);
+        return true;
+    }
+
+    // The first occupied slot above holds the earliest timers, in no order within it
+    for (uint8_t level = 1; level < TIMING_WHEEL_LEVELS; level++) {
+        uint8_t shift = level * TIMING_WHEEL_SLOT_BITS;
+        uint8_t currentSlot = (uint8_t)((now_ >> shift) & (TIMING_WHEEL_SLOTS - 1));
+        bits = (currentSlot == TIMING_WHEEL_SLOTS - 1) ? 0 : (occupied_[level] & (~0ull << (currentSlot + 1)));
+        if (bits == 0) {
+            continue;
+        }
+        uint16_t timer = heads_[level][__builtin_ctzll(bits)];
+        *expiry = nodes_[timer].expiry;
+        for (timer = nodes_[timer].next; timer != TIMER_NONE; timer = nodes_[timer].next) {
+            if (nodes_[timer].expiry < *expiry) {
+                *expiry = nodes_[timer].expiry;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void TimingWheel::link(uint16_t id) {
+    // The highest digit where the expiry differs from now picks the level
+    TimerNode* node = &nodes_[id];
+    uint32_t difference = node->expiry ^ now_;
+    uint8_t level = (difference == 0) ? 0 : (uint8_t)((31 - __builtin_clz(difference)) / TIMING_WHEEL_SLOT_BITS);
+    uint8_t slot = (uint8_t)((node->expiry >> (level * TIMING_WHEEL_SLOT_BITS)) & (TIMING_WHEEL_SLOTS - 1));
+
+    node->level = level;
+    node->slot = slot;
+    node->prev = TIMER_NONE;
+    node->next = heads_[level][slot];
+    if (node->next != TIMER_NONE) {
+        nodes_[node->next].prev = id;
+    }
+    heads_[level][slot] = id;
+    occupied_[level] |= 1ull << slot;
+}
+
+void TimingWheel::unlink(uint16_t id) {
+    TimerNode* node = &nodes_[id];
+    if (node->prev == TIMER_NONE) {
+        heads_[node->level][node->slot] = node->next;
+    } else {
+        nodes_[node->prev].next = node->next;
+    }
+    if (node->next != TIMER_NONE) {
+        nodes_[node->next].prev = node->prev;
+    }
+    if (heads_[node->level][node->slot] == TIMER_NONE) {
+        occupied_[node->level] &= ~(1ull << node->slot);
+    }
+    node->level = TIMING_WHEEL_LEVELS;
+}